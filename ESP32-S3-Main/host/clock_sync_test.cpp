@@ -0,0 +1,185 @@
+// Host test for ClockSync - the S3's estimate of the WROOM clock.
+//
+// SimulatedLink plays both boards: two free-running microsecond clocks, the
+// WROOM's drifting SIM_DRIFT_PPM against the S3's, and a UART path of
+// 150 us plus an exponential queueing delay (mean 300 us), drawn separately
+// each way. Now and then a probe is held up by a slow loop pass. Probes go
+// out as UARTProtocol sends them: every CLOCK_SYNC_FAST_MS until synced,
+// then every CLOCK_SYNC_PERIOD_MS. The S3 clock starts close to the 32-bit
+// wrap, so every run crosses it.
+//
+//   clock_sync_test           exit code 0 when every check passes
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "communication/clock_sync.h"
+#include "config/constants.h"
+#include "test_support.h"
+
+#define SIM_DRIFT_PPM 35.0
+#define SIM_ERROR_BOUND_US 450      // Worst mapping error allowed once the first minute is over
+
+class SimulatedLink {
+private:
+    std::mt19937 rng;
+    std::exponential_distribution<double> queueing{1.0 / 300};
+    std::uniform_real_distribution<double> unit{0.0, 1.0};
+    double mainStartUs;
+    double motorStartUs;
+
+public:
+    double nowUs = 0;               // True time since the start
+    uint32_t probes = 0;
+
+    explicit SimulatedLink(uint32_t seed) : rng(seed) {
+        mainStartUs = 4294967296.0 - 300e6;     // Wraps five minutes in
+        motorStartUs = 1.5e6 + unit(rng) * 4e9;
+    }
+
+    uint32_t mainClock(double t) const { return (uint32_t)(uint64_t)(mainStartUs + t); }
+    uint32_t motorClock(double t) const {
+        return (uint32_t)(uint64_t)(motorStartUs + t * (1.0 + SIM_DRIFT_PPM / 1e6));
+    }
+
+    // The WROOM rebooted: its clock starts over from about zero
+    void restartMotor() { motorStartUs = 1.2e6 - nowUs * (1.0 + SIM_DRIFT_PPM / 1e6); }
+
+    double pathUs() {
+        double us = 150 + queueing(rng);
+        if (unit(rng) < 0.03) us += 5000 + unit(rng) * 20000;   // Slow loop pass on one end
+        return us;
+    }
+
+    // One t1..t4 exchange starting now
+    bool probe(ClockSync& clock) {
+        double sent = nowUs;
+        double received = sent + pathUs();
+        double replied = received + 50 + unit(rng) * 150;       // WROOM turnaround
+        double back = replied + pathUs();
+        probes++;
+        return clock.addSample(mainClock(sent), motorClock(received), motorClock(replied), mainClock(back));
+    }
+
+    // Where a WROOM timestamp taken now lands on the S3 timeline, against the truth
+    double errorUs(const ClockSync& clock) const {
+        return (double)(int32_t)(clock.toMainTime(motorClock(nowUs)) - mainClock(nowUs));
+    }
+
+    // Runs the probe schedule for durationUs, checking the error between probes
+    // once warm. Returns the worst error seen after warmupUs.
+    double run(ClockSync& clock, double durationUs, double warmupUs, bool& boundHeld) {
+        double end = nowUs + durationUs;
+        double start = nowUs;
+        double worst = 0;
+        boundHeld = true;
+        while (nowUs < end) {
+            probe(clock);
+            double period = (clock.isSynced() ? CLOCK_SYNC_PERIOD_MS : CLOCK_SYNC_FAST_MS) * 1000.0;
+
+            // Sample the error across the gap, where drift since the probe adds up
+            for (int i = 1; i <= 4; i++) {
+                nowUs += period / 4;
+                if (!clock.isSynced() || nowUs - start < warmupUs) continue;
+                double error = std::fabs(errorUs(clock));
+                worst = std::max(worst, error);
+                if (error > clock.getErrorUs(mainClock(nowUs))) boundHeld = false;
+            }
+        }
+        return worst;
+    }
+};
+
+// Drifting clocks, noisy path - error bound, drift estimate, the wrap
+static void testTracking() {
+    ClockSync clock;
+    SimulatedLink link(1);
+
+    bool boundHeld;
+    double worst = link.run(clock, 20 * 60e6, 60e6, boundHeld);
+    printf("tracking: worst error %.0f us after the first minute, drift %.1f ppm (true %.1f), %u probes\n",
+           worst, clock.getDriftPpm(), SIM_DRIFT_PPM, link.probes);
+
+    CHECK(clock.isSynced());
+    CHECK(worst < SIM_ERROR_BOUND_US);
+    CHECK(boundHeld);           // getErrorUs() covers the real error
+    CHECK(std::fabs(clock.getDriftPpm() - SIM_DRIFT_PPM) < 4.0);
+    CHECK(clock.getSteps() == 0);
+
+    // toMotorTime() is the inverse of toMainTime()
+    uint32_t main = link.mainClock(link.nowUs);
+    CHECK(std::abs((int32_t)(clock.toMainTime(clock.toMotorTime(main)) - main)) <= 1);
+}
+
+// Locks within the fast probes, drift follows once the span allows
+static void testConvergence() {
+    ClockSync clock;
+    SimulatedLink link(2);
+
+    while (!clock.isSynced() && link.probes < 100) {
+        link.probe(clock);
+        link.nowUs += CLOCK_SYNC_FAST_MS * 1000.0;
+    }
+    CHECK(link.probes == CLOCK_SYNC_MIN_SAMPLES);
+    CHECK(std::fabs(link.errorUs(clock)) < 1000);
+
+    // No drift until the anchor is CLOCK_DRIFT_SPAN_US old, then close and closer
+    bool boundHeld;
+    link.run(clock, CLOCK_DRIFT_SPAN_US / 2, 0, boundHeld);
+    CHECK(clock.getDriftPpm() == 0.0f);
+    link.run(clock, 3 * 60e6, 0, boundHeld);
+    float early = clock.getDriftPpm();
+    link.run(clock, 10 * 60e6, 0, boundHeld);
+    float later = clock.getDriftPpm();
+    printf("convergence: drift %.1f ppm after 3 min, %.1f ppm after 13 min\n", early, later);
+
+    CHECK(std::fabs(early - SIM_DRIFT_PPM) < 12.0);
+    CHECK(std::fabs(later - SIM_DRIFT_PPM) < 4.0);
+}
+
+// WROOM restart - detected as a step, estimator starts over and relocks
+static void testRestart() {
+    ClockSync clock;
+    SimulatedLink link(3);
+
+    bool boundHeld;
+    link.run(clock, 5 * 60e6, 60e6, boundHeld);
+    CHECK(clock.isSynced());
+    CHECK(clock.getSteps() == 0);
+
+    link.restartMotor();
+    link.probe(clock);
+    CHECK(clock.getSteps() == 1);
+    CHECK(!clock.isSynced());
+
+    double worst = link.run(clock, 5 * 60e6, 60e6, boundHeld);
+    printf("restart: step detected, worst error %.0f us after relocking\n", worst);
+    CHECK(clock.isSynced());
+    CHECK(clock.getSteps() == 1);
+    CHECK(worst < SIM_ERROR_BOUND_US);
+
+    // A slow probe on its own is not a restart
+    link.nowUs += 1e6;
+    uint32_t t1 = link.mainClock(link.nowUs);
+    uint32_t t2 = link.motorClock(link.nowUs + 30000);
+    uint32_t t3 = link.motorClock(link.nowUs + 30100);
+    uint32_t t4 = link.mainClock(link.nowUs + 30300);
+    clock.addSample(t1, t2, t3, t4);
+    CHECK(clock.getSteps() == 1);
+    CHECK(clock.isSynced());
+}
+
+int main() {
+    testTracking();
+    testConvergence();
+    testRestart();
+
+    if (failures) {
+        printf("clock_sync_test: %d checks failed\n", failures);
+        return 1;
+    }
+    printf("clock_sync_test: all checks passed\n");
+    return 0;
+}
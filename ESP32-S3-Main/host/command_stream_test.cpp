@@ -0,0 +1,424 @@
+// Host test for the dashboard command stream.
+//
+// StandInServer plays the Firebase RTDB streaming endpoint on 127.0.0.1: a
+// GET with "Accept: text/event-stream" gets the same event format the S3
+// sees (put / patch / keep-alive, {"path": ..., "data": ...} bodies), opening
+// with a put of the whole subtree, and it can drop the connection on cue.
+// StreamClient parses the events into CommandStream and reconnects with
+// backoff, like FirebaseManager::serviceCommands().
+//
+//   command_stream_test           exit code 0 when every check passes
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "communication/command_stream.h"
+#include "test_support.h"
+
+class StandInServer {
+private:
+    int listenFd = -1;
+    uint16_t port = 0;
+    std::thread thread;
+    std::mutex lock;
+    std::condition_variable wake;
+
+    std::string tree = "null";          // What a new connection opens with
+    std::deque<std::string> pending;
+    bool dropRequested = false;
+    bool stopping = false;
+    int connections = 0;
+
+    void serve(int fd) {
+        // Request line and headers, nothing else is ever sent by the client
+        std::string request;
+        char chunk[512];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) return;
+            request.append(chunk, n);
+        }
+        if (request.compare(0, 19, "GET /commands.json ") != 0 ||
+            request.find("Accept: text/event-stream") == std::string::npos) {
+            sendAll(fd, "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n");
+            return;
+        }
+
+        std::unique_lock<std::mutex> guard(lock);
+        connections++;
+        dropRequested = false;
+        pending.clear();
+        std::string opening = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                              "Cache-Control: no-cache\r\n\r\n"
+                              "event: put\ndata: {\"path\":\"/\",\"data\":" + tree + "}\n\n";
+        guard.unlock();
+        if (!sendAll(fd, opening)) return;
+
+        while (true) {
+            guard.lock();
+            wake.wait(guard, [this] { return stopping || dropRequested || !pending.empty(); });
+            if (stopping || dropRequested) return;
+            std::string event = pending.front();
+            pending.pop_front();
+            guard.unlock();
+            if (!sendAll(fd, event)) return;
+        }
+    }
+
+    void run() {
+        while (true) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0) return;     // Listening socket closed by stop()
+            serve(fd);
+            close(fd);
+        }
+    }
+
+public:
+    bool start() {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 4) != 0) return false;
+
+        socklen_t length = sizeof(addr);
+        getsockname(listenFd, (sockaddr*)&addr, &length);
+        port = ntohs(addr.sin_port);
+        thread = std::thread(&StandInServer::run, this);
+        return true;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        shutdown(listenFd, SHUT_RDWR);
+        close(listenFd);
+        thread.join();
+    }
+
+    uint16_t getPort() const { return port; }
+
+    int getConnections() {
+        std::lock_guard<std::mutex> guard(lock);
+        return connections;
+    }
+
+    // Subtree sent as the opening put of the next connection
+    void setTree(const std::string& json) {
+        std::lock_guard<std::mutex> guard(lock);
+        tree = json;
+    }
+
+    void event(const char* name, const std::string& path, const std::string& data) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            pending.push_back(std::string("event: ") + name + "\ndata: {\"path\":\"" + path +
+                              "\",\"data\":" + data + "}\n\n");
+        }
+        wake.notify_all();
+    }
+
+    void keepAlive() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            pending.push_back("event: keep-alive\ndata: null\n\n");
+        }
+        wake.notify_all();
+    }
+
+    // Closes the current connection, as a server restart or a dead link would
+    void drop() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            dropRequested = true;
+        }
+        wake.notify_all();
+    }
+};
+
+class StreamClient {
+private:
+    uint16_t port;
+    int fd = -1;
+    std::string buffer;
+    std::string eventName;
+    std::string eventData;
+    uint32_t retryAt = 0;
+    uint32_t retryMs;
+
+    static constexpr uint32_t RETRY_FIRST_MS = 20;
+    static constexpr uint32_t RETRY_MAX_MS = 500;
+
+public:
+    CommandStream commands;
+    uint32_t changes = 0;
+    uint32_t keepAlives = 0;
+    uint32_t opens = 0;
+
+    explicit StreamClient(uint16_t port) : port(port), retryMs(RETRY_FIRST_MS) {}
+    ~StreamClient() { closeStream(); }
+
+    bool isOpen() const { return fd >= 0; }
+
+    void closeStream() {
+        if (fd >= 0) close(fd);
+        fd = -1;
+        buffer.clear();
+        eventName.clear();
+        eventData.clear();
+    }
+
+    bool openStream() {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0 ||
+            !sendAll(fd, "GET /commands.json HTTP/1.1\r\nHost: 127.0.0.1\r\nAccept: text/event-stream\r\n\r\n")) {
+            closeStream();
+            return false;
+        }
+        opens++;
+        return true;
+    }
+
+    void dispatch() {
+        if (eventName == "put" || eventName == "patch") {
+            // {"path":"/x","data":VALUE}
+            size_t pathAt = eventData.find("\"path\":\"");
+            size_t dataAt = eventData.find("\"data\":");
+            size_t closing = eventData.rfind('}');
+            if (pathAt != std::string::npos && dataAt != std::string::npos && closing != std::string::npos) {
+                pathAt += 8;
+                std::string path = eventData.substr(pathAt, eventData.find('"', pathAt) - pathAt);
+                std::string data = eventData.substr(dataAt + 7, closing - dataAt - 7);
+                if (commands.apply(eventName == "patch" ? COMMAND_PATCH : COMMAND_PUT, path.c_str(), data.c_str())) {
+                    changes++;
+                }
+            }
+        } else if (eventName == "keep-alive") {
+            keepAlives++;
+        }
+        eventName.clear();
+        eventData.clear();
+    }
+
+    // Lines of "field: value", a blank line ends the event. HTTP headers go through here
+    // too and are ignored - they have no event field and end before the first event.
+    void feedLines() {
+        size_t end;
+        while ((end = buffer.find('\n')) != std::string::npos) {
+            std::string line = buffer.substr(0, end);
+            buffer.erase(0, end + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+
+            if (line.empty()) {
+                if (!eventName.empty()) dispatch();
+            } else if (line.compare(0, 7, "event: ") == 0) {
+                eventName = line.substr(7);
+            } else if (line.compare(0, 6, "data: ") == 0) {
+                eventData += line.substr(6);
+            }
+        }
+    }
+
+    // One pass of what the network task does: reconnect when due, else read what arrived
+    void service(int waitMs) {
+        if (!isOpen()) {
+            if (nowMs() < retryAt) {
+                sleepMs(waitMs);
+                return;
+            }
+            if (!openStream()) {
+                retryAt = nowMs() + retryMs;
+                retryMs = std::min(retryMs * 2, RETRY_MAX_MS);
+                return;
+            }
+            retryMs = RETRY_FIRST_MS;
+        }
+
+        pollfd waiting = {fd, POLLIN, 0};
+        if (poll(&waiting, 1, waitMs) <= 0) return;
+
+        char chunk[512];
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) {
+            closeStream();
+            retryAt = nowMs() + retryMs;
+            return;
+        }
+        buffer.append(chunk, n);
+        feedLines();
+    }
+
+    bool waitFor(const std::function<bool()>& done, uint32_t timeoutMs = 2000) {
+        uint32_t start = nowMs();
+        while (!done()) {
+            if (nowMs() - start > timeoutMs) return false;
+            service(5);
+        }
+        return true;
+    }
+};
+
+// CommandStream on its own - event shapes the dashboard and the server produce
+static void testParser() {
+    CommandStream stream;
+
+    CHECK(stream.apply(COMMAND_PUT, "/", "{\"buzzersound\":40,\"heartrate_start\":true}"));
+    CHECK(stream.getState().buzzersound == 40 && stream.getState().heartrate_start);
+
+    // Same values again - accepted but nothing changed
+    CHECK(!stream.apply(COMMAND_PUT, "/", "{\"buzzersound\":40,\"heartrate_start\":true}"));
+
+    CHECK(stream.apply(COMMAND_PUT, "/buzzer01ring", "true"));
+    CHECK(stream.getState().buzzer01ring && stream.getState().buzzersound == 40);
+    CHECK(stream.getChanged() == COMMAND_BUZZER01);
+
+    CHECK(stream.apply(COMMAND_PATCH, "/", "{ \"lightadj_left\" : 70.6, \"route_destination\": 3 }"));
+    CHECK(stream.getState().lightadj_left == 70 && stream.getState().route_destination == 3);
+    CHECK(stream.getState().heartrate_start);
+
+    // Unknown keys, strings and nested values are stepped over
+    CHECK(stream.apply(COMMAND_PATCH, "/", "{\"note\":\"a } \\\" b\",\"x\":{\"y\":[1,{\"z\":2}]},\"buzzersound\":55}"));
+    CHECK(stream.getState().buzzersound == 55);
+
+    // Deleted key goes back to its default
+    CHECK(stream.apply(COMMAND_PUT, "/heartrate_start", "null"));
+    CHECK(!stream.getState().heartrate_start);
+
+    // Root put replaces the set - keys it leaves out are cleared
+    CHECK(stream.apply(COMMAND_PUT, "/", "{\"colour_start\":true}"));
+    CHECK(stream.getState().colour_start && stream.getState().buzzersound == 0 && stream.getState().route_destination == 0);
+
+    uint32_t rejected = stream.getRejected();
+    CHECK(!stream.apply(COMMAND_PATCH, "/", "{\"buzzersound\":"));
+    CHECK(!stream.apply(COMMAND_PATCH, "/", "{\"buzzersound\":12,"));
+    CHECK(!stream.apply(COMMAND_PUT, "/", "[1,2]"));
+    CHECK(!stream.apply(COMMAND_PUT, "/buzzersound", "\"12\""));
+    CHECK(!stream.apply(COMMAND_PUT, "/buzzersound", "1e99"));
+    CHECK(!stream.apply(COMMAND_PUT, "/unknown", "1"));
+    CHECK(!stream.apply(COMMAND_PUT, "/buzzersound/x", "1"));
+    CHECK(!stream.apply(COMMAND_PUT, "buzzersound", "1"));
+    CHECK(stream.getRejected() == rejected + 8);
+    CHECK(stream.getState().colour_start && stream.getState().buzzersound == 0);
+
+    CHECK(stream.apply(COMMAND_PUT, "/", "null"));
+    CHECK(!stream.getState().colour_start);
+}
+
+// Only the fields an event changed are merged - what a LAN client set elsewhere stands
+static void testMerge() {
+    CommandStream stream;
+    FirebaseRxData loop = {};
+
+    CHECK(stream.apply(COMMAND_PUT, "/", "{\"lightadj_left\":20,\"buzzersound\":40}"));
+    CHECK(stream.getChanged() == (COMMAND_LIGHT_LEFT | COMMAND_BUZZER_SOUND));
+    mergeCommands(loop, stream.getState(), stream.getChanged());
+    CHECK(loop.lightadj_left == 20 && loop.buzzersound == 40);
+
+    loop.lightadj_left = 90;                    // From a LAN client
+    CHECK(stream.apply(COMMAND_PATCH, "/", "{\"heartrate_start\":true,\"buzzersound\":40}"));
+    CHECK(stream.getChanged() == COMMAND_HEARTRATE_START);
+    mergeCommands(loop, stream.getState(), stream.getChanged());
+    CHECK(loop.heartrate_start && loop.lightadj_left == 90);
+
+    // A reconnect's opening put only carries over what differs from before
+    CHECK(stream.apply(COMMAND_PUT, "/", "{\"lightadj_left\":20,\"buzzersound\":55,\"heartrate_start\":true}"));
+    CHECK(stream.getChanged() == COMMAND_BUZZER_SOUND);
+    mergeCommands(loop, stream.getState(), stream.getChanged());
+    CHECK(loop.buzzersound == 55 && loop.lightadj_left == 90);
+
+    CHECK(!stream.apply(COMMAND_PATCH, "/", "{\"buzzersound\":"));
+    CHECK(stream.getChanged() == 0);
+
+    mergeCommands(loop, stream.getState(), COMMAND_ALL);
+    CHECK(loop.lightadj_left == 20);
+}
+
+// Against the stand-in server: initial sync, live events, drop and resync
+static void testStream() {
+    StandInServer server;
+    if (!server.start()) {
+        printf("FAIL could not start the stand-in server\n");
+        failures++;
+        return;
+    }
+    server.setTree("{\"buzzersound\":40,\"heartrate_start\":true}");
+
+    StreamClient client(server.getPort());
+    CHECK(client.waitFor([&] { return client.commands.getState().buzzersound == 40; }));
+    CHECK(client.commands.getState().heartrate_start);
+
+    // Event -> applied, as the loop would see it
+    double worstUs = 0;
+    for (int i = 1; i <= 20; i++) {
+        double sentUs = nowUs();
+        server.event("put", "/buzzersound", std::to_string(i));
+        CHECK(client.waitFor([&] { return client.commands.getState().buzzersound == i; }));
+        worstUs = std::max(worstUs, nowUs() - sentUs);
+    }
+    printf("event -> applied, worst of 20: %.0f us\n", worstUs);
+
+    server.event("patch", "/", "{\"lightadj_left\":70,\"route_destination\":3}");
+    CHECK(client.waitFor([&] { return client.commands.getState().route_destination == 3; }));
+    CHECK(client.commands.getState().lightadj_left == 70);
+
+    uint32_t changes = client.changes;
+    server.keepAlive();
+    CHECK(client.waitFor([&] { return client.keepAlives == 1; }));
+    CHECK(client.changes == changes);
+
+    // Dashboard changes while the link is down arrive with the reconnect's opening put
+    server.setTree("{\"buzzer01ring\":true,\"buzzersound\":80}");
+    server.drop();
+    CHECK(client.waitFor([&] { return server.getConnections() == 2 && client.commands.getState().buzzersound == 80; }));
+    CHECK(client.commands.getState().buzzer01ring);
+    CHECK(!client.commands.getState().heartrate_start);
+    CHECK(client.commands.getState().route_destination == 0);
+    CHECK(client.opens == 2);
+
+    // Dropped again - each reconnect starts from the server's current tree
+    server.setTree("{\"ultrasonic_start\":true}");
+    server.drop();
+    CHECK(client.waitFor([&] { return client.commands.getState().ultrasonic_start; }));
+    CHECK(client.commands.getState().buzzersound == 0);
+
+    server.event("put", "/", "null");
+    CHECK(client.waitFor([&] { return !client.commands.getState().ultrasonic_start; }));
+
+    client.closeStream();
+    server.stop();
+}
+
+int main() {
+    testParser();
+    testMerge();
+    testStream();
+
+    if (failures) {
+        printf("command_stream_test: %d checks failed\n", failures);
+        return 1;
+    }
+    printf("command_stream_test: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,699 @@
+// Host test and round-trip client for the LAN WebSocket.
+//
+// TestClient speaks the binary protocol of lan_protocol.h over a minimal
+// RFC 6455 client. Without arguments it runs against StandInRobot, which
+// plays LanSocket on 127.0.0.1 with the same parts the firmware uses
+// (lan_protocol.cpp, the LAN_* limits in constants.h): pings answered by the
+// socket reader, commands rate-limited and queued for a loop thread that
+// applies them once a pass and acks, and a sender thread handing out
+// snapshots at each client's subscribed rate. Which message gets what answer
+// and which client is due a snapshot come from lanDecide() and
+// lanSnapshotDue(), as in LanSocket - only the transport here is its own.
+//
+//   lan_socket_test                 stand-in checks, exit code 0 when all pass
+//   lan_socket_test <host> [port]   round trips against a robot - no checks,
+//                                   commands sent carry no fields so nothing moves
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "communication/lan_protocol.h"
+#include "config/constants.h"
+#include "test_support.h"
+
+static bool recvAll(int fd, void* data, size_t len, int timeoutMs) {
+    uint8_t* bytes = (uint8_t*)data;
+    size_t got = 0;
+    while (got < len) {
+        pollfd p = {fd, POLLIN, 0};
+        if (poll(&p, 1, timeoutMs) <= 0) return false;
+        ssize_t n = recv(fd, bytes + got, len - got, 0);
+        if (n <= 0) return false;
+        got += n;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// RFC 6455 plumbing - handshake key and framing
+
+static void sha1(const uint8_t* data, size_t len, uint8_t out[20]) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::vector<uint8_t> message(data, data + len);
+    message.push_back(0x80);
+    while (message.size() % 64 != 56) message.push_back(0);
+    uint64_t bits = (uint64_t)len * 8;
+    for (int i = 7; i >= 0; i--) message.push_back((uint8_t)(bits >> (i * 8)));
+
+    auto rotl = [](uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+    for (size_t chunk = 0; chunk < message.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const uint8_t* p = &message[chunk + i * 4];
+            w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+        }
+        for (int i = 16; i < 80; i++) w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20)      { f = (b & c) | (~b & d);           k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d;                    k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d);  k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                    k = 0xCA62C1D6; }
+            uint32_t t = rotl(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = rotl(b, 30); b = a; a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+    for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < 4; j++) out[i * 4 + j] = (uint8_t)(h[i] >> (24 - j * 8));
+    }
+}
+
+static std::string base64(const uint8_t* data, size_t len) {
+    static const char TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < len) v |= data[i + 2];
+        out += TABLE[(v >> 18) & 63];
+        out += TABLE[(v >> 12) & 63];
+        out += (i + 1 < len) ? TABLE[(v >> 6) & 63] : '=';
+        out += (i + 2 < len) ? TABLE[v & 63] : '=';
+    }
+    return out;
+}
+
+static std::string acceptKey(const std::string& key) {
+    std::string text = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    uint8_t digest[20];
+    sha1((const uint8_t*)text.data(), text.size(), digest);
+    return base64(digest, sizeof(digest));
+}
+
+enum Opcode : uint8_t {
+    OP_BINARY = 0x2,
+    OP_CLOSE = 0x8
+};
+
+// Clients mask what they send, servers don't
+static bool sendFrame(int fd, uint8_t opcode, const void* data, size_t len, bool mask) {
+    std::vector<uint8_t> frame;
+    frame.push_back(0x80 | opcode);
+    uint8_t maskBit = mask ? 0x80 : 0;
+    if (len < 126) {
+        frame.push_back(maskBit | (uint8_t)len);
+    } else {
+        frame.push_back(maskBit | 126);
+        frame.push_back((uint8_t)(len >> 8));
+        frame.push_back((uint8_t)len);
+    }
+
+    uint8_t key[4] = {0x12, 0x9A, 0x3C, 0xE7};
+    if (mask) frame.insert(frame.end(), key, key + 4);
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) frame.push_back(mask ? bytes[i] ^ key[i % 4] : bytes[i]);
+    return sendAll(fd, frame.data(), frame.size());
+}
+
+enum RecvResult {
+    RECV_TIMEOUT = -1,
+    RECV_CLOSED = -2
+};
+
+// Opcode of the next frame. Only the wait for it to start times out - a
+// frame that has started is read whole, so a timeout never splits one.
+static int recvFrame(int fd, std::vector<uint8_t>& payload, int timeoutMs) {
+    pollfd p = {fd, POLLIN, 0};
+    if (poll(&p, 1, timeoutMs) <= 0) return RECV_TIMEOUT;
+
+    const int FRAME_MS = 1000;
+    uint8_t header[2];
+    if (!recvAll(fd, header, 2, FRAME_MS)) return RECV_CLOSED;
+
+    uint64_t len = header[1] & 0x7F;
+    if (len == 126) {
+        uint8_t ext[2];
+        if (!recvAll(fd, ext, 2, FRAME_MS)) return RECV_CLOSED;
+        len = ((uint64_t)ext[0] << 8) | ext[1];
+    } else if (len == 127) {
+        return RECV_CLOSED;         // Nothing in this protocol is that large
+    }
+
+    uint8_t key[4] = {0, 0, 0, 0};
+    bool masked = header[1] & 0x80;
+    if (masked && !recvAll(fd, key, 4, FRAME_MS)) return RECV_CLOSED;
+
+    payload.resize(len);
+    if (len > 0 && !recvAll(fd, payload.data(), len, FRAME_MS)) return RECV_CLOSED;
+    if (masked) {
+        for (size_t i = 0; i < len; i++) payload[i] ^= key[i % 4];
+    }
+    return header[0] & 0x0F;
+}
+
+// ---------------------------------------------------------------------------
+// Stand-in for LanSocket and the loop behind it
+
+class StandInRobot {
+private:
+    struct Connection {
+        int fd = -1;
+        std::mutex write;
+        std::thread reader;
+        LanClient state;            // Under StandInRobot::lock, as LanSocket's clients under clientLock
+        bool open = true;
+
+        void send(const void* data, size_t len) {
+            std::lock_guard<std::mutex> guard(write);
+            if (open) sendFrame(fd, OP_BINARY, data, len, false);
+        }
+    };
+
+    struct QueuedCommand {
+        std::shared_ptr<Connection> client;
+        LanCommand command;
+    };
+
+    int listenFd = -1;
+    uint16_t port = 0;
+    std::thread acceptThread, loopThread, senderThread;
+    std::atomic<bool> stopping{false};
+
+    std::mutex lock;                // Everything below
+    std::condition_variable senderWake;
+    std::vector<std::shared_ptr<Connection>> clients;
+    std::deque<QueuedCommand> commands;
+    std::deque<std::pair<std::shared_ptr<Connection>, LanCommandAck>> acks;
+    LanSnapshot latest = {};
+    bool haveSnapshot = false;
+    uint32_t nextId = 1;
+
+    FirebaseRxData rx = {};
+    uint32_t applied = 0;
+
+    static constexpr int LOOP_PASS_MS = 10;     // A slow S3 loop pass
+
+    bool handshake(int fd) {
+        std::string request;
+        char chunk[512];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            pollfd p = {fd, POLLIN, 0};
+            if (poll(&p, 1, 1000) <= 0) return false;
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) return false;
+            request.append(chunk, n);
+        }
+
+        std::string path = std::string("GET ") + LAN_SOCKET_PATH + " ";
+        size_t keyAt = request.find("Sec-WebSocket-Key: ");
+        if (request.compare(0, path.size(), path) != 0 || keyAt == std::string::npos) {
+            const char* bad = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+            sendAll(fd, bad, strlen(bad));
+            return false;
+        }
+        keyAt += strlen("Sec-WebSocket-Key: ");
+        std::string key = request.substr(keyAt, request.find("\r\n", keyAt) - keyAt);
+
+        std::string response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                               "Connection: Upgrade\r\nSec-WebSocket-Accept: " + acceptKey(key) + "\r\n\r\n";
+        return sendAll(fd, response.data(), response.size());
+    }
+
+    // LanSocket::onMessage
+    void onMessage(const std::shared_ptr<Connection>& client, const std::vector<uint8_t>& data) {
+        std::unique_lock<std::mutex> guard(lock);
+        LanDecision decision = lanDecide(client->state, data.data(), data.size(), nowMs());
+        if (decision.action == LAN_ACTION_QUEUE) {
+            if (commands.size() >= LAN_COMMAND_QUEUE_LEN) lanQueueFull(decision);
+            else commands.push_back({client, decision.command});
+        }
+        guard.unlock();
+
+        if (decision.action == LAN_ACTION_PONG) client->send(&decision.pong, sizeof(decision.pong));
+        else if (decision.action == LAN_ACTION_REFUSE) client->send(&decision.ack, sizeof(decision.ack));
+    }
+
+    void serve(std::shared_ptr<Connection> client) {
+        std::vector<uint8_t> payload;
+        while (!stopping) {
+            int opcode = recvFrame(client->fd, payload, 100);
+            if (opcode == OP_BINARY) onMessage(client, payload);
+            else if (opcode == OP_CLOSE || opcode == RECV_CLOSED) break;
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        clients.erase(std::remove(clients.begin(), clients.end(), client), clients.end());
+        std::lock_guard<std::mutex> writeGuard(client->write);
+        client->open = false;
+        close(client->fd);
+    }
+
+    void acceptLoop() {
+        while (true) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0) return;
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            if (!handshake(fd)) {
+                close(fd);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> guard(lock);
+            if (clients.size() >= LAN_MAX_CLIENTS) {
+                guard.unlock();
+                uint8_t reason[2] = {1013 >> 8, 1013 & 0xFF};
+                sendFrame(fd, OP_CLOSE, reason, sizeof(reason), false);
+                sleepMs(50);
+                close(fd);
+                continue;
+            }
+            auto client = std::make_shared<Connection>();
+            client->fd = fd;
+            lanClientConnect(client->state, nextId++, nowMs());
+            clients.push_back(client);
+            client->reader = std::thread(&StandInRobot::serve, this, client);
+            client->reader.detach();
+        }
+    }
+
+    // The S3 loop: commands once a pass, a snapshot every 1000 / LAN_SNAPSHOT_MAX_HZ ms
+    void loop() {
+        uint16_t seq = 0;
+        uint32_t lastSnapshot = 0;
+        while (!stopping) {
+            sleepMs(LOOP_PASS_MS);
+            std::lock_guard<std::mutex> guard(lock);
+
+            bool any = false;
+            while (!commands.empty()) {
+                QueuedCommand queued = commands.front();
+                commands.pop_front();
+                applyLanCommand(queued.command, rx);
+                applied++;
+                acks.push_back({queued.client, lanCommandAck(queued.command.seq, LAN_ACK_APPLIED)});
+                any = true;
+            }
+            if (any) senderWake.notify_one();
+
+            if (nowMs() - lastSnapshot >= 1000 / LAN_SNAPSHOT_MAX_HZ) {
+                lastSnapshot = nowMs();
+                latest = {};
+                latest.type = LAN_SNAPSHOT;
+                latest.version = LAN_PROTOCOL_VERSION;
+                latest.seq = ++seq;
+                latest.timeMs = lastSnapshot;
+                latest.ultrasonic[0] = 143;
+                latest.hr = 74;
+                haveSnapshot = true;
+            }
+        }
+    }
+
+    // LanSocket::run
+    void sender() {
+        while (!stopping) {
+            std::unique_lock<std::mutex> guard(lock);
+            senderWake.wait_for(guard, std::chrono::milliseconds(LAN_TICK_MS));
+
+            auto pending = acks;
+            acks.clear();
+            auto targets = clients;
+            LanSnapshot snapshot = latest;
+            bool have = haveSnapshot;
+            guard.unlock();
+
+            for (auto& ack : pending) ack.first->send(&ack.second, sizeof(ack.second));
+            if (!have) continue;
+
+            uint32_t now = nowMs();
+            for (auto& client : targets) {
+                guard.lock();
+                bool due = lanSnapshotDue(client->state, snapshot.seq, now);
+                if (due) lanSnapshotSent(client->state, snapshot.seq, now);
+                guard.unlock();
+                if (due) client->send(&snapshot, sizeof(snapshot));
+            }
+        }
+    }
+
+public:
+    bool start() {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 8) != 0) return false;
+
+        socklen_t length = sizeof(addr);
+        getsockname(listenFd, (sockaddr*)&addr, &length);
+        port = ntohs(addr.sin_port);
+        acceptThread = std::thread(&StandInRobot::acceptLoop, this);
+        loopThread = std::thread(&StandInRobot::loop, this);
+        senderThread = std::thread(&StandInRobot::sender, this);
+        return true;
+    }
+
+    void stop() {
+        stopping = true;
+        shutdown(listenFd, SHUT_RDWR);
+        close(listenFd);
+        acceptThread.join();
+        loopThread.join();
+        senderThread.join();
+        sleepMs(150);               // Readers notice stopping within their 100 ms poll
+    }
+
+    uint16_t getPort() const { return port; }
+
+    FirebaseRxData commandState() {
+        std::lock_guard<std::mutex> guard(lock);
+        return rx;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Client
+
+class TestClient {
+private:
+    int fd = -1;
+    uint16_t seq = 0;
+    std::deque<std::vector<uint8_t>> snapshots;     // Set aside while waiting for something else
+
+public:
+    ~TestClient() { disconnect(); }
+
+    bool connect(const char* host, uint16_t port) {
+        addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* found = nullptr;
+        char service[8];
+        snprintf(service, sizeof(service), "%u", port);
+        if (getaddrinfo(host, service, &hints, &found) != 0) return false;
+
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        bool ok = ::connect(fd, found->ai_addr, found->ai_addrlen) == 0;
+        freeaddrinfo(found);
+        if (!ok) return false;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        const char* key = "c3luYXBzZS1sYW4tdGVzdA==";
+        std::string request = std::string("GET ") + LAN_SOCKET_PATH + " HTTP/1.1\r\nHost: " + host +
+                              "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                              "Sec-WebSocket-Key: " + key + "\r\nSec-WebSocket-Version: 13\r\n\r\n";
+        if (!sendAll(fd, request.data(), request.size())) return false;
+
+        std::string response;
+        char c;
+        while (response.find("\r\n\r\n") == std::string::npos) {
+            if (!recvAll(fd, &c, 1, 2000)) return false;
+            response += c;
+        }
+        return response.compare(0, 12, "HTTP/1.1 101") == 0 &&
+               response.find(acceptKey(key)) != std::string::npos;
+    }
+
+    void disconnect() {
+        if (fd < 0) return;
+        uint8_t reason[2] = {1000 >> 8, 1000 & 0xFF};
+        sendFrame(fd, OP_CLOSE, reason, sizeof(reason), true);
+        close(fd);
+        fd = -1;
+    }
+
+    bool sendRaw(const void* data, size_t len) {
+        return sendFrame(fd, OP_BINARY, data, len, true);
+    }
+
+    void subscribe(uint8_t rateHz) {
+        LanSubscribe message = {LAN_SUBSCRIBE, rateHz};
+        sendRaw(&message, sizeof(message));
+    }
+
+    uint16_t sendCommand(LanCommand command) {
+        command.type = LAN_COMMAND;
+        command.seq = ++seq;
+        sendRaw(&command, sizeof(command));
+        return command.seq;
+    }
+
+    // Next message of the given type; snapshots that arrive first are kept
+    bool waitFor(uint8_t type, std::vector<uint8_t>& message, int timeoutMs) {
+        if (type == LAN_SNAPSHOT && !snapshots.empty()) {
+            message = snapshots.front();
+            snapshots.pop_front();
+            return true;
+        }
+
+        uint32_t deadline = nowMs() + timeoutMs;
+        while ((int32_t)(deadline - nowMs()) > 0) {
+            int opcode = recvFrame(fd, message, deadline - nowMs());
+            if (opcode < 0 || opcode == OP_CLOSE) return false;
+            if (opcode != OP_BINARY || message.empty()) continue;
+            if (message[0] == type) return true;
+            if (message[0] == LAN_SNAPSHOT) snapshots.push_back(message);
+        }
+        return false;
+    }
+
+    // Close code the server sent, or -1
+    int waitForClose(int timeoutMs) {
+        std::vector<uint8_t> payload;
+        uint32_t deadline = nowMs() + timeoutMs;
+        while ((int32_t)(deadline - nowMs()) > 0) {
+            int opcode = recvFrame(fd, payload, deadline - nowMs());
+            if (opcode < 0) return -1;
+            if (opcode == OP_CLOSE) return payload.size() >= 2 ? (payload[0] << 8) | payload[1] : 0;
+        }
+        return -1;
+    }
+
+    void dropSnapshots() {
+        snapshots.clear();
+    }
+};
+
+// ---------------------------------------------------------------------------
+
+struct Percentiles {
+    double p50, p99, max;
+};
+
+static Percentiles percentiles(std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+    if (samples.empty()) return {0, 0, 0};
+    return {samples[samples.size() / 2], samples[samples.size() * 99 / 100], samples.back()};
+}
+
+static void printRtt(const char* name, const std::vector<double>& samples, size_t sent) {
+    Percentiles p = percentiles(samples);
+    printf("%-16s %zu/%zu  p50 %.2f ms  p99 %.2f ms  max %.2f ms\n",
+           name, samples.size(), sent, p.p50 / 1000, p.p99 / 1000, p.max / 1000);
+}
+
+// Ping -> pong: the socket handler alone
+static std::vector<double> measurePing(TestClient& client, int count) {
+    std::vector<double> rtt;
+    std::vector<uint8_t> reply;
+    for (int i = 0; i < count; i++) {
+        LanPing ping = {LAN_PING, (uint32_t)i * 2654435761u};
+        double start = nowUs();
+        client.sendRaw(&ping, sizeof(ping));
+        if (!client.waitFor(LAN_PONG, reply, 1000)) continue;
+        LanPing pong;
+        memcpy(&pong, reply.data(), sizeof(pong));
+        if (pong.token == ping.token) rtt.push_back(nowUs() - start);
+    }
+    return rtt;
+}
+
+// Command -> applied ack: through the queue and a loop pass
+static std::vector<double> measureCommand(TestClient& client, int count, LanCommand command) {
+    std::vector<double> rtt;
+    std::vector<uint8_t> reply;
+    int spacing = 1000 / LAN_COMMAND_RATE + 5;      // Under the rate limit
+    for (int i = 0; i < count; i++) {
+        double start = nowUs();
+        uint16_t seq = client.sendCommand(command);
+        if (client.waitFor(LAN_COMMAND_ACK, reply, 1000)) {
+            LanCommandAck ack;
+            memcpy(&ack, reply.data(), sizeof(ack));
+            if (ack.seq == seq && ack.status == LAN_ACK_APPLIED) rtt.push_back(nowUs() - start);
+        }
+        sleepMs(spacing);
+    }
+    return rtt;
+}
+
+static int countSnapshots(TestClient& client, uint8_t rateHz, int windowMs) {
+    client.subscribe(rateHz);
+    sleepMs(100);
+    client.dropSnapshots();
+
+    std::vector<uint8_t> message;
+    while (client.waitFor(LAN_SNAPSHOT, message, 20)) {}
+
+    int count = 0;
+    uint32_t end = nowMs() + windowMs;
+    while ((int32_t)(end - nowMs()) > 0) {
+        if (client.waitFor(LAN_SNAPSHOT, message, end - nowMs())) count++;
+    }
+    return count;
+}
+
+static int runAgainst(const char* host, uint16_t port) {
+    TestClient client;
+    if (!client.connect(host, port)) {
+        printf("Could not open ws://%s:%u%s\n", host, port, LAN_SOCKET_PATH);
+        return 1;
+    }
+    client.subscribe(0);
+    sleepMs(100);
+
+    printRtt("ping", measurePing(client, 200), 200);
+    LanCommand noop = {};
+    printRtt("command -> ack", measureCommand(client, 50, noop), 50);
+    printf("snapshots        %d in 1 s at %d Hz\n", countSnapshots(client, LAN_SNAPSHOT_MAX_HZ, 1000), LAN_SNAPSHOT_MAX_HZ);
+    return 0;
+}
+
+static void testStandIn() {
+    StandInRobot robot;
+    CHECK(robot.start());
+
+    TestClient client;
+    CHECK(client.connect("127.0.0.1", robot.getPort()));
+    client.subscribe(0);
+    sleepMs(50);
+
+    // Round trips
+    std::vector<double> ping = measurePing(client, 200);
+    CHECK(ping.size() == 200);
+    printRtt("ping", ping, 200);
+
+    LanCommand command = {};
+    command.fields = LAN_FIELD_LIGHT_LEFT | LAN_FIELD_ROUTE;
+    command.lightadj_left = 40;
+    command.route_destination = 3;
+    std::vector<double> applied = measureCommand(client, 40, command);
+    CHECK(applied.size() == 40);
+    CHECK(percentiles(applied).p99 < 100000);
+    printRtt("command -> ack", applied, 40);
+
+    // Only the masked fields change
+    FirebaseRxData state = robot.commandState();
+    CHECK(state.lightadj_left == 40);
+    CHECK(state.route_destination == 3);
+    CHECK(state.lightadj_right == 0);
+    CHECK(!state.buzzer01ring);
+
+    // Snapshot rate, capped at LAN_SNAPSHOT_MAX_HZ
+    int at50 = countSnapshots(client, 50, 1000);
+    int at10 = countSnapshots(client, 10, 1000);
+    int capped = countSnapshots(client, 200, 1000);
+    printf("snapshots        %d/s at 50 Hz, %d/s at 10 Hz, %d/s asking for 200 Hz\n", at50, at10, capped);
+    CHECK(at50 >= 40 && at50 <= 52);
+    CHECK(at10 >= 8 && at10 <= 11);
+    CHECK(capped <= 52);
+
+    std::vector<uint8_t> message;
+    CHECK(client.waitFor(LAN_SNAPSHOT, message, 200));
+    CHECK(message.size() == sizeof(LanSnapshot));
+    CHECK(message.size() > 1 && message[1] == LAN_PROTOCOL_VERSION);
+    client.subscribe(0);
+    sleepMs(1000 / LAN_COMMAND_RATE * LAN_COMMAND_BURST + 100);     // Bucket refilled
+
+    // A burst past LAN_COMMAND_BURST is refused, not queued
+    int acked = 0, limited = 0;
+    for (int i = 0; i < LAN_COMMAND_BURST * 2; i++) client.sendCommand(command);
+    for (int i = 0; i < LAN_COMMAND_BURST * 2; i++) {
+        if (!client.waitFor(LAN_COMMAND_ACK, message, 500)) break;
+        LanCommandAck ack;
+        memcpy(&ack, message.data(), sizeof(ack));
+        if (ack.status == LAN_ACK_APPLIED) acked++;
+        if (ack.status == LAN_ACK_RATE_LIMITED) limited++;
+    }
+    printf("burst of %d      %d applied, %d rate limited\n", LAN_COMMAND_BURST * 2, acked, limited);
+    CHECK(acked == LAN_COMMAND_BURST);
+    CHECK(limited == LAN_COMMAND_BURST);
+    sleepMs(1000 / LAN_COMMAND_RATE * LAN_COMMAND_BURST + 100);
+
+    // Unknown field bits and wrong sizes
+    LanCommand bad = {};
+    bad.fields = 0x8000;
+    uint16_t badSeq = client.sendCommand(bad);
+    CHECK(client.waitFor(LAN_COMMAND_ACK, message, 500));
+    LanCommandAck badAck;
+    memcpy(&badAck, message.data(), sizeof(badAck));
+    CHECK(badAck.seq == badSeq && badAck.status == LAN_ACK_MALFORMED);
+    uint8_t shortPing[3] = {LAN_PING, 1, 2};
+    client.sendRaw(shortPing, sizeof(shortPing));
+    CHECK(!client.waitFor(LAN_PONG, message, 200));
+    CHECK(measurePing(client, 1).size() == 1);      // Still served after both
+
+    // Client limit - one more than LAN_MAX_CLIENTS is closed with 1013
+    std::vector<std::unique_ptr<TestClient>> extra;
+    for (int i = 1; i < LAN_MAX_CLIENTS; i++) {
+        extra.emplace_back(new TestClient());
+        CHECK(extra.back()->connect("127.0.0.1", robot.getPort()));
+    }
+    sleepMs(50);
+    TestClient overflow;
+    CHECK(overflow.connect("127.0.0.1", robot.getPort()));
+    CHECK(overflow.waitForClose(1000) == 1013);
+
+    // A slot frees up when a client leaves
+    extra.back()->disconnect();
+    sleepMs(250);
+    TestClient replacement;
+    CHECK(replacement.connect("127.0.0.1", robot.getPort()));
+    replacement.subscribe(0);
+    CHECK(measurePing(replacement, 1).size() == 1);
+
+    replacement.disconnect();
+    for (auto& c : extra) c->disconnect();
+    client.disconnect();
+    overflow.disconnect();
+    robot.stop();
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        return runAgainst(argv[1], argc > 2 ? (uint16_t)atoi(argv[2]) : 80);
+    }
+
+    testStandIn();
+
+    if (failures) {
+        printf("lan_socket_test: %d checks failed\n", failures);
+        return 1;
+    }
+    printf("lan_socket_test: all checks passed\n");
+    return 0;
+}
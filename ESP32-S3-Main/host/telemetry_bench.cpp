@@ -0,0 +1,381 @@
+// Host benchmark for telemetry serialization.
+//
+// Compares JsonWriter + writeTelemetry() - the text FirebaseManager::upload()
+// sends as it is over the REST API - with the path it replaced: a FirebaseJson
+// built with one set() per field, then printed by the client library. FirebaseJson doesn't build off the board, so DomJson below
+// stands in for it - a node per set() with its own copy of the key, numbers
+// held as double and printed like cJSON, the text grown in a heap buffer and
+// copied into a string at the end. The library does at least that much
+// (it also splits every key into path segments), so the baseline numbers
+// are a floor.
+//
+// Allocations are counted by wrapping malloc/free (glibc), so anything on
+// the heap is seen, C or C++. The request itself isn't measured: on either
+// path HTTPClient and TLS allocate a fixed few buffers per request, however
+// many fields it carries.
+//
+//   telemetry_bench            full run
+//   telemetry_bench --quick    fewer iterations, for ctest
+//
+// Exit code 0 when the writer never allocates, never overflows and every
+// payload matches the baseline's text value for value.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "communication/telemetry_fields.h"
+#include "communication/json_writer.h"
+#include "sensors/color_type.h"
+
+// ---------------------------------------------------------------------------
+// Heap accounting
+
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+extern "C" void __libc_free(void*);
+
+static size_t allocCount = 0;
+static size_t allocBytes = 0;
+
+extern "C" void* malloc(size_t size) {
+    allocCount++;
+    allocBytes += size;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size) {
+    allocCount++;
+    allocBytes += n * size;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* p, size_t size) {
+    allocCount++;
+    allocBytes += size;
+    return __libc_realloc(p, size);
+}
+
+extern "C" void free(void* p) {
+    __libc_free(p);
+}
+
+// ---------------------------------------------------------------------------
+// Baseline - FirebaseJson stand-in
+
+class DomJson {
+private:
+    struct Node {
+        char* key;
+        bool text;
+        double number;
+        char* string;
+        Node* next;
+    };
+    Node* head = nullptr;
+    Node* tail = nullptr;
+
+    static char* copy(const char* s) {
+        size_t n = strlen(s) + 1;
+        char* out = (char*)malloc(n);
+        memcpy(out, s, n);
+        return out;
+    }
+
+    void append(Node* node) {
+        if (tail) tail->next = node;
+        else head = node;
+        tail = node;
+    }
+
+public:
+    ~DomJson() { clear(); }
+
+    void clear() {
+        while (head) {
+            Node* next = head->next;
+            free(head->key);
+            free(head->string);
+            delete head;
+            head = next;
+        }
+        tail = nullptr;
+    }
+
+    void set(const char* key, double value) {
+        append(new Node{copy(key), false, value, nullptr, nullptr});
+    }
+
+    void set(const char* key, const std::string& value) {
+        append(new Node{copy(key), true, 0, copy(value.c_str()), nullptr});
+    }
+
+    std::string toString() const {
+        size_t capacity = 64, length = 0;
+        char* out = (char*)malloc(capacity);
+        auto put = [&](const char* s) {
+            size_t n = strlen(s);
+            while (length + n + 1 > capacity) {
+                capacity *= 2;
+                out = (char*)realloc(out, capacity);
+            }
+            memcpy(out + length, s, n + 1);
+            length += n;
+        };
+
+        char number[32];
+        put("{");
+        for (Node* node = head; node; node = node->next) {
+            if (node != head) put(",");
+            put("\"");
+            put(node->key);
+            put("\":");
+            if (node->text) {
+                put("\"");
+                put(node->string);
+                put("\"");
+            } else {
+                // cJSON: 15 significant digits, 17 if that doesn't read back the same
+                snprintf(number, sizeof(number), "%1.15g", node->number);
+                if (strtod(number, nullptr) != node->number) snprintf(number, sizeof(number), "%1.17g", node->number);
+                put(number);
+            }
+        }
+        put("}");
+
+        std::string result(out, length);
+        free(out);
+        return result;
+    }
+};
+
+// The old monitorColor(): a String from colorTypeToString() every pass, compared and copied out
+static std::string oldColourName(int type, std::string& last) {
+    std::string detected = colorTypeToString(type);
+    if (detected != last) last = detected;
+    return last;
+}
+
+static std::string baselineSnapshot(DomJson& json, const FirebaseTxData& d, TelemetryFieldMask mask, std::string& lastColour) {
+    json.clear();
+    for (size_t i = 0; i < TELEMETRY_FIELD_COUNT; i++) {
+        if (!(mask & ((TelemetryFieldMask)1 << i))) continue;
+        const TelemetryField& field = TELEMETRY_FIELDS[i];
+        const uint8_t* base = (const uint8_t*)&d + field.offset;
+        switch (field.type) {
+            case FIELD_INT:    json.set(field.key, *(const int*)base); break;
+            case FIELD_FLOAT:  json.set(field.key, *(const float*)base); break;
+            case FIELD_COLOUR: json.set(field.key, oldColourName(*(const int*)base, lastColour)); break;
+        }
+    }
+    return json.toString();
+}
+
+// ---------------------------------------------------------------------------
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { printf("FAIL %s:%d  %s\n", __FILE__, __LINE__, #cond); failures++; } \
+} while (0)
+
+static double nowNs() {
+    using namespace std::chrono;
+    return duration<double, std::nano>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Same text apart from how numbers are printed - the writer keeps 2 decimals
+static bool sameValues(const char* a, const char* b) {
+    while (*a && *b) {
+        bool numA = (*a == '-' || (*a >= '0' && *a <= '9'));
+        bool numB = (*b == '-' || (*b >= '0' && *b <= '9'));
+        if (numA && numB) {
+            char* endA;
+            char* endB;
+            double va = strtod(a, &endA);
+            double vb = strtod(b, &endB);
+            if (fabs(va - vb) > 0.0051) return false;
+            a = endA;
+            b = endB;
+            continue;
+        }
+        if (*a++ != *b++) return false;
+    }
+    return *a == *b;
+}
+
+static FirebaseTxData sampleSnapshot(int i) {
+    FirebaseTxData d;
+    memset(&d, 0, sizeof(d));
+    d.acceleration = 0.37f + (i % 7) * 0.11f;
+    d.angular = -3 + i % 5;
+    d.battery = 87;
+    d.voltage = 11.92f;
+    d.temp = 27;
+    d.humidity = 61;
+    d.lightlevel = 512 + i % 40;
+    d.hr = 74;
+    d.sp02 = 98;
+    d.ultrasonic_center = 143 - i % 9;
+    d.ultrasonic_left = 37;
+    d.ultrasonic_rear = 250;
+    d.ultrasonic_right = 41 + i % 3;
+    d.colour = (i % 3 == 0) ? COLOR_BLUE : COLOR_UNKNOWN;
+    d.compartment = 255;
+    d.link_rtt_p50 = 1.84f;
+    d.link_rtt_p99 = 3.21f;
+    d.link_rtt_max = 6.70f;
+    d.link_baud = 921600;
+    d.link_estop_ms = 2.25f;
+    d.link_estop_max_ms = 4.5f;
+    d.link_apply_ms = 1.125f;
+    d.link_clock_err_us = 180;
+    d.motor_duty_lf = 42;
+    d.motor_duty_lb = 42;
+    d.motor_duty_rf = -38;
+    d.motor_duty_rb = -38;
+    d.motor_exec_max = 310;
+    d.net_tx_ms = 95 + i % 30;
+    d.net_rx_ms = 12;
+    d.net_queue_max = 1;
+    d.net_tx_kb = 1000 + i;
+    d.net_store_fill = 3;
+    return d;
+}
+
+struct Result {
+    double ns;
+    double allocs;
+    double heapBytes;
+    size_t bytes;
+};
+
+static void report(const char* name, const Result& old, const Result& now) {
+    printf("%-22s %8s %10s %10s %12s\n", name, "bytes", "ns/op", "allocs/op", "heap B/op");
+    printf("  %-20s %8zu %10.0f %10.1f %12.0f\n", "FirebaseJson (old)", old.bytes, old.ns, old.allocs, old.heapBytes);
+    printf("  %-20s %8zu %10.0f %10.1f %12.0f\n", "JsonWriter", now.bytes, now.ns, now.allocs, now.heapBytes);
+}
+
+int main(int argc, char** argv) {
+    bool quick = (argc > 1 && strcmp(argv[1], "--quick") == 0);
+    const int iterations = quick ? 2000 : 100000;
+
+    static char buffer[16384];
+    DomJson dom;
+    std::string lastColour = "UNKNOWN";
+    volatile size_t sink = 0;
+
+    // A full snapshot, a typical 2 s delta, and a 10-snapshot backfill batch
+    const TelemetryFieldMask delta = (1ull << 0) | (1ull << 1) | (1ull << 6) | (1ull << 9) |
+                                     (1ull << 12) | (1ull << 13) | (1ull << 38) | (1ull << 44);
+
+    struct Case { const char* name; TelemetryFieldMask mask; int records; };
+    const Case cases[] = {
+        {"full snapshot", TELEMETRY_ALL_FIELDS, 1},
+        {"delta (8 fields)", delta, 1},
+        {"backfill x10", TELEMETRY_ALL_FIELDS, 10},
+    };
+
+    for (const Case& c : cases) {
+        Result old = {}, now = {};
+
+        // Baseline - one tree per snapshot, as the old sendData built them
+        size_t startCount = allocCount, startBytes = allocBytes;
+        double start = nowNs();
+        for (int i = 0; i < iterations; i++) {
+            size_t bytes = 0;
+            for (int r = 0; r < c.records; r++) {
+                std::string text = baselineSnapshot(dom, sampleSnapshot(i + r), c.mask, lastColour);
+                bytes += text.size();
+            }
+            old.bytes = bytes;
+            sink = sink + bytes;
+        }
+        old.ns = (nowNs() - start) / iterations;
+        old.allocs = (double)(allocCount - startCount) / iterations;
+        old.heapBytes = (double)(allocBytes - startBytes) / iterations;
+
+        // Writer
+        startCount = allocCount;
+        startBytes = allocBytes;
+        start = nowNs();
+        bool overflow = false;
+        for (int i = 0; i < iterations; i++) {
+            JsonWriter json(buffer, sizeof(buffer));
+            if (c.records == 1) {
+                writeTelemetry(json, NULL, sampleSnapshot(i), c.mask);
+            } else {
+                // As sendBacklog: {"<slot>": {"t": epoch ms, fields}, ...}
+                char key[12];
+                json.beginObject();
+                for (int r = 0; r < c.records; r++) {
+                    snprintf(key, sizeof(key), "%d", (i + r) % 10800);
+                    json.beginObject(key);
+                    json.addInt("t", 1760000000000ll + (int64_t)(i + r) * 2000);
+                    writeTelemetryFields(json, sampleSnapshot(i + r), c.mask);
+                    json.endObject();
+                }
+                json.endObject();
+            }
+            overflow |= !json.ok();
+            now.bytes = json.size();
+            sink = sink + json.size();
+        }
+        now.ns = (nowNs() - start) / iterations;
+        now.allocs = (double)(allocCount - startCount) / iterations;
+        now.heapBytes = (double)(allocBytes - startBytes) / iterations;
+
+        report(c.name, old, now);
+        CHECK(now.allocs == 0);
+        CHECK(!overflow);
+    }
+
+    // Same content both ways, snapshot by snapshot
+    for (int i = 0; i < 50; i++) {
+        FirebaseTxData d = sampleSnapshot(i);
+        d.acceleration = -1.005f * i;
+        d.voltage = (float)i / 3;
+        std::string old = baselineSnapshot(dom, d, TELEMETRY_ALL_FIELDS, lastColour);
+        JsonWriter json(buffer, sizeof(buffer));
+        writeTelemetry(json, NULL, d);
+        CHECK(json.ok());
+        CHECK(sameValues(old.c_str(), json.c_str()));
+    }
+
+    // Writer edge cases
+    {
+        char small[16];
+        JsonWriter json(small, sizeof(small));
+        json.beginObject();
+        json.addText("key", "a longer value than fits");
+        json.endObject();
+        CHECK(!json.ok());
+        CHECK(json.size() < sizeof(small));
+        CHECK(strlen(json.c_str()) == json.size());
+
+        JsonWriter values(buffer, sizeof(buffer));
+        values.beginObject();
+        values.addFloat("a", -0.004f);
+        values.addFloat("b", 2.5f, 0);
+        values.addFloat("c", NAN);
+        values.addInt("d", -2147483648ll);
+        values.addText("e", "q\"\\\n");
+        values.beginArray("f");
+        values.addInt(NULL, 1);
+        values.addInt(NULL, 2);
+        values.endArray();
+        values.endObject();
+        CHECK(strcmp(values.c_str(), "{\"a\":0.00,\"b\":3,\"c\":null,\"d\":-2147483648,\"e\":\"q\\\"\\\\\\u000a\",\"f\":[1,2]}") == 0);
+    }
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
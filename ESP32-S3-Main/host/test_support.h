@@ -0,0 +1,50 @@
+// Shared by the host tests: the check macro and its failure count, clocks,
+// and a blocking send over a socket.
+
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include <sys/socket.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { printf("FAIL %s:%d  %s\n", __FILE__, __LINE__, #cond); failures++; } \
+} while (0)
+
+static inline uint32_t nowMs() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static inline double nowUs() {
+    using namespace std::chrono;
+    return duration<double, std::micro>(steady_clock::now().time_since_epoch()).count();
+}
+
+static inline void sleepMs(int ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+static inline bool sendAll(int fd, const void* data, size_t len) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = send(fd, bytes + sent, len - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+static inline bool sendAll(int fd, const std::string& text) {
+    return sendAll(fd, text.data(), text.size());
+}
+
+#endif
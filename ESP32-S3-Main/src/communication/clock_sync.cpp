@@ -0,0 +1,111 @@
+#include "clock_sync.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Residual error growth once the drift has been measured and is corrected for
+#define CLOCK_RESIDUAL_PPM 2
+
+ClockSync::ClockSync() {
+    steps = 0;
+    reset();
+}
+
+void ClockSync::reset() {
+    memset(samples, 0, sizeof(samples));
+    count = 0;
+    next = 0;
+    best = {0, 0, UINT32_MAX};
+    anchor = best;
+    anchored = false;
+    driftPpm = 0.0f;
+    driftKnown = false;
+}
+
+bool ClockSync::addSample(uint32_t t1, uint32_t t2, uint32_t t3, uint32_t t4) {
+    // Round trip minus the time the WROOM held the probe
+    int32_t delay = (int32_t)((t4 - t1) - (t3 - t2));
+    if (delay < 0 || t4 - t1 > 1000000UL) return false;
+
+    Sample sample;
+    sample.mainUs = t1 + (t4 - t1) / 2;
+    sample.offsetUs = (t2 - t1) - (uint32_t)(delay / 2);
+    sample.delayUs = (uint32_t)delay;
+
+    // A jump far beyond what drift and path delay explain - the WROOM rebooted
+    if (isSynced()) {
+        int32_t jump = (int32_t)(sample.offsetUs - (uint32_t)offsetAt(sample.mainUs));
+        if ((uint32_t)abs(jump) > CLOCK_STEP_US + sample.delayUs) {
+            reset();
+            steps++;
+        }
+    }
+
+    samples[next] = sample;
+    next = (next + 1) % CLOCK_SYNC_WINDOW;
+    if (count < CLOCK_SYNC_WINDOW) count++;
+
+    selectBest(sample.mainUs);
+    updateDrift();
+    return true;
+}
+
+uint32_t ClockSync::dispersionUs(uint32_t ageUs) const {
+    uint32_t ppm = driftKnown ? CLOCK_RESIDUAL_PPM : CLOCK_DISPERSION_PPM;
+    return (uint32_t)((uint64_t)ageUs * ppm / 1000000UL);
+}
+
+void ClockSync::selectBest(uint32_t now) {
+    // Shortest round trip wins, with older probes penalised for the drift since
+    uint32_t bestScore = UINT32_MAX;
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t score = samples[i].delayUs / 2 + dispersionUs(now - samples[i].mainUs);
+        if (score < bestScore) {
+            bestScore = score;
+            best = samples[i];
+        }
+    }
+}
+
+void ClockSync::updateDrift() {
+    // The anchor's offset error goes straight into the drift, so it is only
+    // taken from a synced estimate, and swapped for a tighter probe while the
+    // span is still building up
+    if (!anchored) {
+        if (!isSynced()) return;
+        anchor = best;
+        anchored = true;
+        return;
+    }
+
+    uint32_t span = best.mainUs - anchor.mainUs;
+    if (span < CLOCK_DRIFT_SPAN_US) {
+        if (best.delayUs < anchor.delayUs) anchor = best;
+        return;
+    }
+
+    float measured = (int32_t)(best.offsetUs - anchor.offsetUs) * 1e6f / (float)span;
+    driftPpm = driftKnown ? (0.7f * driftPpm + 0.3f * measured) : measured;
+    driftKnown = true;
+    anchor = best;
+}
+
+int32_t ClockSync::offsetAt(uint32_t mainUs) const {
+    int32_t age = (int32_t)(mainUs - best.mainUs);
+    return (int32_t)best.offsetUs + (int32_t)(driftPpm * age / 1e6f);
+}
+
+uint32_t ClockSync::toMotorTime(uint32_t mainUs) const {
+    return mainUs + (uint32_t)offsetAt(mainUs);
+}
+
+uint32_t ClockSync::toMainTime(uint32_t motorUs) const {
+    // Drift is evaluated at the S3 time the uncorrected offset points to - close enough
+    uint32_t approx = motorUs - best.offsetUs;
+    return motorUs - (uint32_t)offsetAt(approx);
+}
+
+uint32_t ClockSync::getErrorUs(uint32_t mainUs) const {
+    if (!isSynced()) return UINT32_MAX;
+    int32_t age = (int32_t)(mainUs - best.mainUs);
+    return best.delayUs / 2 + dispersionUs((uint32_t)abs(age));
+}
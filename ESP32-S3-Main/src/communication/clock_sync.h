@@ -0,0 +1,63 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <stdint.h>
+
+#define CLOCK_SYNC_WINDOW 8         // Recent probes the best one is picked from
+#define CLOCK_SYNC_MIN_SAMPLES 4    // Probes before the estimate is trusted
+#define CLOCK_DRIFT_SPAN_US 30000000UL  // Minimum baseline for a drift measurement
+#define CLOCK_DISPERSION_PPM 20     // Assumed error growth of an old sample before drift is known
+#define CLOCK_STEP_US 5000          // Offset jump that means the WROOM restarted
+
+/*
+    Offset and drift of the WROOM's microsecond clock against micros(), from
+    NTP-style probes (t1 S3 send, t2 WROOM receive, t3 WROOM send, t4 S3
+    receive). Of the last CLOCK_SYNC_WINDOW probes the one with the shortest
+    round trip is used - its offset error is at most half that round trip,
+    and a probe delayed by a slow loop pass on either board never wins.
+
+    All times are 32-bit and wrap every 71 minutes; only differences are
+    used, so the wrap is harmless as long as probes keep coming.
+*/
+class ClockSync {
+private:
+    struct Sample {
+        uint32_t mainUs;        // Midpoint of t1..t4 on the S3 clock
+        uint32_t offsetUs;      // WROOM minus S3, modulo 2^32
+        uint32_t delayUs;       // Round trip without the WROOM's turnaround
+    };
+
+    Sample samples[CLOCK_SYNC_WINDOW];
+    uint8_t count;
+    uint8_t next;
+
+    Sample best;
+    float driftPpm;             // WROOM clock rate minus S3 clock rate
+    bool driftKnown;
+    Sample anchor;              // Older best sample the drift is measured against
+    bool anchored;
+    uint32_t steps;
+
+    void selectBest(uint32_t now);
+    void updateDrift();
+    int32_t offsetAt(uint32_t mainUs) const;
+    uint32_t dispersionUs(uint32_t ageUs) const;
+
+public:
+    ClockSync();
+    void reset();
+
+    // false when the probe was discarded
+    bool addSample(uint32_t t1, uint32_t t2, uint32_t t3, uint32_t t4);
+
+    bool isSynced() const { return count >= CLOCK_SYNC_MIN_SAMPLES; }
+    uint32_t toMotorTime(uint32_t mainUs) const;
+    uint32_t toMainTime(uint32_t motorUs) const;
+
+    int32_t getOffsetUs() const { return (int32_t)best.offsetUs; }
+    float getDriftPpm() const { return driftPpm; }
+    uint32_t getErrorUs(uint32_t mainUs) const;   // Bound on the mapping error at that time
+    uint32_t getSteps() const { return steps; }     // WROOM restarts detected
+};
+
+#endif
@@ -0,0 +1,200 @@
+#include "command_stream.h"
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+struct CommandField {
+    const char* name;
+    size_t offset;
+    bool isBool;
+};
+
+#define COMMAND_FIELD(name, isBool) { #name, offsetof(FirebaseRxData, name), isBool }
+
+// In CommandFieldBit order - entry i is bit i
+static const CommandField COMMAND_FIELDS[] = {
+    COMMAND_FIELD(buzzer01ring, true),
+    COMMAND_FIELD(buzzer02ring, true),
+    COMMAND_FIELD(buzzersound, false),
+    COMMAND_FIELD(lightadj_left, false),
+    COMMAND_FIELD(lightadj_right, false),
+    COMMAND_FIELD(colour_start, true),
+    COMMAND_FIELD(compartment_start, true),
+    COMMAND_FIELD(heartrate_start, true),
+    COMMAND_FIELD(ultrasonic_start, true),
+    COMMAND_FIELD(route_destination, false),
+};
+
+static const size_t COMMAND_FIELD_COUNT = sizeof(COMMAND_FIELDS) / sizeof(COMMAND_FIELDS[0]);
+static_assert(COMMAND_ALL == (1 << COMMAND_FIELD_COUNT) - 1, "CommandFieldBit and COMMAND_FIELDS out of step");
+
+static const CommandField* findField(const char* name, size_t length) {
+    for (size_t i = 0; i < COMMAND_FIELD_COUNT; i++) {
+        if (strlen(COMMAND_FIELDS[i].name) == length && strncmp(COMMAND_FIELDS[i].name, name, length) == 0) {
+            return &COMMAND_FIELDS[i];
+        }
+    }
+    return nullptr;
+}
+
+static int readField(const FirebaseRxData& state, const CommandField& field) {
+    const uint8_t* base = (const uint8_t*)&state + field.offset;
+    return field.isBool ? *(const bool*)base : *(const int*)base;
+}
+
+static void writeField(FirebaseRxData& state, const CommandField& field, int value) {
+    uint8_t* base = (uint8_t*)&state + field.offset;
+    if (field.isBool) {
+        *(bool*)base = (value != 0);
+    } else {
+        *(int*)base = value;
+    }
+}
+
+static const char* skipSpace(const char* p) {
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+    return p;
+}
+
+// p on the opening quote; returns just past the closing one, nullptr if unterminated
+static const char* skipString(const char* p) {
+    p++;
+    while (*p && *p != '"') {
+        if (*p == '\\' && p[1]) p++;
+        p++;
+    }
+    return *p ? p + 1 : nullptr;
+}
+
+// Past one value of any kind, nullptr when malformed
+static const char* skipValue(const char* p) {
+    if (*p == '"') return skipString(p);
+
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (*p) {
+            if (*p == '"') {
+                p = skipString(p);
+                if (!p) return nullptr;
+                continue;
+            }
+            if (*p == '{' || *p == '[') {
+                depth++;
+            } else if (*p == '}' || *p == ']') {
+                if (--depth == 0) return p + 1;
+            }
+            p++;
+        }
+        return nullptr;
+    }
+
+    // Literal or number
+    const char* start = p;
+    while (*p && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\r' && *p != '\n') p++;
+    return (p > start) ? p : nullptr;
+}
+
+// true / false / null / number - false for strings, objects and garbage
+static bool parseScalar(const char* p, const char** end, int& value) {
+    if (strncmp(p, "true", 4) == 0)  { value = 1; *end = p + 4; return true; }
+    if (strncmp(p, "false", 5) == 0) { value = 0; *end = p + 5; return true; }
+    if (strncmp(p, "null", 4) == 0)  { value = 0; *end = p + 4; return true; }   // Deleted key
+
+    if (*p != '-' && (*p < '0' || *p > '9')) return false;
+    char* numberEnd;
+    double number = strtod(p, &numberEnd);
+    if (numberEnd == p || !isfinite(number) || number > 2147483647.0 || number < -2147483648.0) return false;
+    value = (int)number;
+    *end = numberEnd;
+    return true;
+}
+
+// Flat object of commands; unknown keys and non-scalar values are skipped
+static bool parseObject(const char* p, FirebaseRxData& state) {
+    if (*p != '{') return false;
+    p = skipSpace(p + 1);
+    if (*p == '}') return true;
+
+    while (true) {
+        if (*p != '"') return false;
+        const char* key = p + 1;
+        const char* keyEnd = skipString(p);
+        if (!keyEnd) return false;
+
+        p = skipSpace(keyEnd);
+        if (*p != ':') return false;
+        p = skipSpace(p + 1);
+
+        const CommandField* field = findField(key, keyEnd - 1 - key);
+        const char* end;
+        int value;
+        if (field && parseScalar(p, &end, value)) {
+            writeField(state, *field, value);
+            p = end;
+        } else {
+            p = skipValue(p);
+            if (!p) return false;
+        }
+
+        p = skipSpace(p);
+        if (*p == ',') {
+            p = skipSpace(p + 1);
+            continue;
+        }
+        return *p == '}';
+    }
+}
+
+void mergeCommands(FirebaseRxData& into, const FirebaseRxData& from, uint16_t fields) {
+    for (size_t i = 0; i < COMMAND_FIELD_COUNT; i++) {
+        if (fields & (1 << i)) writeField(into, COMMAND_FIELDS[i], readField(from, COMMAND_FIELDS[i]));
+    }
+}
+
+CommandStream::CommandStream() {
+    reset();
+    changed = 0;
+    events = 0;
+    rejected = 0;
+}
+
+void CommandStream::reset() {
+    memset(&state, 0, sizeof(state));
+}
+
+bool CommandStream::apply(CommandEvent event, const char* path, const char* data) {
+    if (path == nullptr || data == nullptr || path[0] != '/') {
+        rejected++;
+        return false;
+    }
+    events++;
+
+    // Built on a copy - a malformed event changes nothing
+    FirebaseRxData next = state;
+    const char* p = skipSpace(data);
+    bool ok;
+
+    if (path[1] == '\0') {
+        if (event == COMMAND_PUT) memset(&next, 0, sizeof(next));
+        ok = (strncmp(p, "null", 4) == 0) ? (event == COMMAND_PUT) : parseObject(p, next);
+    } else {
+        // One command, "/buzzer01ring" - deeper paths aren't commands
+        const CommandField* field = strchr(path + 1, '/') ? nullptr : findField(path + 1, strlen(path + 1));
+        const char* end;
+        int value;
+        ok = field && event == COMMAND_PUT && parseScalar(p, &end, value) && *skipSpace(end) == '\0';
+        if (ok) writeField(next, *field, value);
+    }
+
+    changed = 0;
+    if (!ok) {
+        rejected++;
+        return false;
+    }
+
+    for (size_t i = 0; i < COMMAND_FIELD_COUNT; i++) {
+        if (readField(next, COMMAND_FIELDS[i]) != readField(state, COMMAND_FIELDS[i])) changed |= (1 << i);
+    }
+    state = next;
+    return changed != 0;
+}
@@ -0,0 +1,75 @@
+#ifndef COMMAND_STREAM_H
+#define COMMAND_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Dashboard commands, kept under FIREBASE_COMMAND_PATH
+struct FirebaseRxData {
+    // Sensor and Actuator control - RECEIVE ONLY
+    bool buzzer01ring;         // Receive signal to ring buzzer 1
+    bool buzzer02ring;         // Receive signal to ring buzzer 2
+    int buzzersound;           // Receive buzzer volume control
+    int lightadj_left;         // Receive left LED brightness adjustment
+    int lightadj_right;        // Receive right LED brightness adjustment
+    bool colour_start;         // Receive signal to start color detection
+    bool compartment_start;    // Receive signal to start compartment LDR check
+    bool heartrate_start;      // Receive signal to start heart rate sensor
+    bool ultrasonic_start;     // Receive signal to start ultrasonic sensors
+    int route_destination;     // Receive station ID to deliver to (0 = none)
+};
+
+// One bit per FirebaseRxData field, in declaration order - LanCommand::fields uses the same bits
+enum CommandFieldBit : uint16_t {
+    COMMAND_BUZZER01            = 1 << 0,
+    COMMAND_BUZZER02            = 1 << 1,
+    COMMAND_BUZZER_SOUND        = 1 << 2,
+    COMMAND_LIGHT_LEFT          = 1 << 3,
+    COMMAND_LIGHT_RIGHT         = 1 << 4,
+    COMMAND_COLOUR_START        = 1 << 5,
+    COMMAND_COMPARTMENT_START   = 1 << 6,
+    COMMAND_HEARTRATE_START     = 1 << 7,
+    COMMAND_ULTRASONIC_START    = 1 << 8,
+    COMMAND_ROUTE               = 1 << 9,
+    COMMAND_ALL                 = (1 << 10) - 1
+};
+
+// The fields of from in the mask into into - the rest are left as they are
+void mergeCommands(FirebaseRxData& into, const FirebaseRxData& from, uint16_t fields);
+
+enum CommandEvent : uint8_t {
+    COMMAND_PUT,               // Replaces whatever is at the path
+    COMMAND_PATCH              // Updates only the keys it lists
+};
+
+/*
+    Folds Firebase RTDB stream events for the commands subtree into a
+    FirebaseRxData. A put at the root is the whole command set - sent first
+    on every (re)connect - so keys it leaves out go back to 0 / false, the
+    same as a deleted key. Paths deeper than one key are ignored.
+
+    Data is the raw JSON text of the event. Only the flat objects and
+    scalars the dashboard writes are understood; no Arduino dependencies,
+    so the host test builds it as it is.
+*/
+class CommandStream {
+private:
+    FirebaseRxData state;
+    uint16_t changed;           // CommandFieldBit bits the last apply() changed
+    uint32_t events;
+    uint32_t rejected;          // Malformed data or unknown paths
+
+public:
+    CommandStream();
+    void reset();
+
+    // true when the event changed at least one command
+    bool apply(CommandEvent event, const char* path, const char* data);
+
+    const FirebaseRxData& getState() const { return state; }
+    uint16_t getChanged() const { return changed; }
+    uint32_t getEvents() const { return events; }
+    uint32_t getRejected() const { return rejected; }
+};
+
+#endif
@@ -1,7 +1,23 @@
 #include "firebase_manager.h"
+#include "telemetry_store.h"
+#include "../config/constants.h"
 #include "../utils/logger.h"
 
-FirebaseManager::FirebaseManager() : initialized(false) {}
+FirebaseManager::FirebaseManager() : initialized(false) {
+    memset(&lastSent, 0, sizeof(lastSent));
+    haveSent = false;
+    lastFullSend = 0;
+    txBytes = 0;
+    txBuffer = NULL;
+    restUri = NULL;
+    restHost[0] = '\0';
+
+    streaming = false;
+    streamRetryTime = 0;
+    streamRetryMs = FIREBASE_STREAM_RETRY_MS;
+    streamConnects = 0;
+    streamErrors = 0;
+}
 
 void FirebaseManager::begin(const char* apiKey,
                             const char* databaseUrl,
@@ -14,6 +30,29 @@ void FirebaseManager::begin(const char* apiKey,
     auth.user.email = userEmail;
     auth.user.password = userPassword;
 
+    // Every upload is written here - allocated once, PSRAM when there is some
+    if (txBuffer == NULL) {
+        txBuffer = psramFound() ? (char*)ps_malloc(TELEMETRY_JSON_BUFFER) : NULL;
+        if (txBuffer == NULL) txBuffer = (char*)malloc(TELEMETRY_JSON_BUFFER);
+        if (txBuffer == NULL) Log.println("Firebase: no memory for the upload buffer");
+    }
+    if (restUri == NULL) {
+        restUri = (char*)malloc(FIREBASE_REST_URI_MAX);
+        if (restUri == NULL) Log.println("Firebase: no memory for the request URI");
+    }
+
+    // "https://<host>/" -> "<host>"
+    const char* host = databaseUrl;
+    if (strncmp(host, "https://", 8) == 0) host += 8;
+    strlcpy(restHost, host, sizeof(restHost));
+    size_t hostLength = strlen(restHost);
+    if (hostLength > 0 && restHost[hostLength - 1] == '/') restHost[hostLength - 1] = '\0';
+
+    // No certificate pinned, as the Firebase client runs without one
+    restClient.setInsecure();
+    rest.setReuse(true);
+    rest.setTimeout(FIREBASE_REST_TIMEOUT_MS);
+
     // Non-blocking initialization - authentication happens asynchronously
     Firebase.begin(&config, &auth);
     Firebase.reconnectWiFi(true);
@@ -28,94 +67,174 @@ void FirebaseManager::update() {
     
 }
 
-bool FirebaseManager::sendData(const FirebaseTxData& d) {
-    if (!ready()) return false;
-
-    FirebaseJson json;
-
-    // Sensors - SEND ONLY
-    json.set("acceleration", d.acceleration);
-    json.set("angular", d.angular);
-    json.set("battery", d.battery);
-    json.set("voltage", d.voltage);
+bool FirebaseManager::upload(const char* path, const JsonWriter& json, bool replace) {
+    if (!json.ok()) {
+        Log.print("Firebase TX skipped, JSON larger than the buffer: ");
+        Log.println(path);
+        return false;
+    }
+    if (restUri == NULL) return false;
+
+    // The client library only takes a FirebaseJson, which parses the text into
+    // a tree of nodes and prints it back out - the REST API takes it as it is.
+    // print=silent: 204 and no echo of what was written.
+    int length = snprintf(restUri, FIREBASE_REST_URI_MAX, "%s.json?print=silent&auth=%s",
+                          path, Firebase.getToken());
+    if (length < 0 || length >= FIREBASE_REST_URI_MAX) {
+        Log.println("Firebase TX skipped, request URI too long");
+        return false;
+    }
 
-    // Environment - SEND ONLY
-    json.set("temp", d.temp);
-    json.set("humidity", d.humidity);
-    json.set("lightlevel", d.lightlevel);
+    rest.begin(restClient, restHost, 443, restUri, true);
+    rest.addHeader("Content-Type", "application/json");
+    int code = rest.sendRequest(replace ? "PUT" : "PATCH", (uint8_t*)json.c_str(), json.size());
+    bool ok = (code == 200 || code == 204);
+    if (!ok) {
+        Log.print("Firebase TX failed (");
+        Log.print(path);
+        Log.print("): ");
+        if (code < 0) Log.println(HTTPClient::errorToString(code));
+        else Log.println(rest.getString());
+    }
+    rest.end();
 
-    // Health - SEND ONLY
-    json.set("hr", d.hr);
-    json.set("sp02", d.sp02);
+    if (ok) txBytes += json.size();
+    return ok;
+}
 
-    // Ultrasonic - SEND ONLY
-    json.set("ultrasonic_center", d.ultrasonic_center);
-    json.set("ultrasonic_left", d.ultrasonic_left);
-    json.set("ultrasonic_rear", d.ultrasonic_rear);
-    json.set("ultrasonic_right", d.ultrasonic_right);
+bool FirebaseManager::sendData(const FirebaseTxData& d) {
+    if (!ready() || txBuffer == NULL) return false;
+
+    // Changed keys only, with everything rewritten now and then in case the database was edited
+    bool full = !haveSent || millis() - lastFullSend >= TELEMETRY_FULL_REFRESH_MS;
+    TelemetryFieldMask changed = full ? TELEMETRY_ALL_FIELDS : telemetryChanges(d, lastSent);
+    if (changed == 0) return true;
+
+    JsonWriter json(txBuffer, TELEMETRY_JSON_BUFFER);
+    writeTelemetry(json, NULL, d, changed);
+    if (!upload(FIREBASE_STATUS_PATH, json, false)) return false;
+
+    // Only what the database now holds - a failed upload is retried as a delta
+    copyTelemetryFields(lastSent, d, changed);
+    if (full) {
+        haveSent = true;
+        lastFullSend = millis();
+    }
+    return true;
+}
 
-    // Color - SEND ONLY
-    json.set("colour", d.colour);
+bool FirebaseManager::sendSeries(const TelemetryBatch& batch) {
+    if (!ready() || txBuffer == NULL) return false;
+
+    // {"seq", "t": millis() of slot 0, "dt", "n", "kf", "<channel>": [slot, value, slot, value, ...]}
+    JsonWriter json(txBuffer, TELEMETRY_JSON_BUFFER);
+    json.beginObject();
+    json.addInt("seq", batch.seq);
+    json.addInt("t", batch.startMs);
+    json.addInt("dt", TELEMETRY_SAMPLE_MS);
+    json.addInt("n", batch.samples);
+    json.addBool("kf", batch.keyframe);
+
+    for (uint8_t c = 0; c < SERIES_CHANNEL_COUNT; c++) {
+        if (batch.counts[c] == 0) continue;
+        json.beginArray(SERIES_CHANNELS[c].key);
+        for (uint8_t i = 0; i < batch.counts[c]; i++) {
+            json.addInt(NULL, batch.points[c][i].index);
+            json.addInt(NULL, batch.points[c][i].value);
+        }
+        json.endArray();
+    }
+    json.endObject();
 
-    // Compartment - SEND ONLY
-    json.set("compartment", d.compartment);
+    char path[48];
+    snprintf(path, sizeof(path), "%s/series/%lu", FIREBASE_TELEMETRY_PATH,
+             (unsigned long)(batch.seq % TELEMETRY_SERIES_SLOTS));
+    return upload(path, json, true);
+}
 
-    if (!Firebase.updateNode(fbdo, "/", json)) {
-        Log.print("Firebase TX failed: ");
-        Log.println(fbdo.errorReason());
-        return false;
+bool FirebaseManager::sendBacklog(const StoredSnapshot* records, uint32_t count, uint64_t clockOffsetMs) {
+    if (!ready() || txBuffer == NULL || count == 0) return false;
+
+    // {"<slot>": {"t": epoch ms, every field}, ...}. The slot follows the capture
+    // time, so the backlog is a ring of TELEMETRY_BACKLOG_SLOTS that never grows
+    // and a reboot doesn't restart it over newer entries.
+    JsonWriter json(txBuffer, TELEMETRY_JSON_BUFFER);
+    char key[12];
+    uint32_t lastSlot = UINT32_MAX;
+    json.beginObject();
+    for (uint32_t r = 0; r < count; r++) {
+        uint64_t capturedAt = clockOffsetMs + records[r].capturedMs;
+        uint32_t slot = (uint32_t)((capturedAt / TELEMETRY_PERIOD_MS) % TELEMETRY_BACKLOG_SLOTS);
+        if (slot == lastSlot) continue;     // Two captures in one period - the first is kept
+        lastSlot = slot;
+
+        snprintf(key, sizeof(key), "%lu", (unsigned long)slot);
+        json.beginObject(key);
+        json.addInt("t", (int64_t)capturedAt);
+        writeTelemetryFields(json, records[r].data);
+        json.endObject();
     }
+    json.endObject();
 
-    return true;
+    return upload(FIREBASE_TELEMETRY_PATH "/backlog", json, false);
 }
 
-bool FirebaseManager::receiveData(FirebaseRxData& d) {
+bool FirebaseManager::serviceCommands(FirebaseRxData& d, uint16_t& fields) {
     if (!ready()) return false;
 
-    static unsigned long lastRX = 0;
-    if (millis() - lastRX < 1000) return true; // Keep old data if less than 1s passed
-    lastRX = millis();
+    if (!streaming) {
+        if (millis() - streamRetryTime < streamRetryMs) return false;
+        streamRetryTime = millis();
+
+        // The server opens with a put of the whole subtree - a full resync every time
+        if (!Firebase.beginStream(streamData, FIREBASE_COMMAND_PATH)) {
+            Log.print("Firebase stream failed: ");
+            Log.println(streamData.errorReason());
+            streamErrors++;
+            streamRetryMs = min(streamRetryMs * 2, (unsigned long)FIREBASE_STREAM_RETRY_MAX_MS);
+            return false;
+        }
+        streaming = true;
+        streamConnects++;
+        streamRetryMs = FIREBASE_STREAM_RETRY_MS;
+        Log.println("Firebase command stream open");
+    }
 
-    if (!Firebase.getJSON(fbdo, "/")) {
-        Log.print("Firebase RX failed: ");
-        Log.println(fbdo.errorReason());
+    if (!Firebase.readStream(streamData)) {
+        restartStream(streamData.errorReason().c_str());
         return false;
     }
+    if (streamData.streamTimeout()) {
+        // No keep-alive from the server - the connection is gone even if the socket isn't
+        restartStream("keep-alive timeout");
+        return false;
+    }
+    if (!streamData.streamAvailable()) return false;
 
-    FirebaseJson& json = fbdo.jsonObject();
-    FirebaseJsonData jd;
-
-    // Buzzer control - RECEIVE ONLY
-    json.get(jd, "buzzer01ring");
-    if (jd.success) d.buzzer01ring = jd.boolValue;
-
-    json.get(jd, "buzzer02ring");
-    if (jd.success) d.buzzer02ring = jd.boolValue;
-
-    json.get(jd, "buzzersound");
-    if (jd.success) d.buzzersound = jd.intValue;
-
-
-    // LED brightness control - RECEIVE ONLY
-    json.get(jd, "lightadj_left");
-    if (jd.success) d.lightadj_left = jd.intValue;
-
-    json.get(jd, "lightadj_right");
-    if (jd.success) d.lightadj_right = jd.intValue;
-
-
-    // Sensor start/stop flags - RECEIVE ONLY
-    json.get(jd, "colour_start");
-    if (jd.success) d.colour_start = jd.boolValue;
-
-    json.get(jd, "compartment_start");
-    if (jd.success) d.compartment_start = jd.boolValue;
+    CommandEvent event = (streamData.eventType() == "patch") ? COMMAND_PATCH : COMMAND_PUT;
+    if (!commands.apply(event, streamData.dataPath().c_str(), streamData.payload().c_str())) {
+        return false;
+    }
+    d = commands.getState();
+    fields = commands.getChanged();
+    return true;
+}
 
-    json.get(jd, "heartrate_start");
-    if (jd.success) d.heartrate_start = jd.boolValue;
+bool FirebaseManager::clearCommand(const char* key) {
+    if (!ready() || txBuffer == NULL) return false;
 
-    json.get(jd, "ultrasonic_start");
-    if (jd.success) d.ultrasonic_start = jd.boolValue;
+    JsonWriter json(txBuffer, TELEMETRY_JSON_BUFFER);
+    json.beginObject();
+    json.addInt(key, 0);
+    json.endObject();
+    return upload(FIREBASE_COMMAND_PATH, json, false);
+}
 
-    return true;
-}
\ No newline at end of file
+void FirebaseManager::restartStream(const char* reason) {
+    Log.print("Firebase stream lost: ");
+    Log.println(reason);
+    Firebase.endStream(streamData);
+    streaming = false;
+    streamErrors++;
+    streamRetryTime = millis();
+}
@@ -3,47 +3,45 @@
 
 #include <Arduino.h>
 #include <FirebaseESP32.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include "command_stream.h"
+#include "telemetry_series.h"
+#include "telemetry_fields.h"
 
-struct FirebaseTxData {
-    // Sensor readings - SEND ONLY
-    float acceleration;        // Send acceleration
-    int angular;               // Send angular velocity
-    int battery;               // Send battery level
-    float voltage;             // Send voltage
-    int temp;                  // Send temperature
-    int humidity;              // Send humidity
-    int lightlevel;            // Send light amount from path LDRs
-    int hr;                    // Send heart rate
-    int sp02;                  // Send SpO2 level
-    int ultrasonic_center;     // Send center distance
-    int ultrasonic_left;       // Send left distance
-    int ultrasonic_rear;       // Send rear distance
-    int ultrasonic_right;      // Send right distance
-    String colour;             // Send detected color (RED/BLUE/GREEN/WHITE/UNKNOWN)
-    int compartment;           // Send compartment state (0=open, 255=closed)
-};
-
-struct FirebaseRxData {
-    // Sensor and Actuator control - RECEIVE ONLY
-    bool buzzer01ring;         // Receive signal to ring buzzer 1
-    bool buzzer02ring;         // Receive signal to ring buzzer 2
-    int buzzersound;           // Receive buzzer volume control
-    int lightadj_left;         // Receive left LED brightness adjustment
-    int lightadj_right;        // Receive right LED brightness adjustment
-    bool colour_start;         // Receive signal to start color detection
-    bool compartment_start;    // Receive signal to start compartment LDR check
-    bool heartrate_start;      // Receive signal to start heart rate sensor
-    bool ultrasonic_start;     // Receive signal to start ultrasonic sensors
-};
+struct StoredSnapshot;
 
 class FirebaseManager {
 private:
-    FirebaseData fbdo;
+    FirebaseData streamData;    // The command stream keeps its own connection
     FirebaseAuth auth;
     FirebaseConfig config;
 
     bool initialized;
 
+    CommandStream commands;
+    bool streaming;
+    unsigned long streamRetryTime;
+    unsigned long streamRetryMs;
+    uint32_t streamConnects;
+    uint32_t streamErrors;
+
+    void restartStream(const char* reason);
+
+    FirebaseTxData lastSent;    // As the database holds it - deltas are taken against this
+    bool haveSent;
+    unsigned long lastFullSend;
+    uint32_t txBytes;
+
+    char* txBuffer;             // TELEMETRY_JSON_BUFFER bytes, shared by every upload
+    char* restUri;              // FIREBASE_REST_URI_MAX bytes
+    char restHost[64];          // Database host, from the database URL
+    WiFiClientSecure restClient;
+    HTTPClient rest;            // Kept alive between uploads
+
+    // The text in json as it is, over the REST API - PUT when replace, PATCH otherwise
+    bool upload(const char* path, const JsonWriter& json, bool replace);
+
 public:
     FirebaseManager();
 
@@ -55,8 +53,26 @@ public:
     void update();
     bool ready();
 
+    // Status keys under FIREBASE_STATUS_PATH - only those that moved past their deadband
     bool sendData(const FirebaseTxData& data);
-    bool receiveData(FirebaseRxData& data);
+    // One fast-channel batch to FIREBASE_TELEMETRY_PATH/series/<seq % TELEMETRY_SERIES_SLOTS>
+    bool sendSeries(const TelemetryBatch& batch);
+    // Stored snapshots to FIREBASE_TELEMETRY_PATH/backlog/<slot>, each captured at
+    // clockOffsetMs + capturedMs - the slot is that time in TELEMETRY_PERIOD_MS steps,
+    // modulo TELEMETRY_BACKLOG_SLOTS
+    bool sendBacklog(const StoredSnapshot* records, uint32_t count, uint64_t clockOffsetMs);
+    uint32_t getTxBytes() const { return txBytes; }
+
+    // Reads the commands stream, (re)connecting as needed. Never waits for
+    // data; true when an event changed the commands, now in data, with the
+    // CommandFieldBit bits it changed in fields.
+    bool serviceCommands(FirebaseRxData& data, uint16_t& fields);
+    // One key under FIREBASE_COMMAND_PATH back to 0, once the robot has taken it
+    bool clearCommand(const char* key);
+    bool isStreaming() const { return streaming; }
+    uint32_t getStreamReconnects() const { return streamConnects > 0 ? streamConnects - 1 : 0; }
+    uint32_t getStreamErrors() const { return streamErrors; }
+    uint32_t getStreamRejected() const { return commands.getRejected(); }
 };
 
 #endif
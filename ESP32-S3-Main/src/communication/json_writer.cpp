@@ -0,0 +1,135 @@
+#include "json_writer.h"
+#include <math.h>
+
+JsonWriter::JsonWriter(char* buffer, size_t capacity)
+    : buffer(buffer), capacity(capacity) {
+    reset();
+}
+
+void JsonWriter::reset() {
+    length = 0;
+    overflow = (capacity == 0);
+    first = true;
+    if (capacity > 0) buffer[0] = '\0';
+}
+
+void JsonWriter::append(char c) {
+    if (overflow) return;
+    if (length + 1 >= capacity) {
+        overflow = true;
+        return;
+    }
+    buffer[length++] = c;
+    buffer[length] = '\0';
+}
+
+void JsonWriter::append(const char* text) {
+    while (*text) append(*text++);
+}
+
+void JsonWriter::appendString(const char* text) {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+
+    append('"');
+    for (; *text; text++) {
+        unsigned char c = (unsigned char)*text;
+        if (c == '"' || c == '\\') {
+            append('\\');
+            append((char)c);
+        } else if (c < 0x20) {
+            append("\\u00");
+            append(HEX_DIGITS[c >> 4]);
+            append(HEX_DIGITS[c & 0x0F]);
+        } else {
+            append((char)c);
+        }
+    }
+    append('"');
+}
+
+void JsonWriter::appendInt(int64_t value) {
+    char digits[20];
+    uint8_t n = 0;
+    uint64_t magnitude = (value < 0) ? (uint64_t)(-(value + 1)) + 1 : (uint64_t)value;
+
+    do {
+        digits[n++] = '0' + (char)(magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+
+    if (value < 0) append('-');
+    while (n > 0) append(digits[--n]);
+}
+
+void JsonWriter::member(const char* key) {
+    if (!first) append(',');
+    first = false;
+    if (key != NULL) {
+        appendString(key);
+        append(':');
+    }
+}
+
+void JsonWriter::beginObject(const char* key) {
+    // The outermost object has nothing before it
+    if (length > 0) member(key);
+    append('{');
+    first = true;
+}
+
+void JsonWriter::endObject() {
+    append('}');
+    first = false;
+}
+
+void JsonWriter::beginArray(const char* key) {
+    if (length > 0) member(key);
+    append('[');
+    first = true;
+}
+
+void JsonWriter::endArray() {
+    append(']');
+    first = false;
+}
+
+void JsonWriter::addInt(const char* key, int64_t value) {
+    member(key);
+    appendInt(value);
+}
+
+void JsonWriter::addFloat(const char* key, float value, uint8_t decimals) {
+    member(key);
+    if (!isfinite(value)) {
+        append("null");
+        return;
+    }
+
+    // Fixed point - printf's float path allocates on newlib
+    int64_t scale = 1;
+    for (uint8_t i = 0; i < decimals; i++) scale *= 10;
+    int64_t scaled = llround((double)value * scale);
+
+    if (scaled < 0) {
+        append('-');
+        scaled = -scaled;
+    }
+    appendInt(scaled / scale);
+    if (decimals == 0) return;
+
+    append('.');
+    int64_t fraction = scaled % scale;
+    for (int64_t digit = scale / 10; digit > 0; digit /= 10) {
+        append('0' + (char)(fraction / digit % 10));
+    }
+}
+
+void JsonWriter::addBool(const char* key, bool value) {
+    member(key);
+    append(value ? "true" : "false");
+}
+
+void JsonWriter::addText(const char* key, const char* text) {
+    member(key);
+    appendString(text);
+}
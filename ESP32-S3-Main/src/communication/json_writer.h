@@ -0,0 +1,46 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+    Writes JSON straight into a caller-owned buffer - no heap, no String.
+    Keys are NULL inside arrays. Past the end of the buffer nothing more is
+    written and ok() turns false; the text is always NUL-terminated.
+*/
+class JsonWriter {
+private:
+    char* buffer;
+    size_t capacity;
+    size_t length;
+    bool overflow;
+    bool first;                 // No comma before the next member
+
+    void append(char c);
+    void append(const char* text);
+    void appendString(const char* text);
+    void appendInt(int64_t value);
+    void member(const char* key);
+
+public:
+    JsonWriter(char* buffer, size_t capacity);
+
+    void reset();
+
+    void beginObject(const char* key = NULL);
+    void endObject();
+    void beginArray(const char* key = NULL);
+    void endArray();
+
+    void addInt(const char* key, int64_t value);
+    void addFloat(const char* key, float value, uint8_t decimals = 2);
+    void addBool(const char* key, bool value);
+    void addText(const char* key, const char* text);
+
+    const char* c_str() const { return buffer; }
+    size_t size() const { return length; }
+    bool ok() const { return !overflow; }
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include "lan_protocol.h"
+#include <string.h>
+#include "../config/constants.h"
+
+size_t lanClientMessageSize(uint8_t type) {
+    switch (type) {
+        case LAN_COMMAND:   return sizeof(LanCommand);
+        case LAN_PING:      return sizeof(LanPing);
+        case LAN_SUBSCRIBE: return sizeof(LanSubscribe);
+        default:            return 0;
+    }
+}
+
+void applyLanCommand(const LanCommand& c, FirebaseRxData& d) {
+    if (c.fields & LAN_FIELD_BUZZER01)          d.buzzer01ring = c.buzzer01ring != 0;
+    if (c.fields & LAN_FIELD_BUZZER02)          d.buzzer02ring = c.buzzer02ring != 0;
+    if (c.fields & LAN_FIELD_BUZZER_SOUND)      d.buzzersound = c.buzzersound;
+    if (c.fields & LAN_FIELD_LIGHT_LEFT)        d.lightadj_left = c.lightadj_left;
+    if (c.fields & LAN_FIELD_LIGHT_RIGHT)       d.lightadj_right = c.lightadj_right;
+    if (c.fields & LAN_FIELD_COLOUR_START)      d.colour_start = c.colour_start != 0;
+    if (c.fields & LAN_FIELD_COMPARTMENT_START) d.compartment_start = c.compartment_start != 0;
+    if (c.fields & LAN_FIELD_HEARTRATE_START)   d.heartrate_start = c.heartrate_start != 0;
+    if (c.fields & LAN_FIELD_ULTRASONIC_START)  d.ultrasonic_start = c.ultrasonic_start != 0;
+    if (c.fields & LAN_FIELD_ROUTE)             d.route_destination = c.route_destination;
+}
+
+LanRateLimiter::LanRateLimiter() {
+    reset(0, 0, 0);
+}
+
+void LanRateLimiter::reset(uint32_t rate, uint32_t burst, uint32_t nowMs) {
+    this->rate = rate;
+    this->burst = burst;
+    tokensMilli = burst * 1000;
+    lastMs = nowMs;
+}
+
+bool LanRateLimiter::allow(uint32_t nowMs) {
+    uint32_t elapsed = nowMs - lastMs;
+    lastMs = nowMs;
+
+    // rate tokens per second = rate milli-tokens per millisecond
+    uint64_t refilled = (uint64_t)tokensMilli + (uint64_t)elapsed * rate;
+    uint32_t full = burst * 1000;
+    tokensMilli = (refilled > full) ? full : (uint32_t)refilled;
+
+    if (tokensMilli < 1000) return false;
+    tokensMilli -= 1000;
+    return true;
+}
+
+void lanClientClear(LanClient& client) {
+    client.id = 0;
+    client.rateHz = 0;
+    client.lastSentMs = 0;
+    client.lastSentSeq = 0;
+}
+
+void lanClientConnect(LanClient& client, uint32_t id, uint32_t nowMs) {
+    lanClientClear(client);
+    client.id = id;
+    client.rateHz = LAN_SNAPSHOT_DEFAULT_HZ;
+    client.limiter.reset(LAN_COMMAND_RATE, LAN_COMMAND_BURST, nowMs);
+}
+
+LanDecision lanDecide(LanClient& client, const uint8_t* data, size_t len, uint32_t nowMs) {
+    LanDecision decision;
+    memset(&decision, 0, sizeof(decision));
+    decision.action = LAN_ACTION_DROP;
+    if (len == 0 || lanClientMessageSize(data[0]) != len) return decision;
+
+    switch (data[0]) {
+        case LAN_PING:
+            memcpy(&decision.pong, data, sizeof(decision.pong));
+            decision.pong.type = LAN_PONG;
+            decision.action = LAN_ACTION_PONG;
+            break;
+
+        case LAN_SUBSCRIBE: {
+            LanSubscribe subscribe;
+            memcpy(&subscribe, data, sizeof(subscribe));
+            client.rateHz = (subscribe.rateHz > LAN_SNAPSHOT_MAX_HZ) ? LAN_SNAPSHOT_MAX_HZ : subscribe.rateHz;
+            decision.action = LAN_ACTION_NONE;
+            break;
+        }
+
+        case LAN_COMMAND:
+            memcpy(&decision.command, data, sizeof(decision.command));
+            decision.action = LAN_ACTION_REFUSE;
+            if (decision.command.fields & ~LAN_FIELD_ALL) {
+                decision.ack = lanCommandAck(decision.command.seq, LAN_ACK_MALFORMED);
+            } else if (!client.limiter.allow(nowMs)) {
+                decision.ack = lanCommandAck(decision.command.seq, LAN_ACK_RATE_LIMITED);
+            } else {
+                decision.action = LAN_ACTION_QUEUE;
+            }
+            break;
+    }
+    return decision;
+}
+
+void lanQueueFull(LanDecision& decision) {
+    decision.action = LAN_ACTION_REFUSE;
+    decision.ack = lanCommandAck(decision.command.seq, LAN_ACK_BUSY);
+}
+
+LanCommandAck lanCommandAck(uint16_t seq, LanAckStatus status) {
+    LanCommandAck ack = {LAN_COMMAND_ACK, seq, status};
+    return ack;
+}
+
+bool lanSnapshotDue(const LanClient& client, uint16_t seq, uint32_t nowMs) {
+    if (client.id == 0 || client.rateHz == 0) return false;
+    if (client.lastSentSeq == seq && client.lastSentMs != 0) return false;
+    return nowMs - client.lastSentMs >= 1000u / client.rateHz;
+}
+
+void lanSnapshotSent(LanClient& client, uint16_t seq, uint32_t nowMs) {
+    client.lastSentMs = nowMs;
+    client.lastSentSeq = seq;
+}
@@ -0,0 +1,178 @@
+#ifndef LAN_PROTOCOL_H
+#define LAN_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "command_stream.h"
+
+/*
+    Binary messages on the LAN WebSocket (LAN_SOCKET_PATH), one per binary
+    frame, the LanMessage type first. Packed and little-endian - the S3's
+    byte order and that of any x86 or ARM client - with the layouts pinned
+    by static_asserts below. A layout change bumps LAN_PROTOCOL_VERSION,
+    which every snapshot carries.
+*/
+
+constexpr uint8_t LAN_PROTOCOL_VERSION = 1;
+
+#define LAN_PACKED __attribute__((packed))
+
+enum LanMessage : uint8_t {
+    LAN_SNAPSHOT = 1,           // S3 -> client: sensor snapshot, at the client's subscribed rate
+    LAN_COMMAND,                // client -> S3: FirebaseRxData fields, only those in the mask
+    LAN_COMMAND_ACK,            // S3 -> client: applied by the loop, or refused
+    LAN_PING,                   // client -> S3: returned as LAN_PONG by the socket handler
+    LAN_PONG,
+    LAN_SUBSCRIBE               // client -> S3: snapshot rate, 0 stops them
+};
+
+// LanCommand::fields - one bit per FirebaseRxData field, the dashboard's CommandFieldBit
+enum LanCommandField : uint16_t {
+    LAN_FIELD_BUZZER01          = COMMAND_BUZZER01,
+    LAN_FIELD_BUZZER02          = COMMAND_BUZZER02,
+    LAN_FIELD_BUZZER_SOUND      = COMMAND_BUZZER_SOUND,
+    LAN_FIELD_LIGHT_LEFT        = COMMAND_LIGHT_LEFT,
+    LAN_FIELD_LIGHT_RIGHT       = COMMAND_LIGHT_RIGHT,
+    LAN_FIELD_COLOUR_START      = COMMAND_COLOUR_START,
+    LAN_FIELD_COMPARTMENT_START = COMMAND_COMPARTMENT_START,
+    LAN_FIELD_HEARTRATE_START   = COMMAND_HEARTRATE_START,
+    LAN_FIELD_ULTRASONIC_START  = COMMAND_ULTRASONIC_START,
+    LAN_FIELD_ROUTE             = COMMAND_ROUTE,
+    LAN_FIELD_ALL               = COMMAND_ALL
+};
+
+enum LanAckStatus : uint8_t {
+    LAN_ACK_APPLIED = 0,
+    LAN_ACK_RATE_LIMITED,       // Over LAN_COMMAND_RATE for this client
+    LAN_ACK_BUSY,               // The loop hasn't taken the commands already queued
+    LAN_ACK_MALFORMED           // Wrong length or unknown field bits
+};
+
+struct LAN_PACKED LanSnapshot {
+    uint8_t type;               // LAN_SNAPSHOT
+    uint8_t version;            // LAN_PROTOCOL_VERSION
+    uint16_t seq;
+    uint32_t timeMs;            // S3 millis() when taken
+    int16_t acceleration;       // m/s^2 x 100
+    int16_t angular;            // Roll, degrees
+    uint8_t battery;            // %
+    uint16_t voltage;           // mV
+    int8_t temp;                // C
+    uint8_t humidity;           // %
+    uint16_t light;             // Path light level
+    uint8_t hr;
+    uint8_t spo2;
+    uint16_t ultrasonic[4];     // cm - center, left, rear, right
+    uint8_t colour;             // ColorType
+    uint8_t compartment;        // 0 open, 255 closed
+    int8_t motorEstop;          // As FirebaseTxData::motor_estop
+    int8_t duty[4];             // Applied duty %, WheelIndex order
+};
+
+struct LAN_PACKED LanCommand {
+    uint8_t type;               // LAN_COMMAND
+    uint16_t seq;               // Echoed in the ack
+    uint16_t fields;            // LanCommandField bits - the rest are left as they are
+    uint8_t buzzer01ring;
+    uint8_t buzzer02ring;
+    int16_t buzzersound;
+    int16_t lightadj_left;
+    int16_t lightadj_right;
+    uint8_t colour_start;
+    uint8_t compartment_start;
+    uint8_t heartrate_start;
+    uint8_t ultrasonic_start;
+    int16_t route_destination;
+};
+
+struct LAN_PACKED LanCommandAck {
+    uint8_t type;               // LAN_COMMAND_ACK
+    uint16_t seq;
+    uint8_t status;             // LanAckStatus
+};
+
+// Ping and pong share the layout - the token comes back untouched
+struct LAN_PACKED LanPing {
+    uint8_t type;               // LAN_PING / LAN_PONG
+    uint32_t token;
+};
+
+struct LAN_PACKED LanSubscribe {
+    uint8_t type;               // LAN_SUBSCRIBE
+    uint8_t rateHz;             // Capped at LAN_SNAPSHOT_MAX_HZ
+};
+
+static_assert(sizeof(LanSnapshot) == 36, "LanSnapshot layout changed - bump LAN_PROTOCOL_VERSION");
+static_assert(sizeof(LanCommand) == 19, "LanCommand layout changed - bump LAN_PROTOCOL_VERSION");
+static_assert(sizeof(LanCommandAck) == 4, "LanCommandAck layout changed - bump LAN_PROTOCOL_VERSION");
+static_assert(sizeof(LanPing) == 5, "LanPing layout changed - bump LAN_PROTOCOL_VERSION");
+static_assert(sizeof(LanSubscribe) == 2, "LanSubscribe layout changed - bump LAN_PROTOCOL_VERSION");
+
+// Size the message type in data[0] must have, 0 for types a client doesn't send
+size_t lanClientMessageSize(uint8_t type);
+
+// The masked fields of command into data
+void applyLanCommand(const LanCommand& command, FirebaseRxData& data);
+
+// Token bucket - rate per second, up to burst at once
+class LanRateLimiter {
+private:
+    uint32_t rate;
+    uint32_t burst;
+    uint32_t tokensMilli;       // x1000, so slow rates still refill every millisecond
+    uint32_t lastMs;
+
+public:
+    LanRateLimiter();
+    void reset(uint32_t rate, uint32_t burst, uint32_t nowMs);
+    bool allow(uint32_t nowMs);
+};
+
+/*
+    What the socket decides per client, kept free of the transport so the
+    host stand-in runs the same decisions as LanSocket. The socket holds its
+    client lock around these and does the sending and queueing itself.
+*/
+
+// One connected client as the socket keeps it
+struct LanClient {
+    uint32_t id;                // 0 = free slot
+    uint8_t rateHz;             // Subscribed snapshot rate, 0 = none
+    uint32_t lastSentMs;
+    uint16_t lastSentSeq;
+    LanRateLimiter limiter;
+};
+
+// What the socket does with one client message
+enum LanAction : uint8_t {
+    LAN_ACTION_NONE,            // Subscribe, already applied to the client
+    LAN_ACTION_PONG,            // Send pong back
+    LAN_ACTION_QUEUE,           // Queue command for the loop - lanQueueFull() when it won't fit
+    LAN_ACTION_REFUSE,          // Send ack back
+    LAN_ACTION_DROP             // Wrong size or unknown type, nothing to answer
+};
+
+struct LanDecision {
+    LanAction action;
+    LanPing pong;
+    LanCommand command;
+    LanCommandAck ack;
+};
+
+// Empty slot, and a slot for a client that just connected
+void lanClientClear(LanClient& client);
+void lanClientConnect(LanClient& client, uint32_t id, uint32_t nowMs);
+
+// Validates a message; a subscribe sets the client's rate, a command spends a limiter token
+LanDecision lanDecide(LanClient& client, const uint8_t* data, size_t len, uint32_t nowMs);
+
+// The command queue was full - the admitted command is refused LAN_ACK_BUSY
+void lanQueueFull(LanDecision& decision);
+
+LanCommandAck lanCommandAck(uint16_t seq, LanAckStatus status);
+
+// Subscribed, not sent this seq yet and a period since the last one
+bool lanSnapshotDue(const LanClient& client, uint16_t seq, uint32_t nowMs);
+void lanSnapshotSent(LanClient& client, uint16_t seq, uint32_t nowMs);
+
+#endif
@@ -0,0 +1,218 @@
+#include "lan_socket.h"
+#include "../utils/logger.h"
+
+LanSocket::LanSocket()
+    : socket(LAN_SOCKET_PATH),
+      clientCount(0), clientsRejected(0), commandsApplied(0), commandsLimited(0),
+      commandsBusy(0), malformed(0), snapshotsSent(0), snapshotsSkipped(0) {
+    taskHandle = NULL;
+    commandQueue = NULL;
+    ackQueue = NULL;
+    snapshotSeq = 0;
+    clientLock = portMUX_INITIALIZER_UNLOCKED;
+    for (uint8_t i = 0; i < LAN_MAX_CLIENTS; i++) lanClientClear(clients[i]);
+}
+
+void LanSocket::begin(AsyncWebServer* server) {
+    if (taskHandle != NULL) return;
+
+    commandQueue = xQueueCreate(LAN_COMMAND_QUEUE_LEN, sizeof(QueuedCommand));
+    ackQueue = xQueueCreate(LAN_COMMAND_QUEUE_LEN, sizeof(QueuedAck));
+
+    socket.onEvent([this](AsyncWebSocket*, AsyncWebSocketClient* client,
+                          AwsEventType type, void* arg, uint8_t* data, size_t len) {
+        onEvent(client, type, arg, data, len);
+    });
+    server->addHandler(&socket);
+
+    xTaskCreatePinnedToCore(
+        taskWorker,         // Function
+        "LanSocket",        // Name
+        LAN_TASK_STACK,     // Stack size
+        this,               // Param
+        LAN_TASK_PRIORITY,  // Priority
+        &taskHandle,        // Handle
+        NET_TASK_CORE       // Core (Protocol Core)
+    );
+
+    Log.print("✓ LAN socket on ");
+    Log.println(LAN_SOCKET_PATH);
+}
+
+void LanSocket::taskWorker(void* _this) {
+    ((LanSocket*)_this)->run();
+}
+
+void LanSocket::run() {
+    LanSnapshot latest;
+    bool haveSnapshot = false;
+    unsigned long lastCleanup = 0;
+
+    while (true) {
+        // An applied command wakes this early - its ack shouldn't wait for the tick
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LAN_TICK_MS));
+        uint32_t now = millis();
+
+        QueuedAck ack;
+        while (xQueueReceive(ackQueue, &ack, 0) == pdTRUE) {
+            sendTo(ack.client, &ack.ack, sizeof(ack.ack));
+        }
+
+        if (snapshots.take(latest)) haveSnapshot = true;
+        if (haveSnapshot) {
+            for (uint8_t i = 0; i < LAN_MAX_CLIENTS; i++) {
+                portENTER_CRITICAL(&clientLock);
+                LanClient client = clients[i];
+                portEXIT_CRITICAL(&clientLock);
+
+                if (!lanSnapshotDue(client, latest.seq, now)) continue;
+
+                if (sendTo(client.id, &latest, sizeof(latest))) snapshotsSent++;
+                else snapshotsSkipped++;
+
+                portENTER_CRITICAL(&clientLock);
+                if (clients[i].id == client.id) lanSnapshotSent(clients[i], latest.seq, now);
+                portEXIT_CRITICAL(&clientLock);
+            }
+        }
+
+        // Frees clients that went away without a close
+        if (now - lastCleanup >= 1000) {
+            lastCleanup = now;
+            socket.cleanupClients(LAN_MAX_CLIENTS);
+        }
+    }
+}
+
+bool LanSocket::sendTo(uint32_t id, const void* data, size_t len) {
+    AsyncWebSocketClient* client = socket.client(id);
+    if (client == NULL || client->queueIsFull()) return false;
+    client->binary((const uint8_t*)data, len);
+    return true;
+}
+
+void LanSocket::onEvent(AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t len) {
+    switch (type) {
+        case WS_EVT_CONNECT:
+            onConnect(client);
+            break;
+        case WS_EVT_DISCONNECT:
+            onDisconnect(client);
+            break;
+        case WS_EVT_DATA: {
+            // Every message fits one frame - fragments are not put back together
+            AwsFrameInfo* info = (AwsFrameInfo*)arg;
+            if (info->final && info->index == 0 && info->len == len && info->opcode == WS_BINARY) {
+                onMessage(client, data, len);
+            } else {
+                malformed++;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+int LanSocket::findClient(uint32_t id) const {
+    for (uint8_t i = 0; i < LAN_MAX_CLIENTS; i++) {
+        if (clients[i].id == id) return i;
+    }
+    return -1;
+}
+
+void LanSocket::onConnect(AsyncWebSocketClient* client) {
+    portENTER_CRITICAL(&clientLock);
+    int slot = findClient(0);
+    if (slot >= 0) lanClientConnect(clients[slot], client->id(), millis());
+    portEXIT_CRITICAL(&clientLock);
+
+    if (slot < 0) {
+        // 1013: try again later
+        clientsRejected++;
+        client->close(1013, "Too many clients");
+        return;
+    }
+    clientCount++;
+}
+
+void LanSocket::onDisconnect(AsyncWebSocketClient* client) {
+    portENTER_CRITICAL(&clientLock);
+    int slot = findClient(client->id());
+    if (slot >= 0) lanClientClear(clients[slot]);
+    portEXIT_CRITICAL(&clientLock);
+
+    if (slot >= 0) clientCount--;
+}
+
+void LanSocket::onMessage(AsyncWebSocketClient* client, const uint8_t* data, size_t len) {
+    portENTER_CRITICAL(&clientLock);
+    int slot = findClient(client->id());
+    LanDecision decision;
+    if (slot >= 0) decision = lanDecide(clients[slot], data, len, millis());
+    portEXIT_CRITICAL(&clientLock);
+    if (slot < 0) return;
+
+    if (decision.action == LAN_ACTION_QUEUE) {
+        QueuedCommand queued = {client->id(), decision.command};
+        if (xQueueSend(commandQueue, &queued, 0) != pdTRUE) lanQueueFull(decision);
+    }
+
+    switch (decision.action) {
+        case LAN_ACTION_PONG:
+            client->binary((const uint8_t*)&decision.pong, sizeof(decision.pong));
+            break;
+
+        case LAN_ACTION_REFUSE:
+            if (decision.ack.status == LAN_ACK_RATE_LIMITED) commandsLimited++;
+            else if (decision.ack.status == LAN_ACK_BUSY) commandsBusy++;
+            else malformed++;
+            client->binary((const uint8_t*)&decision.ack, sizeof(decision.ack));
+            break;
+
+        case LAN_ACTION_DROP:
+            malformed++;
+            break;
+
+        default:
+            break;
+    }
+}
+
+void LanSocket::publish(LanSnapshot& snapshot) {
+    snapshot.type = LAN_SNAPSHOT;
+    snapshot.version = LAN_PROTOCOL_VERSION;
+    snapshot.seq = ++snapshotSeq;
+    snapshots.post(snapshot);
+}
+
+bool LanSocket::takeCommands(FirebaseRxData& data) {
+    if (commandQueue == NULL) return false;
+
+    // Bounded by the queue length - a flood can't keep the loop here
+    QueuedCommand queued;
+    bool applied = false;
+    for (uint8_t i = 0; i < LAN_COMMAND_QUEUE_LEN && xQueueReceive(commandQueue, &queued, 0) == pdTRUE; i++) {
+        applyLanCommand(queued.command, data);
+        applied = true;
+        commandsApplied++;
+
+        QueuedAck ack = {queued.client, lanCommandAck(queued.command.seq, LAN_ACK_APPLIED)};
+        xQueueSend(ackQueue, &ack, 0);
+    }
+    if (applied) xTaskNotifyGive(taskHandle);
+    return applied;
+}
+
+LanStats LanSocket::getStats() const {
+    LanStats stats;
+    stats.clients = clientCount;
+    stats.clientsRejected = clientsRejected;
+    stats.commandsApplied = commandsApplied;
+    stats.commandsLimited = commandsLimited;
+    stats.commandsBusy = commandsBusy;
+    stats.malformed = malformed;
+    stats.snapshotsSent = snapshotsSent;
+    stats.snapshotsSkipped = snapshotsSkipped;
+    return stats;
+}
@@ -0,0 +1,97 @@
+#ifndef LAN_SOCKET_H
+#define LAN_SOCKET_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <ESPAsyncWebServer.h>
+#include "lan_protocol.h"
+#include "../config/constants.h"
+#include "../utils/mailbox.h"
+
+struct LanStats {
+    uint32_t clients;               // Connected right now
+    uint32_t clientsRejected;       // Closed on connect, LAN_MAX_CLIENTS reached
+    uint32_t commandsApplied;
+    uint32_t commandsLimited;       // Over LAN_COMMAND_RATE
+    uint32_t commandsBusy;          // Command queue full
+    uint32_t malformed;             // Wrong size, type or field bits
+    uint32_t snapshotsSent;
+    uint32_t snapshotsSkipped;      // Client's send queue was full
+};
+
+/*
+    Binary WebSocket at LAN_SOCKET_PATH on the WebSerial server, for clients
+    on the same network that can't wait for the Firebase round trip.
+
+    Three parties, none waiting on another:
+      - AsyncTCP's task handles the socket events. Pings are answered
+        there, commands are rate-limited per client and queued - the
+        decisions are lanDecide() in lan_protocol.cpp.
+      - The loop publishes snapshots to a mailbox and, once a pass, applies
+        the queued commands to its FirebaseRxData (takeCommands).
+      - A sender task on NET_TASK_CORE sends each client the newest
+        snapshot at its subscribed rate, and the acks for applied commands.
+        A client whose send queue is full skips a snapshot rather than
+        being waited for.
+
+    A command is acked LAN_ACK_APPLIED once the loop has taken it, so the
+    client's command -> ack time covers the whole path into the loop.
+*/
+class LanSocket {
+private:
+    struct QueuedCommand {
+        uint32_t client;
+        LanCommand command;
+    };
+
+    struct QueuedAck {
+        uint32_t client;
+        LanCommandAck ack;
+    };
+
+    AsyncWebSocket socket;
+    TaskHandle_t taskHandle;
+    QueueHandle_t commandQueue;     // AsyncTCP -> loop
+    QueueHandle_t ackQueue;         // Loop -> sender task
+    Mailbox<LanSnapshot> snapshots; // Loop -> sender task
+    uint16_t snapshotSeq;
+
+    portMUX_TYPE clientLock;
+    LanClient clients[LAN_MAX_CLIENTS];
+
+    std::atomic<uint32_t> clientCount;
+    std::atomic<uint32_t> clientsRejected;
+    std::atomic<uint32_t> commandsApplied;
+    std::atomic<uint32_t> commandsLimited;
+    std::atomic<uint32_t> commandsBusy;
+    std::atomic<uint32_t> malformed;
+    std::atomic<uint32_t> snapshotsSent;
+    std::atomic<uint32_t> snapshotsSkipped;
+
+    static void taskWorker(void* _this);
+    void run();
+
+    // AsyncTCP side
+    void onEvent(AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t len);
+    void onConnect(AsyncWebSocketClient* client);
+    void onDisconnect(AsyncWebSocketClient* client);
+    void onMessage(AsyncWebSocketClient* client, const uint8_t* data, size_t len);
+    int findClient(uint32_t id) const;
+
+    bool sendTo(uint32_t id, const void* data, size_t len);
+
+public:
+    LanSocket();
+
+    // Registers the endpoint - before server->begin()
+    void begin(AsyncWebServer* server);
+
+    // Loop side
+    bool hasClients() const { return clientCount > 0; }
+    void publish(LanSnapshot& snapshot);                // Fills in type, version and seq
+    bool takeCommands(FirebaseRxData& data);            // true when a command changed data
+
+    LanStats getStats() const;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "link_stats.h"
+#include "../config/constants.h"
+
+LinkMonitor::LinkMonitor() {
+    reset();
+}
+
+void LinkMonitor::reset() {
+    memset(inFlight, 0, sizeof(inFlight));
+    memset(rttBins, 0, sizeof(rttBins));
+    memset(&stats, 0, sizeof(stats));
+}
+
+void LinkMonitor::onSent(uint8_t seq) {
+    InFlight& slot = inFlight[seq & (LINK_IN_FLIGHT - 1)];
+    if (slot.pending) {
+        // Slot reused before its ack arrived
+        stats.lost++;
+    }
+    slot.seq = seq;
+    slot.pending = true;
+    slot.sentUs = micros();
+    stats.sent++;
+}
+
+bool LinkMonitor::onAck(uint8_t seq) {
+    InFlight& slot = inFlight[seq & (LINK_IN_FLIGHT - 1)];
+    if (!slot.pending || slot.seq != seq) return false;
+
+    uint32_t rtt = micros() - slot.sentUs;
+    slot.pending = false;
+    stats.acked++;
+
+    rttBins[min(rtt / LINK_RTT_BIN_US, (uint32_t)(LINK_RTT_BINS - 1))]++;
+    if (rtt > stats.rttMaxUs) stats.rttMaxUs = rtt;
+    return true;
+}
+
+void LinkMonitor::onEmergencyAck(uint32_t ackUs, uint16_t brakeUs) {
+    stats.estopCount++;
+    stats.estopAckUs = ackUs;
+    stats.estopBrakeUs = brakeUs;
+    stats.estopLastUs = 0;          // Until onEmergencyBraked() places the brake
+}
+
+void LinkMonitor::onEmergencyBraked(uint32_t latencyUs) {
+    stats.estopLastUs = latencyUs;
+    if (latencyUs > stats.estopMaxUs) stats.estopMaxUs = latencyUs;
+}
+
+void LinkMonitor::onApplied(uint32_t latencyUs) {
+    stats.applyLastUs = latencyUs;
+    if (latencyUs > stats.applyMaxUs) stats.applyMaxUs = latencyUs;
+}
+
+bool LinkMonitor::getSentTime(uint8_t seq, uint32_t& sentUs) const {
+    const InFlight& slot = inFlight[seq & (LINK_IN_FLIGHT - 1)];
+    if (slot.seq != seq || slot.sentUs == 0) return false;
+    sentUs = slot.sentUs;
+    return true;
+}
+
+void LinkMonitor::expire() {
+    uint32_t now = micros();
+    for (uint8_t i = 0; i < LINK_IN_FLIGHT; i++) {
+        if (inFlight[i].pending && now - inFlight[i].sentUs > UART_ACK_TIMEOUT_MS * 1000UL) {
+            inFlight[i].pending = false;
+            stats.lost++;
+        }
+    }
+}
+
+uint32_t LinkMonitor::percentile(uint8_t pct) {
+    if (stats.acked == 0) return 0;
+
+    // Upper edge of the bin holding the requested rank, never above the real max
+    uint32_t rank = ((uint64_t)stats.acked * pct + 99) / 100;
+    uint32_t count = 0;
+    for (uint8_t i = 0; i < LINK_RTT_BINS; i++) {
+        count += rttBins[i];
+        if (count >= rank) {
+            return min((uint32_t)(i + 1) * LINK_RTT_BIN_US, stats.rttMaxUs);
+        }
+    }
+    return stats.rttMaxUs;
+}
+
+LinkStats LinkMonitor::getStats() {
+    stats.rttP50Us = percentile(50);
+    stats.rttP99Us = percentile(99);
+    return stats;
+}
@@ -0,0 +1,87 @@
+#ifndef LINK_STATS_H
+#define LINK_STATS_H
+
+#include <Arduino.h>
+
+#define LINK_RTT_BIN_US 250         // Histogram resolution
+#define LINK_RTT_BINS 64            // Last bin collects everything above 16 ms
+#define LINK_IN_FLIGHT 16           // Unacked frames tracked at once, power of two
+
+// RTT is measured up to the loop pass that reads the ack, so it includes S3 loop latency
+struct LinkStats {
+    uint32_t sent;
+    uint32_t acked;
+    uint32_t lost;              // No ack within UART_ACK_TIMEOUT_MS
+    uint32_t crcErrors;         // Bad frames received from the WROOM
+    uint32_t retransmits;       // Repeats sent because the previous copy wasn't acked
+    uint32_t suppressed;        // Repeats not sent at all
+    uint32_t rttP50Us;
+    uint32_t rttP99Us;
+    uint32_t rttMaxUs;
+    uint32_t baudRate;          // Filled in by UARTProtocol
+
+    // E-stop lane
+    uint32_t estopCount;
+    uint32_t estopUnacked;      // Gave up after ESTOP_RETRY_LIMIT attempts
+    uint32_t estopLastUs;       // Decision -> bridges braked, via the synchronised clocks; 0 if not synced then
+    uint32_t estopMaxUs;
+    uint32_t estopAckUs;        // Decision -> ack received: the brake plus the ack's trip back and loop delay
+    uint32_t estopBrakeUs;      // WROOM-side frame decoded -> braked, last stop
+
+    // One-way S3 send -> WROOM outputs changed, via the synchronised clocks
+    uint32_t applyLastUs;
+    uint32_t applyMaxUs;
+
+    // Filled in by UARTProtocol from its ClockSync
+    int32_t clockOffsetUs;      // WROOM clock minus S3 clock
+    float clockDriftPpm;
+    uint32_t clockErrorUs;      // UINT32_MAX until synced
+};
+
+// One node on the motor bus. Latency is request sent -> reply read; replies are
+// read between loop passes, so it includes up to one pass.
+struct BusNodeStats {
+    uint8_t node;
+    uint32_t requests;          // Frames that expected a reply
+    uint32_t replies;
+    uint32_t timeouts;          // No reply within BUS_REPLY_TIMEOUT_US
+    uint32_t latencyLastUs;
+    uint32_t latencyAvgUs;
+    uint32_t latencyMaxUs;
+};
+
+class LinkMonitor {
+private:
+    struct InFlight {
+        uint8_t seq;
+        bool pending;
+        uint32_t sentUs;
+    };
+
+    InFlight inFlight[LINK_IN_FLIGHT];
+    uint32_t rttBins[LINK_RTT_BINS];
+    LinkStats stats;
+
+    uint32_t percentile(uint8_t pct);
+
+public:
+    LinkMonitor();
+    void reset();
+
+    void onSent(uint8_t seq);
+    bool onAck(uint8_t seq);    // false for duplicates and acks that arrived after the timeout
+    void onCrcError() { stats.crcErrors++; }
+    void onRetransmit() { stats.retransmits++; }
+    void onSuppressed() { stats.suppressed++; }
+    void onEmergencyAck(uint32_t ackUs, uint16_t brakeUs);
+    void onEmergencyBraked(uint32_t latencyUs);      // Decision -> brake, once the clocks are synced
+    void onEmergencyUnacked() { stats.estopUnacked++; }
+    void onApplied(uint32_t latencyUs);
+    bool getSentTime(uint8_t seq, uint32_t& sentUs) const;  // Until the slot is reused
+    uint32_t getErrorCount() const { return stats.lost + stats.crcErrors; }
+    void expire();              // Counts frames whose ack never came - call every loop
+
+    LinkStats getStats();
+};
+
+#endif
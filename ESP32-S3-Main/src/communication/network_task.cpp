@@ -0,0 +1,261 @@
+#include "network_task.h"
+#include "../config/constants.h"
+#include "../utils/logger.h"
+#include <sys/time.h>
+
+// Non-blocking send; a full queue gives up its oldest entry. false when one was dropped.
+template <typename T>
+static bool queueNewest(QueueHandle_t queue, const T& item) {
+    if (xQueueSend(queue, &item, 0) == pdTRUE) return true;
+
+    T oldest;
+    bool dropped = (xQueueReceive(queue, &oldest, 0) == pdTRUE);
+    xQueueSend(queue, &item, 0);
+    return !dropped;
+}
+
+// Wall clock minus millis(), in ms - 0 until SNTP has set the clock
+static uint64_t clockOffsetMs() {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    if ((unsigned long)now.tv_sec < CLOCK_VALID_EPOCH) return 0;
+    return (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000 - millis();
+}
+
+NetworkTask::NetworkTask(FirebaseManager* firebase, WiFiManager* wifi)
+    : firebase(firebase), wifi(wifi),
+      telemetryQueueMax(0), telemetrySent(0), telemetryFailed(0), telemetryDropped(0),
+      seriesSent(0), seriesFailed(0), seriesDropped(0), txBytes(0),
+      storeCount(0), storeFill(0), storeLost(0), backfilled(0),
+      commandsReceived(0), commandsOverwritten(0), streamReconnects(0), streamErrors(0), streamRejected(0),
+      txLastMs(0), txMaxMs(0), rxLastMs(0), rxMaxMs(0) {
+    taskHandle = NULL;
+    telemetryQueue = NULL;
+    seriesQueue = NULL;
+    logBuffer = NULL;
+    lastBackfill = 0;
+    commandLock = portMUX_INITIALIZER_UNLOCKED;
+    memset(&commandState, 0, sizeof(commandState));
+    commandFields = 0;
+    authLogged = false;
+    routeClearPending = false;
+}
+
+void NetworkTask::begin() {
+    if (taskHandle != NULL) return;
+
+    store.begin();
+    configTime(0, 0, NTP_SERVER);       // UTC - only used to time-stamp stored snapshots
+
+    telemetryQueue = xQueueCreate(NET_TELEMETRY_QUEUE_LEN, sizeof(StoredSnapshot));
+    seriesQueue = xQueueCreate(TELEMETRY_SERIES_QUEUE_LEN, sizeof(TelemetryBatch));
+    logBuffer = xRingbufferCreate(NET_LOG_BUFFER, RINGBUF_TYPE_BYTEBUF);
+    if (logBuffer) Log.attachWebBuffer(logBuffer);
+
+    xTaskCreatePinnedToCore(
+        taskWorker,         // Function
+        "NetworkTask",      // Name
+        NET_TASK_STACK,     // Stack size
+        this,               // Param
+        NET_TASK_PRIORITY,  // Priority
+        &taskHandle,        // Handle
+        NET_TASK_CORE       // Core (Protocol Core)
+    );
+}
+
+void NetworkTask::taskWorker(void* _this) {
+    ((NetworkTask*)_this)->run();
+}
+
+void NetworkTask::run() {
+    StoredSnapshot snapshot;
+    TelemetryBatch batch;
+
+    while (true) {
+        wifi->update();
+        drainLog();
+
+        if (!authLogged && firebase->ready()) {
+            Log.println("✓ Firebase Authentication Complete!");
+            authLogged = true;
+        }
+
+        readCommands();
+
+        // Retried until it lands - a stale destination would dispatch again
+        if (routeClearPending && firebase->ready() && firebase->clearCommand("route_destination")) {
+            routeClearPending = false;
+        }
+
+        if (xQueueReceive(seriesQueue, &batch, 0) == pdTRUE) {
+            if (firebase->ready() && firebase->sendSeries(batch)) seriesSent++;
+            else seriesFailed++;
+            txBytes = firebase->getTxBytes();
+        }
+
+        // Sleeps here when there's nothing to upload - a new snapshot wakes it
+        if (xQueueReceive(telemetryQueue, &snapshot, pdMS_TO_TICKS(NET_IDLE_WAIT_MS)) == pdTRUE) {
+            sendTelemetry(snapshot);
+        }
+
+        backfill();
+    }
+}
+
+bool NetworkTask::queueTelemetry(const FirebaseTxData& data) {
+    if (telemetryQueue == NULL) return false;
+
+    StoredSnapshot snapshot;
+    snapshot.capturedMs = millis();
+    snapshot.data = data;
+
+    // Full - an upload is stuck; the newest snapshot is the one worth keeping
+    bool kept = queueNewest(telemetryQueue, snapshot);
+    if (!kept) telemetryDropped++;
+
+    uint32_t depth = uxQueueMessagesWaiting(telemetryQueue);
+    if (depth > telemetryQueueMax) telemetryQueueMax = depth;
+    return kept;
+}
+
+bool NetworkTask::queueSeries(const TelemetryBatch& batch) {
+    if (seriesQueue == NULL) return false;
+
+    bool kept = queueNewest(seriesQueue, batch);
+    if (!kept) seriesDropped++;
+    return kept;
+}
+
+bool NetworkTask::takeCommands(FirebaseRxData& data) {
+    portENTER_CRITICAL(&commandLock);
+    uint16_t fields = commandFields;
+    mergeCommands(data, commandState, fields);
+    commandFields = 0;
+    portEXIT_CRITICAL(&commandLock);
+    return fields != 0;
+}
+
+void NetworkTask::clearRouteCommand() {
+    routeClearPending = true;
+}
+
+void NetworkTask::sendTelemetry(const StoredSnapshot& snapshot) {
+    bool ok = false;
+    if (firebase->ready()) {
+        unsigned long start = millis();
+        ok = firebase->sendData(snapshot.data);
+        uint32_t elapsed = millis() - start;
+
+        txLastMs = elapsed;
+        if (elapsed > txMaxMs) txMaxMs = elapsed;
+        txBytes = firebase->getTxBytes();
+    }
+
+    if (ok) {
+        telemetrySent++;
+        return;
+    }
+    telemetryFailed++;
+    store.push(snapshot.capturedMs, snapshot.data);
+    updateStoreStats();
+}
+
+void NetworkTask::backfill() {
+    if (store.getCount() == 0 || !firebase->ready()) return;
+    if (millis() - lastBackfill < STORE_BACKFILL_INTERVAL_MS) return;
+
+    // Live uploads first - only an idle pass backfills
+    if (uxQueueMessagesWaiting(telemetryQueue) > 0 || uxQueueMessagesWaiting(seriesQueue) > 0) return;
+
+    // Stored snapshots are keyed by wall-clock time; they wait until SNTP has it
+    uint64_t offset = clockOffsetMs();
+    if (offset == 0) return;
+
+    lastBackfill = millis();
+    uint32_t n = store.peek(backfillBatch, STORE_BACKFILL_BATCH);
+    if (firebase->sendBacklog(backfillBatch, n, offset)) {
+        store.drop(n);
+        backfilled += n;
+        if (store.getCount() == 0) {
+            Log.print("Telemetry backfill complete, ");
+            Log.print((uint32_t)backfilled);
+            Log.println(" snapshots uploaded");
+        }
+    }
+    txBytes = firebase->getTxBytes();
+    updateStoreStats();
+}
+
+void NetworkTask::updateStoreStats() {
+    storeCount = store.getCount();
+    storeFill = store.getFillPercent();
+    storeLost = store.getLost();
+}
+
+void NetworkTask::readCommands() {
+    if (!firebase->ready()) return;
+
+    unsigned long start = millis();
+    FirebaseRxData state;
+    uint16_t fields;
+    bool changed = firebase->serviceCommands(state, fields);
+    uint32_t elapsed = millis() - start;
+
+    rxLastMs = elapsed;
+    if (elapsed > rxMaxMs) rxMaxMs = elapsed;
+    streamReconnects = firebase->getStreamReconnects();
+    streamErrors = firebase->getStreamErrors();
+    streamRejected = firebase->getStreamRejected();
+
+    if (changed) {
+        // Not taken yet - the masks add up, so no change is lost to a newer one
+        portENTER_CRITICAL(&commandLock);
+        if (commandFields != 0) commandsOverwritten++;
+        commandState = state;
+        commandFields |= fields;
+        portEXIT_CRITICAL(&commandLock);
+        commandsReceived++;
+    }
+}
+
+void NetworkTask::drainLog() {
+    if (logBuffer == NULL) return;
+
+    // A byte buffer hands out at most up to its wrap point - loop until empty
+    size_t size;
+    uint8_t* data;
+    while ((data = (uint8_t*)xRingbufferReceiveUpTo(logBuffer, &size, 0, NET_LOG_CHUNK)) != NULL) {
+        if (WiFi.status() == WL_CONNECTED) {
+            WebSerial.write(data, size);
+        }
+        vRingbufferReturnItem(logBuffer, data);
+    }
+}
+
+NetworkStats NetworkTask::getStats() const {
+    NetworkStats stats;
+    stats.telemetryQueued = telemetryQueue ? uxQueueMessagesWaiting(telemetryQueue) : 0;
+    stats.telemetryQueueMax = telemetryQueueMax;
+    stats.telemetrySent = telemetrySent;
+    stats.telemetryFailed = telemetryFailed;
+    stats.telemetryDropped = telemetryDropped;
+    stats.seriesSent = seriesSent;
+    stats.seriesFailed = seriesFailed;
+    stats.seriesDropped = seriesDropped;
+    stats.txBytes = txBytes;
+    stats.storeCount = storeCount;
+    stats.storeFill = storeFill;
+    stats.storeLost = storeLost;
+    stats.backfilled = backfilled;
+    stats.commandsReceived = commandsReceived;
+    stats.streamReconnects = streamReconnects;
+    stats.streamErrors = streamErrors;
+    stats.streamRejected = streamRejected;
+    stats.commandsOverwritten = commandsOverwritten;
+    stats.txLastMs = txLastMs;
+    stats.txMaxMs = txMaxMs;
+    stats.rxLastMs = rxLastMs;
+    stats.rxMaxMs = rxMaxMs;
+    stats.logDropped = Log.getWebDropped();
+    return stats;
+}
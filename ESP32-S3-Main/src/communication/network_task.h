@@ -0,0 +1,113 @@
+#ifndef NETWORK_TASK_H
+#define NETWORK_TASK_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/ringbuf.h>
+#include "firebase_manager.h"
+#include "telemetry_store.h"
+#include "wifi_manager.h"
+
+struct NetworkStats {
+    uint32_t telemetryQueued;       // Snapshots waiting right now
+    uint32_t telemetryQueueMax;     // Deepest the queue has been
+    uint32_t telemetrySent;
+    uint32_t telemetryFailed;
+    uint32_t telemetryDropped;      // Pushed out of a full queue before upload
+    uint32_t seriesSent;            // Fast-channel batches
+    uint32_t seriesFailed;
+    uint32_t seriesDropped;
+    uint32_t txBytes;               // JSON uploaded, snapshots and series
+    uint32_t storeCount;            // Offline snapshots waiting for backfill
+    uint32_t storeFill;             // % of the store
+    uint32_t storeLost;             // Overwritten in a full store
+    uint32_t backfilled;            // Stored snapshots uploaded since boot
+    uint32_t commandsReceived;      // Stream events that changed a command
+    uint32_t commandsOverwritten;   // Folded into an update the loop hadn't taken yet
+    uint32_t streamReconnects;
+    uint32_t streamErrors;          // Failed opens and dropped connections
+    uint32_t streamRejected;        // Events outside the command set or malformed
+    uint32_t txLastMs;              // Firebase.updateNode round trip
+    uint32_t txMaxMs;
+    uint32_t rxLastMs;              // Firebase.readStream, time the task spent in it
+    uint32_t rxMaxMs;
+    uint32_t logDropped;            // Log bytes that didn't fit the WebSerial buffer
+};
+
+/*
+    All blocking network I/O - WiFi upkeep, Firebase uploads and streaming, and
+    the WebSerial side of the log - in one task pinned to NET_TASK_CORE. The
+    loop hands over telemetry snapshots and series batches through bounded
+    queues, where the oldest entry goes when one is full, and picks up
+    dashboard commands, streamed from FIREBASE_COMMAND_PATH, with the fields
+    they changed - only those are merged, so a LAN command to another field
+    stands. Neither side ever waits on the network.
+
+    Snapshots that can't be uploaded go to a TelemetryStore and are
+    backfilled, STORE_BACKFILL_BATCH at a time, once the queues are empty
+    and the wall clock is set.
+*/
+class NetworkTask {
+private:
+    FirebaseManager* firebase;
+    WiFiManager* wifi;
+
+    TaskHandle_t taskHandle;
+    QueueHandle_t telemetryQueue;
+    QueueHandle_t seriesQueue;
+    RingbufHandle_t logBuffer;
+
+    TelemetryStore store;
+    StoredSnapshot backfillBatch[STORE_BACKFILL_BATCH];
+    unsigned long lastBackfill;
+
+    portMUX_TYPE commandLock;       // The two below, stream task vs. loop
+    FirebaseRxData commandState;    // Newest from the stream
+    uint16_t commandFields;         // CommandFieldBit bits changed since the loop last took them
+    bool authLogged;
+    std::atomic<bool> routeClearPending;
+
+    std::atomic<uint32_t> telemetryQueueMax;
+    std::atomic<uint32_t> telemetrySent;
+    std::atomic<uint32_t> telemetryFailed;
+    std::atomic<uint32_t> telemetryDropped;
+    std::atomic<uint32_t> seriesSent;
+    std::atomic<uint32_t> seriesFailed;
+    std::atomic<uint32_t> seriesDropped;
+    std::atomic<uint32_t> txBytes;
+    std::atomic<uint32_t> storeCount;
+    std::atomic<uint32_t> storeFill;
+    std::atomic<uint32_t> storeLost;
+    std::atomic<uint32_t> backfilled;
+    std::atomic<uint32_t> commandsReceived;
+    std::atomic<uint32_t> commandsOverwritten;
+    std::atomic<uint32_t> streamReconnects;
+    std::atomic<uint32_t> streamErrors;
+    std::atomic<uint32_t> streamRejected;
+    std::atomic<uint32_t> txLastMs;
+    std::atomic<uint32_t> txMaxMs;
+    std::atomic<uint32_t> rxLastMs;
+    std::atomic<uint32_t> rxMaxMs;
+
+    static void taskWorker(void* _this);
+    void run();
+    void sendTelemetry(const StoredSnapshot& snapshot);
+    void backfill();
+    void updateStoreStats();
+    void readCommands();
+    void drainLog();
+
+public:
+    NetworkTask(FirebaseManager* firebase, WiFiManager* wifi);
+    void begin();
+
+    // Loop side
+    bool queueTelemetry(const FirebaseTxData& data);    // false when an older snapshot was dropped
+    bool queueSeries(const TelemetryBatch& batch);      // false when an older batch was dropped
+    bool takeCommands(FirebaseRxData& data);            // Merges the changed fields, false when none
+    void clearRouteCommand();                           // route_destination back to 0 in the database
+
+    NetworkStats getStats() const;
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include "telemetry_fields.h"
+#include "../sensors/color_type.h"
+#include <math.h>
+#include <string.h>
+
+#define TX_FIELD(name, type, deadband) \
+    { #name, offsetof(FirebaseTxData, name), sizeof(FirebaseTxData::name), type, deadband }
+
+const TelemetryField TELEMETRY_FIELDS[] = {
+    // Sensors
+    TX_FIELD(acceleration, FIELD_FLOAT, 0.2f),
+    TX_FIELD(angular, FIELD_INT, 1),
+    TX_FIELD(battery, FIELD_INT, 0),
+    TX_FIELD(voltage, FIELD_FLOAT, 0.05f),
+
+    // Environment
+    TX_FIELD(temp, FIELD_INT, 0),
+    TX_FIELD(humidity, FIELD_INT, 1),
+    TX_FIELD(lightlevel, FIELD_INT, 0),
+
+    // Health
+    TX_FIELD(hr, FIELD_INT, 0),
+    TX_FIELD(sp02, FIELD_INT, 0),
+
+    // Ultrasonic - the full-rate trace is in the series
+    TX_FIELD(ultrasonic_center, FIELD_INT, 2),
+    TX_FIELD(ultrasonic_left, FIELD_INT, 2),
+    TX_FIELD(ultrasonic_rear, FIELD_INT, 2),
+    TX_FIELD(ultrasonic_right, FIELD_INT, 2),
+
+    // Color, compartment
+    TX_FIELD(colour, FIELD_COLOUR, 0),
+    TX_FIELD(compartment, FIELD_INT, 0),
+
+    // Motor link
+    TX_FIELD(link_rtt_p50, FIELD_FLOAT, 0.25f),
+    TX_FIELD(link_rtt_p99, FIELD_FLOAT, 0.25f),
+    TX_FIELD(link_rtt_max, FIELD_FLOAT, 0.25f),
+    TX_FIELD(link_lost, FIELD_INT, 0),
+    TX_FIELD(link_crc, FIELD_INT, 0),
+    TX_FIELD(link_retx, FIELD_INT, 0),
+    TX_FIELD(link_baud, FIELD_INT, 0),
+    TX_FIELD(link_estop_ms, FIELD_FLOAT, 0),
+    TX_FIELD(link_estop_max_ms, FIELD_FLOAT, 0),
+    TX_FIELD(link_apply_ms, FIELD_FLOAT, 0.5f),
+    TX_FIELD(link_clock_err_us, FIELD_INT, 50),
+
+    // Motor board
+    TX_FIELD(motor_estop, FIELD_INT, 0),
+    TX_FIELD(motor_duty_lf, FIELD_INT, 2),
+    TX_FIELD(motor_duty_lb, FIELD_INT, 2),
+    TX_FIELD(motor_duty_rf, FIELD_INT, 2),
+    TX_FIELD(motor_duty_rb, FIELD_INT, 2),
+    TX_FIELD(motor_timeouts, FIELD_INT, 0),
+    TX_FIELD(motor_exec_max, FIELD_INT, 0),
+    TX_FIELD(motor_frame_errors, FIELD_INT, 0),
+
+    // Network task
+    TX_FIELD(net_tx_ms, FIELD_INT, 50),
+    TX_FIELD(net_rx_ms, FIELD_INT, 0),
+    TX_FIELD(net_queue_max, FIELD_INT, 0),
+    TX_FIELD(net_dropped, FIELD_INT, 0),
+    TX_FIELD(net_log_dropped, FIELD_INT, 0),
+    TX_FIELD(net_stream_reconnects, FIELD_INT, 0),
+    TX_FIELD(net_tx_kb, FIELD_INT, 4),
+    TX_FIELD(net_store_fill, FIELD_INT, 0),
+    TX_FIELD(net_store_lost, FIELD_INT, 0),
+
+    // LAN socket
+    TX_FIELD(lan_clients, FIELD_INT, 0),
+    TX_FIELD(lan_refused, FIELD_INT, 0),
+};
+
+const size_t TELEMETRY_FIELD_COUNT = sizeof(TELEMETRY_FIELDS) / sizeof(TELEMETRY_FIELDS[0]);
+static_assert(sizeof(TELEMETRY_FIELDS) / sizeof(TELEMETRY_FIELDS[0]) <= 64, "TelemetryFieldMask has a bit per field");
+
+const TelemetryFieldMask TELEMETRY_ALL_FIELDS =
+    (TELEMETRY_FIELD_COUNT == 64) ? ~(TelemetryFieldMask)0 : ((TelemetryFieldMask)1 << TELEMETRY_FIELD_COUNT) - 1;
+
+static float fieldValue(const TelemetryField& field, const FirebaseTxData& data) {
+    const uint8_t* base = (const uint8_t*)&data + field.offset;
+    return (field.type == FIELD_FLOAT) ? *(const float*)base : (float)*(const int*)base;
+}
+
+TelemetryFieldMask telemetryChanges(const FirebaseTxData& now, const FirebaseTxData& sent) {
+    TelemetryFieldMask changed = 0;
+    for (size_t i = 0; i < TELEMETRY_FIELD_COUNT; i++) {
+        const TelemetryField& field = TELEMETRY_FIELDS[i];
+        if (fabsf(fieldValue(field, now) - fieldValue(field, sent)) > field.deadband) {
+            changed |= (TelemetryFieldMask)1 << i;
+        }
+    }
+    return changed;
+}
+
+void copyTelemetryFields(FirebaseTxData& to, const FirebaseTxData& from, TelemetryFieldMask mask) {
+    for (size_t i = 0; i < TELEMETRY_FIELD_COUNT; i++) {
+        if (!(mask & ((TelemetryFieldMask)1 << i))) continue;
+        const TelemetryField& field = TELEMETRY_FIELDS[i];
+        memcpy((uint8_t*)&to + field.offset, (const uint8_t*)&from + field.offset, field.size);
+    }
+}
+
+void writeTelemetry(JsonWriter& json, const char* key, const FirebaseTxData& data, TelemetryFieldMask mask) {
+    json.beginObject(key);
+    writeTelemetryFields(json, data, mask);
+    json.endObject();
+}
+
+void writeTelemetryFields(JsonWriter& json, const FirebaseTxData& data, TelemetryFieldMask mask) {
+    for (size_t i = 0; i < TELEMETRY_FIELD_COUNT; i++) {
+        if (!(mask & ((TelemetryFieldMask)1 << i))) continue;
+        const TelemetryField& field = TELEMETRY_FIELDS[i];
+        const uint8_t* base = (const uint8_t*)&data + field.offset;
+        switch (field.type) {
+            case FIELD_INT:    json.addInt(field.key, *(const int*)base); break;
+            case FIELD_FLOAT:  json.addFloat(field.key, *(const float*)base); break;
+            case FIELD_COLOUR: json.addText(field.key, colorTypeToString(*(const int*)base)); break;
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef TELEMETRY_FIELDS_H
+#define TELEMETRY_FIELDS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "json_writer.h"
+
+// Plain data only - snapshots are copied through a FreeRTOS queue. A field
+// added here also needs its entry in TELEMETRY_FIELDS (telemetry_fields.cpp).
+struct FirebaseTxData {
+    // Sensor readings - SEND ONLY
+    float acceleration;        // Send acceleration
+    int angular;               // Send angular velocity
+    int battery;               // Send battery level
+    float voltage;             // Send voltage
+    int temp;                  // Send temperature
+    int humidity;              // Send humidity
+    int lightlevel;            // Send light amount from path LDRs
+    int hr;                    // Send heart rate
+    int sp02;                  // Send SpO2 level
+    int ultrasonic_center;     // Send center distance
+    int ultrasonic_left;       // Send left distance
+    int ultrasonic_rear;       // Send rear distance
+    int ultrasonic_right;      // Send right distance
+    int colour;                // Send detected color, a ColorType - uploaded by name
+    int compartment;           // Send compartment state (0=open, 255=closed)
+
+    // S3 <-> motor board link quality - SEND ONLY
+    float link_rtt_p50;        // ms
+    float link_rtt_p99;        // ms
+    float link_rtt_max;        // ms
+    int link_lost;             // Frames never acknowledged
+    int link_crc;              // Corrupt frames received
+    int link_retx;             // Frames resent without an ack
+    int link_baud;             // Current S3 <-> motor board rate
+    float link_estop_ms;       // Last e-stop decision -> bridges braked, ms; 0 before the clocks sync
+    float link_estop_max_ms;
+    float link_apply_ms;       // Command sent -> WROOM outputs changed, last frame
+    int link_clock_err_us;     // Cross-board clock error bound, -1 until synced
+
+    // Motor board status - SEND ONLY
+    int motor_estop;           // 0 none, 1 button, 2 UART, -1 when the WROOM isn't reporting
+    int motor_duty_lf;         // Applied duty %, negative = backward
+    int motor_duty_lb;
+    int motor_duty_rf;
+    int motor_duty_rb;
+    int motor_timeouts;        // Command timeout stops since boot
+    int motor_exec_max;        // Longest control cycle, us
+    int motor_frame_errors;    // Corrupt frames seen by the WROOM
+
+    // Network task - SEND ONLY
+    int net_tx_ms;             // Last telemetry upload round trip
+    int net_rx_ms;             // Longest command stream read since boot
+    int net_queue_max;         // Deepest the telemetry queue has been
+    int net_dropped;           // Snapshots dropped from a full queue
+    int net_log_dropped;       // Log bytes WebSerial never got
+    int net_stream_reconnects; // Command stream reopened after a drop
+    int net_tx_kb;             // Telemetry JSON uploaded since boot, KB
+    int net_store_fill;        // Offline store, % full
+    int net_store_lost;        // Offline snapshots overwritten before backfill
+
+    // LAN WebSocket - SEND ONLY
+    int lan_clients;           // Connected now
+    int lan_refused;           // Clients and commands turned away, since boot
+};
+
+enum TelemetryFieldType : uint8_t {
+    FIELD_INT,
+    FIELD_FLOAT,
+    FIELD_COLOUR                // ColorType, uploaded by name
+};
+
+struct TelemetryField {
+    const char* key;
+    size_t offset;
+    size_t size;
+    TelemetryFieldType type;
+    float deadband;             // Smaller changes aren't uploaded
+};
+
+// One bit per TELEMETRY_FIELDS entry
+typedef uint64_t TelemetryFieldMask;
+
+extern const TelemetryField TELEMETRY_FIELDS[];
+extern const size_t TELEMETRY_FIELD_COUNT;
+extern const TelemetryFieldMask TELEMETRY_ALL_FIELDS;
+
+// Fields of now that moved past their deadband from sent
+TelemetryFieldMask telemetryChanges(const FirebaseTxData& now, const FirebaseTxData& sent);
+
+// Copies the fields in mask from one snapshot to another
+void copyTelemetryFields(FirebaseTxData& to, const FirebaseTxData& from, TelemetryFieldMask mask);
+
+// The fields in mask as one object - under key, or the outermost object when key is NULL
+void writeTelemetry(JsonWriter& json, const char* key, const FirebaseTxData& data,
+                    TelemetryFieldMask mask = ~(TelemetryFieldMask)0);
+// The same fields into the object already open in json
+void writeTelemetryFields(JsonWriter& json, const FirebaseTxData& data,
+                          TelemetryFieldMask mask = ~(TelemetryFieldMask)0);
+
+#endif
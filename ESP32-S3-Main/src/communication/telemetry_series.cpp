@@ -0,0 +1,68 @@
+#include "telemetry_series.h"
+
+const SeriesChannelInfo SERIES_CHANNELS[SERIES_CHANNEL_COUNT] = {
+    {"acc",   100.0f, 10},          // 0.1 m/s^2 - the reading is rounded to that anyway
+    {"ang",   1.0f,   0},
+    {"us_c",  1.0f,   1},
+    {"us_l",  1.0f,   1},
+    {"us_b",  1.0f,   1},
+    {"us_r",  1.0f,   1},
+    {"light", 1.0f,   0},
+};
+
+TelemetrySeries::TelemetrySeries() {
+    memset(&batch, 0, sizeof(batch));
+    open = false;
+    lastIndex = 0;
+    memset(lastRecorded, 0, sizeof(lastRecorded));
+    haveRecorded = false;
+    nextSeq = 0;
+    points = 0;
+    skipped = 0;
+}
+
+void TelemetrySeries::startBatch(uint32_t now) {
+    batch.seq = nextSeq++;
+    batch.startMs = now;
+    batch.samples = 0;
+    batch.keyframe = (batch.seq % TELEMETRY_KEYFRAME_BATCHES == 0);
+    memset(batch.counts, 0, sizeof(batch.counts));
+    open = true;
+}
+
+void TelemetrySeries::add(uint32_t now, const float values[SERIES_CHANNEL_COUNT]) {
+    if (!open) startBatch(now);
+
+    uint32_t slot = (now - batch.startMs) / TELEMETRY_SAMPLE_MS;
+    if (slot >= TELEMETRY_BATCH_SAMPLES) slot = TELEMETRY_BATCH_SAMPLES - 1;
+    uint8_t index = (uint8_t)slot;
+    if (batch.samples > 0 && index == lastIndex) return;    // Slot already sampled
+    bool first = (batch.samples == 0);
+    lastIndex = index;
+    batch.samples++;
+
+    for (uint8_t c = 0; c < SERIES_CHANNEL_COUNT; c++) {
+        float scaled = roundf(values[c] * SERIES_CHANNELS[c].scale);
+        int16_t value = (int16_t)constrain(scaled, -32768.0f, 32767.0f);
+
+        bool record = !haveRecorded || (first && batch.keyframe) ||
+                      abs(value - lastRecorded[c]) > SERIES_CHANNELS[c].deadband;
+        if (!record) {
+            skipped++;
+            continue;
+        }
+        batch.points[c][batch.counts[c]++] = {index, value};
+        lastRecorded[c] = value;
+        points++;
+    }
+    haveRecorded = true;
+}
+
+bool TelemetrySeries::takeBatch(uint32_t now, TelemetryBatch& out) {
+    if (!open || now - batch.startMs < (uint32_t)TELEMETRY_BATCH_SAMPLES * TELEMETRY_SAMPLE_MS) {
+        return false;
+    }
+    out = batch;
+    open = false;
+    return true;
+}
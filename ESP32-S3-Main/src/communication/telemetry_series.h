@@ -0,0 +1,75 @@
+#ifndef TELEMETRY_SERIES_H
+#define TELEMETRY_SERIES_H
+
+#include <Arduino.h>
+#include "../config/constants.h"
+
+// Fast channels - sampled at TELEMETRY_SAMPLE_MS instead of once per status snapshot
+enum SeriesChannel : uint8_t {
+    SERIES_ACCELERATION,        // m/s^2
+    SERIES_ANGULAR,             // Roll, degrees
+    SERIES_US_CENTER,           // cm
+    SERIES_US_LEFT,
+    SERIES_US_REAR,
+    SERIES_US_RIGHT,
+    SERIES_LIGHT,               // Path light level
+    SERIES_CHANNEL_COUNT
+};
+
+struct SeriesChannelInfo {
+    const char* key;            // Array name in the upload
+    float scale;                // Stored value = reading x scale
+    int16_t deadband;           // Stored units - smaller moves aren't recorded
+};
+
+extern const SeriesChannelInfo SERIES_CHANNELS[SERIES_CHANNEL_COUNT];
+
+struct SeriesPoint {
+    uint8_t index;              // Sample slot within the batch
+    int16_t value;
+};
+
+// One upload. Per channel, only the samples that moved past its deadband
+// since the last recorded one; a reader holds the previous value in between.
+struct TelemetryBatch {
+    uint32_t seq;
+    uint32_t startMs;           // millis() of slot 0, slots are TELEMETRY_SAMPLE_MS apart
+    uint8_t samples;            // Slots actually sampled
+    bool keyframe;              // Every channel has a point at its first sample
+    uint8_t counts[SERIES_CHANNEL_COUNT];
+    SeriesPoint points[SERIES_CHANNEL_COUNT][TELEMETRY_BATCH_SAMPLES];
+};
+
+/*
+    Collects the fast channels into TELEMETRY_BATCH_SAMPLES-slot batches.
+    Samples are placed by time, not by count, so a slow loop pass leaves
+    an empty slot instead of stretching the series. Every
+    TELEMETRY_KEYFRAME_BATCHES-th batch is a keyframe, so a reader that
+    missed batches is back in step within that many.
+*/
+class TelemetrySeries {
+private:
+    TelemetryBatch batch;
+    bool open;
+    uint8_t lastIndex;
+    int16_t lastRecorded[SERIES_CHANNEL_COUNT];
+    bool haveRecorded;
+    uint32_t nextSeq;
+    uint32_t points;            // Recorded
+    uint32_t skipped;           // Inside the deadband
+
+    void startBatch(uint32_t now);
+
+public:
+    TelemetrySeries();
+
+    void add(uint32_t now, const float values[SERIES_CHANNEL_COUNT]);
+
+    // Closes the batch once its time span is over - true with it in out
+    bool takeBatch(uint32_t now, TelemetryBatch& out);
+
+    uint32_t getPoints() const { return points; }
+    uint32_t getSkipped() const { return skipped; }
+};
+
+#endif
@@ -0,0 +1,78 @@
+#include "telemetry_store.h"
+#include "../config/constants.h"
+#include "../utils/logger.h"
+
+TelemetryStore::TelemetryStore() {
+    records = NULL;
+    capacity = 0;
+    head = 0;
+    count = 0;
+    stored = 0;
+    lost = 0;
+    inPsram = false;
+}
+
+TelemetryStore::~TelemetryStore() {
+    free(records);
+}
+
+void TelemetryStore::begin() {
+    if (records != NULL) return;
+
+    if (psramFound()) {
+        capacity = STORE_PSRAM_BYTES / sizeof(StoredSnapshot);
+        records = (StoredSnapshot*)ps_malloc((size_t)capacity * sizeof(StoredSnapshot));
+        inPsram = (records != NULL);
+    }
+    if (records == NULL) {
+        capacity = STORE_FALLBACK_RECORDS;
+        records = (StoredSnapshot*)malloc((size_t)capacity * sizeof(StoredSnapshot));
+    }
+    if (records == NULL) {
+        capacity = 0;
+        Log.println("Telemetry store: allocation failed, offline snapshots will be lost");
+        return;
+    }
+
+    Log.print("Telemetry store: ");
+    Log.print(capacity);
+    Log.println(inPsram ? " snapshots in PSRAM" : " snapshots in internal RAM");
+}
+
+void TelemetryStore::push(uint32_t capturedMs, const FirebaseTxData& data) {
+    if (capacity == 0) {
+        lost++;
+        return;
+    }
+
+    if (count == capacity) {
+        head = (head + 1) % capacity;
+        count--;
+        lost++;
+    }
+    StoredSnapshot& slot = records[(head + count) % capacity];
+    slot.capturedMs = capturedMs;
+    slot.data = data;
+    count++;
+    stored++;
+}
+
+uint32_t TelemetryStore::peek(StoredSnapshot* out, uint32_t max) const {
+    uint32_t n = min(max, count);
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = records[(head + i) % capacity];
+    }
+    return n;
+}
+
+void TelemetryStore::drop(uint32_t n) {
+    if (n > count) n = count;
+    if (n == 0) return;
+    head = (head + n) % capacity;
+    count -= n;
+}
+
+uint8_t TelemetryStore::getFillPercent() const {
+    if (capacity == 0) return 0;
+    return (uint8_t)((uint64_t)count * 100 / capacity);
+}
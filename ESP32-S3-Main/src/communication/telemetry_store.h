@@ -0,0 +1,49 @@
+#ifndef TELEMETRY_STORE_H
+#define TELEMETRY_STORE_H
+
+#include <Arduino.h>
+#include "firebase_manager.h"
+
+struct StoredSnapshot {
+    uint32_t capturedMs;        // millis() when the loop took it
+    FirebaseTxData data;
+};
+
+/*
+    Status snapshots that couldn't be uploaded, held in PSRAM until the
+    network is back. A ring: once full, the oldest snapshot makes room for
+    the newest and is counted as lost. Owned by the network task - not
+    safe to use from the loop.
+*/
+class TelemetryStore {
+private:
+    StoredSnapshot* records;
+    uint32_t capacity;
+    uint32_t head;              // Oldest
+    uint32_t count;
+    uint32_t stored;
+    uint32_t lost;              // Overwritten before they were uploaded
+    bool inPsram;
+
+public:
+    TelemetryStore();
+    ~TelemetryStore();
+
+    void begin();
+
+    void push(uint32_t capturedMs, const FirebaseTxData& data);
+
+    // Copies up to max of the oldest snapshots into out without removing them
+    uint32_t peek(StoredSnapshot* out, uint32_t max) const;
+    // Removes the n oldest, once they've been uploaded
+    void drop(uint32_t n);
+
+    uint32_t getCount() const { return count; }
+    uint32_t getCapacity() const { return capacity; }
+    uint8_t getFillPercent() const;
+    uint32_t getStored() const { return stored; }
+    uint32_t getLost() const { return lost; }
+    bool isPsram() const { return inPsram; }
+};
+
+#endif
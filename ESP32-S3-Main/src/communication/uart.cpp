@@ -6,24 +6,584 @@
 UARTProtocol::UARTProtocol() {
     serial = &Serial1;
     lastSendTime = 0;
+    lastSentPacket = PACKET_NONE;
     lastSentCommand = CMD_STOP;
+    txSequence = 0;
+    lastMotionSeq = 0;
+    lastChangeTime = 0;
+    lastFrameAcked = false;
+    lastSentSpeed = 0;
+    memset(lastSentWheels, 0, sizeof(lastSentWheels));
+    memset(lastSentVelocity, 0, sizeof(lastSentVelocity));
+    maneuverSeq = 0;
+    maneuverActive = false;
+    lastSegmentStatus = {0, SEGMENT_DONE, 0, 0};
+    segmentStatusPending = false;
     isWaitingForAck = false;
     lastAckTime = 0;
+    lastRxTime = 0;
+    estopSeq = 0;
+    estopDecisionUs = 0;
+    estopAcked = true;
+    estopAttempts = 0;
+    estopLastBurst = 0;
+    estopRequested = false;
+    memset(&motorStatus, 0, sizeof(motorStatus));
+    motorStatusTime = 0;
+    lastAppliedSeq = 0;
+    syncSeq = 0;
+    syncSentUs = 0;
+    lastSyncTime = 0;
     initialized = false;
+
+    memset(busNodes, 0, sizeof(busNodes));
+    busNodes[0].node = NODE_PRIMARY;
+    busNodeCount = 1;
+    busPollIndex = 0;
+    busCycleStart = 0;
+    busCycles = 0;
+    busOverruns = 0;
+    busPendingIndex = -1;
+    busPendingUs = 0;
+    busQueueHead = 0;
+    busQueueCount = 0;
+    busDropped = 0;
+
+    linkState = LINK_BASE_RATE;
+    candidate = 0;
+    baudRate = UART_BAUD_RATE;
+    linkStateTime = 0;
+    linkAttempts = 0;
+    testSeq = 0;
+    testsPassed = 0;
+    testPending = false;
+    testRetries = 0;
+    errorWindowStart = 0;
+    errorWindowBase = 0;
 }
 
 void UARTProtocol::begin() {
     serial->begin(UART_BAUD_RATE, SERIAL_8N1, UART_RX, UART_TX);
     transfer.begin(*serial);
     initialized = true;
+
+    // Start looking for a faster rate straight away
+    linkState = LINK_PROPOSING;
+    linkStateTime = millis() - UART_BAUD_RETRY_MS;
+    linkAttempts = 0;
+}
+
+void UARTProtocol::update() {
+    if (!initialized) return;
+
+    serviceEmergencyRequest();
+
+    // E-stop not confirmed yet - keep repeating it
+    if (!estopAcked && millis() - estopLastBurst >= ESTOP_RETRY_MS) {
+        if (estopAttempts >= ESTOP_RETRY_LIMIT) {
+            Log.println("⚠ E-STOP NOT ACKNOWLEDGED by motor board");
+            link.onEmergencyUnacked();
+            estopAcked = true;
+        } else {
+            sendEmergencyBurst();
+        }
+    }
+
+    link.expire();
+    updateLinkRate();
+
+    // Clock probes only while the rate is settled - faster until the estimate locks
+    bool rateSettled = (linkState == LINK_BASE_RATE || linkState == LINK_FAST);
+    unsigned long syncPeriod = clock.isSynced() ? CLOCK_SYNC_PERIOD_MS : CLOCK_SYNC_FAST_MS;
+    if (rateSettled && millis() - lastSyncTime >= syncPeriod) {
+        sendTimeSync();
+    }
+
+    // Nothing changed for a while - tell the WROOM the last command still stands
+    if (millis() - lastSendTime >= UART_HEARTBEAT_MS) {
+        sendHeartbeat();
+    }
+
+    serviceBus();
+}
+
+void UARTProtocol::sendHeartbeat() {
+    Heartbeat heartbeat;
+    heartbeat.seq = ++txSequence;
+
+    sendBusMessage(0, heartbeat);
+
+    // Not a motion frame - the change tracking is left alone
+    lastSendTime = millis();
+    link.onSent(heartbeat.seq);
+}
+
+void UARTProtocol::sendTimeSync() {
+    // Stamped for the moment it goes out - a queued probe would skew the sample
+    if (isBus() && !isBusFree()) return;
+
+    TimeSyncFrame* sync = beginMessage<TimeSyncFrame>(transfer.packet.txBuff);
+    memset(sync, 0, sizeof(TimeSyncFrame));
+    sync->seq = syncSeq = ++txSequence;
+
+    // Stamped last, right before the frame goes to the UART
+    sync->mainSentUs = syncSentUs = micros();
+    transmit(0, sizeof(TimeSyncFrame), busFrameId(NODE_PRIMARY, PACKET_TIME_SYNC));
+    lastSyncTime = millis();
+}
+
+void UARTProtocol::handleTimeSync(uint32_t rxUs) {
+    const TimeSyncFrame* reply = viewMessage<TimeSyncFrame>(transfer.packet.rxBuff);
+    if (reply->seq != syncSeq || reply->mainSentUs != syncSentUs) return;   // Stale probe
+
+    bool wasSynced = clock.isSynced();
+    uint32_t steps = clock.getSteps();
+    clock.addSample(reply->mainSentUs, reply->motorRxUs, reply->motorTxUs, rxUs);
+
+    if (clock.getSteps() != steps) {
+        Log.println("UART: motor board clock jumped (restart?) - resyncing");
+    } else if (!wasSynced && clock.isSynced()) {
+        Log.print("UART: clocks synced, +/- ");
+        Log.print(clock.getErrorUs(rxUs));
+        Log.println(" us");
+    }
+}
+
+void UARTProtocol::handleMotorStatus() {
+    motorStatus = *viewMessage<MotorStatus>(transfer.packet.rxBuff);
+    motorStatusTime = millis();
+    lastAckTime = motorStatusTime;
+
+    // New frame on the outputs - place it on the S3 timeline against its send time
+    if (!clock.isSynced() || motorStatus.appliedUs == 0 || motorStatus.appliedSeq == lastAppliedSeq) return;
+    lastAppliedSeq = motorStatus.appliedSeq;
+
+    uint32_t sentUs;
+    if (!link.getSentTime(motorStatus.appliedSeq, sentUs)) return;
+    int32_t latency = (int32_t)(clock.toMainTime(motorStatus.appliedUs) - sentUs);
+    if (latency >= 0 && latency < 1000000L) {
+        link.onApplied(latency);
+    }
+}
+
+void UARTProtocol::updateLinkRate() {
+    unsigned long now = millis();
+
+    switch (linkState) {
+        case LINK_BASE_RATE:
+            // Only when the WROOM never answered - a rate that failed is not retried
+            if (candidate < LINK_BAUD_RATE_COUNT && now - linkStateTime >= UART_RENEGOTIATE_MS) {
+                linkState = LINK_PROPOSING;
+                linkAttempts = 0;
+            }
+            break;
+
+        case LINK_PROPOSING:
+            if (now - linkStateTime < UART_BAUD_RETRY_MS) break;
+            if (linkAttempts >= UART_BAUD_ATTEMPTS) {
+                Log.println("UART: no answer to rate proposal, staying at base rate");
+                fallBack(false);
+                break;
+            }
+            proposeBaud();
+            break;
+
+        case LINK_TESTING: {
+            // An echo already in the RX buffer isn't a timeout, however late the loop is
+            MotorCommand cmd;
+            uint8_t speed;
+            while (testPending && serial->available() > 0) {
+                receiveAcknowledgment(cmd, speed);
+            }
+            if (linkState != LINK_TESTING) break;       // Echo came back corrupted
+
+            if (testPending && now - linkStateTime < UART_LINK_TEST_TIMEOUT_MS) break;
+            if (testPending) {
+                // One lost frame isn't a bad rate - resend before giving it up
+                if (testRetries < UART_LINK_TEST_RETRIES) {
+                    testRetries++;
+                    Log.println("UART: link test timed out - resending");
+                    sendLinkTest();
+                    break;
+                }
+                Log.println("UART: link test timed out");
+                fallBack(true);
+                break;
+            }
+            if (testsPassed >= UART_LINK_TEST_FRAMES) {
+                Log.print("UART: running at ");
+                Log.print(baudRate);
+                Log.println(" baud");
+                linkState = LINK_FAST;
+                errorWindowStart = now;
+                errorWindowBase = link.getErrorCount();
+                break;
+            }
+            sendLinkTest();
+            break;
+        }
+
+        case LINK_FAST:
+            // The WROOM drops back on its own when it stops hearing us, so
+            // silence here means both ends are at the base rate already
+            if (now - lastRxTime > UART_LINK_SILENCE_MS) {
+                Log.println("UART: link silent at negotiated rate - falling back");
+                fallBack(true);
+                break;
+            }
+            if (link.getErrorCount() - errorWindowBase > UART_LINK_ERROR_LIMIT) {
+                Log.println("UART: link errors climbing - stepping down");
+                fallBack(true);
+                break;
+            }
+            if (now - errorWindowStart >= 1000) {
+                errorWindowStart = now;
+                errorWindowBase = link.getErrorCount();
+            }
+            break;
+    }
+}
+
+void UARTProtocol::proposeBaud() {
+    BaudProposal proposal;
+    proposal.seq = ++txSequence;
+    proposal.accepted = 0;
+    proposal.version = PROTOCOL_VERSION;
+    proposal.reserved = 0;
+    proposal.baud = LINK_BAUD_RATES[candidate];
+
+    sendMessage(proposal);
+    link.onSent(proposal.seq);
+
+    linkStateTime = millis();
+    linkAttempts++;
+}
+
+// Every byte value shows up across a test run, framing bytes included
+static uint8_t linkTestByte(uint8_t frame, uint8_t index) {
+    return (uint8_t)((frame * LINK_TEST_PATTERN_LEN + index) * 167);
+}
+
+void UARTProtocol::sendLinkTest() {
+    // Pattern is written straight into the frame buffer
+    LinkTestFrame* test = beginMessage<LinkTestFrame>(transfer.packet.txBuff);
+    test->seq = ++txSequence;
+    for (uint8_t i = 0; i < LINK_TEST_PATTERN_LEN; i++) {
+        test->pattern[i] = linkTestByte(testsPassed, i);
+    }
+
+    testSeq = test->seq;
+    transfer.sendData(sizeof(LinkTestFrame), PACKET_LINK_TEST);
+    link.onSent(testSeq);
+
+    testPending = true;
+    linkStateTime = millis();
+}
+
+void UARTProtocol::handleLinkFrame(uint8_t packet) {
+    if (packet == PACKET_BAUD_PROPOSE) {
+        const BaudProposal* reply = viewMessage<BaudProposal>(transfer.packet.rxBuff);
+        if (linkState != LINK_PROPOSING || reply->baud != LINK_BAUD_RATES[candidate]) return;
+
+        if (reply->version != PROTOCOL_VERSION) {
+            // Older or newer motor firmware - the base rate still works, faster ones aren't tried
+            Log.print("UART: motor board speaks protocol v");
+            Log.print(reply->version);
+            Log.print(", expected v");
+            Log.println(PROTOCOL_VERSION);
+            candidate = LINK_BAUD_RATE_COUNT;
+            fallBack(false);
+            return;
+        }
+
+        if (!reply->accepted) {
+            fallBack(true);
+            return;
+        }
+
+        // The WROOM switches once its reply is out - follow it and verify
+        setBaudRate(reply->baud);
+        linkState = LINK_TESTING;
+        testsPassed = 0;
+        testPending = false;
+        testRetries = 0;
+        return;
+    }
+
+    // Test echo - must come back bit for bit
+    const LinkTestFrame* echo = viewMessage<LinkTestFrame>(transfer.packet.rxBuff);
+    if (linkState != LINK_TESTING || !testPending || echo->seq != testSeq) return;
+
+    for (uint8_t i = 0; i < LINK_TEST_PATTERN_LEN; i++) {
+        if (echo->pattern[i] != linkTestByte(testsPassed, i)) {
+            Log.println("UART: link test pattern corrupted");
+            fallBack(true);
+            return;
+        }
+    }
+    testPending = false;
+    testsPassed++;
+}
+
+void UARTProtocol::setBaudRate(uint32_t baud) {
+    if (baud == baudRate) return;
+    serial->flush();
+    serial->updateBaudRate(baud);
+    baudRate = baud;
+}
+
+void UARTProtocol::fallBack(bool rateFailed) {
+    // Never try this rate again; the next proposal goes out at the base rate
+    // and is retried until the WROOM has dropped back too
+    if (rateFailed && candidate < LINK_BAUD_RATE_COUNT) {
+        candidate++;
+    }
+    setBaudRate(UART_BAUD_RATE);
+    testPending = false;
+    linkAttempts = 0;
+    linkStateTime = millis();
+    linkState = (rateFailed && candidate < LINK_BAUD_RATE_COUNT) ? LINK_PROPOSING : LINK_BASE_RATE;
+}
+
+int8_t UARTProtocol::busIndex(uint8_t node) const {
+    for (uint8_t i = 0; i < busNodeCount; i++) {
+        if (busNodes[i].node == node) return i;
+    }
+    return -1;
+}
+
+bool UARTProtocol::addBusNode(uint8_t node) {
+    if (node == NODE_PRIMARY || node > MAX_BUS_NODE) return false;
+    if (busIndex(node) >= 0 || busNodeCount >= BUS_MAX_NODES) return false;
+
+    if (!isBus()) {
+        // Every board has to stay on the same rate - no more proposals
+        candidate = LINK_BAUD_RATE_COUNT;
+        if (linkState != LINK_BASE_RATE) fallBack(false);
+        Log.println("UART: motor bus enabled, staying at base rate");
+    }
+
+    BusNode& entry = busNodes[busNodeCount++];
+    memset(&entry, 0, sizeof(entry));
+    entry.node = node;
+    entry.stats.node = node;
+
+    Log.print("UART: bus node ");
+    Log.print(node);
+    Log.println(" added");
+    return true;
+}
+
+void UARTProtocol::setNodeWheels(uint8_t node, const int8_t wheels[WHEEL_COUNT]) {
+    int8_t index = busIndex(node);
+    if (index <= 0) return;   // The primary is driven through the normal senders
+
+    for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+        busNodes[index].wheels[i] = constrain(wheels[i], -100, 100);
+    }
+    busNodes[index].hasSetpoint = true;
+}
+
+bool UARTProtocol::getNodeStatus(uint8_t node, MotorStatus &status) const {
+    if (node == NODE_PRIMARY) {
+        status = motorStatus;
+        return isMotorStatusFresh();
+    }
+
+    int8_t index = busIndex(node);
+    if (index < 0) return false;
+    status = busNodes[index].status;
+    return busNodes[index].statusTime != 0 && millis() - busNodes[index].statusTime < MOTOR_STATUS_STALE_MS;
+}
+
+void UARTProtocol::serviceBus() {
+    if (!isBus()) return;
+
+    // A reply already in the RX buffer isn't a timeout, however late the loop is
+    MotorCommand cmd;
+    uint8_t speed;
+    while (busPendingIndex >= 0 && serial->available() > 0) {
+        receiveAcknowledgment(cmd, speed);
+    }
+    advanceBus();
+
+    if (millis() - busCycleStart < BUS_CYCLE_MS) return;
+
+    // A slow loop pass skips cycles rather than bunching them up
+    if (busCycles > 0 && millis() - busCycleStart >= 2 * BUS_CYCLE_MS) busOverruns++;
+    busCycleStart = millis();
+    busCycles++;
+
+    // The primary gets its setpoints from the modes as they change
+    for (uint8_t i = 1; i < busNodeCount; i++) {
+        if (busNodes[i].hasSetpoint) sendNodeSetpoint(i);
+    }
+
+    // One status per cycle, primary included
+    sendStatusPoll(busPollIndex);
+    busPollIndex = (busPollIndex + 1) % busNodeCount;
+}
+
+void UARTProtocol::sendNodeSetpoint(uint8_t index) {
+    WheelSetpoint setpoint;
+    memcpy(setpoint.wheels, busNodes[index].wheels, sizeof(setpoint.wheels));
+    setpoint.seq = ++txSequence;
+
+    sendBusMessage(index, setpoint);
+}
+
+void UARTProtocol::sendStatusPoll(uint8_t index) {
+    StatusPoll poll;
+    poll.seq = ++txSequence;
+
+    sendBusMessage(index, poll);
+}
+
+void UARTProtocol::transmit(uint8_t index, uint8_t length, uint8_t id) {
+    if (!isBus()) {
+        transfer.sendData(length, id);
+        return;
+    }
+
+    // The frame is in txBuff - only the timeout is checked, sending a queued
+    // frame now would overwrite it
+    expireBus();
+    if (busPendingIndex < 0 && busQueueCount == 0) {
+        transfer.sendData(length, id);
+        claimBus(index);
+        return;
+    }
+
+    // A reply is due - the frame waits its turn. Full means the slot has been
+    // timing out for a while; the oldest frame is the stalest.
+    if (busQueueCount == BUS_QUEUE_LEN) {
+        busQueueHead = (busQueueHead + 1) % BUS_QUEUE_LEN;
+        busQueueCount--;
+        busDropped++;
+    }
+    BusFrame& frame = busQueue[(busQueueHead + busQueueCount) % BUS_QUEUE_LEN];
+    frame.index = index;
+    frame.id = id;
+    frame.length = length;
+    memcpy(frame.payload, transfer.packet.txBuff, length);
+    busQueueCount++;
+    advanceBus();
+}
+
+bool UARTProtocol::isBusFree() {
+    advanceBus();
+    return busPendingIndex < 0 && busQueueCount == 0;
+}
+
+void UARTProtocol::claimBus(uint8_t index) {
+    // Only one node may be answering at a time - the return line is shared
+    if (!isBus()) return;
+
+    busPendingIndex = index;
+    busPendingUs = micros();
+    busNodes[index].stats.requests++;
+}
+
+void UARTProtocol::expireBus() {
+    if (busPendingIndex >= 0 && micros() - busPendingUs >= BUS_REPLY_TIMEOUT_US) {
+        busNodes[busPendingIndex].stats.timeouts++;
+        busPendingIndex = -1;
+    }
+}
+
+void UARTProtocol::advanceBus() {
+    expireBus();
+
+    // Next queued frame as soon as the line is free - its send opens the slot again
+    if (busPendingIndex >= 0 || busQueueCount == 0) return;
+    BusFrame& frame = busQueue[busQueueHead];
+    busQueueHead = (busQueueHead + 1) % BUS_QUEUE_LEN;
+    busQueueCount--;
+
+    memcpy(transfer.packet.txBuff, frame.payload, frame.length);
+    transfer.sendData(frame.length, frame.id);
+    claimBus(frame.index);
+}
+
+void UARTProtocol::releaseBus(uint8_t node, uint8_t packet, uint32_t rxUs) {
+    if (busPendingIndex < 0 || busNodes[busPendingIndex].node != node) return;
+
+    // Sent on their own - the reply the slot is waiting for comes after them
+    if (packet == PACKET_SEGMENT_STATUS || packet == PACKET_EMERGENCY_STOP) return;
+
+    BusNode& entry = busNodes[busPendingIndex];
+    uint32_t latency = rxUs - busPendingUs;
+    entry.stats.replies++;
+    entry.stats.latencyLastUs = latency;
+    if (latency > entry.stats.latencyMaxUs) entry.stats.latencyMaxUs = latency;
+    entry.latencySum += latency;
+    entry.stats.latencyAvgUs = (uint32_t)(entry.latencySum / entry.stats.replies);
+    busPendingIndex = -1;
+}
+
+void UARTProtocol::handleNodeFrame(uint8_t node, uint8_t packet) {
+    int8_t index = busIndex(node);
+    if (index < 0) return;   // A board nobody added
+
+    // Setpoint acks only matter for the slot; the status is kept for getNodeStatus()
+    if (packet == PACKET_MOTOR_STATUS) {
+        busNodes[index].status = *viewMessage<MotorStatus>(transfer.packet.rxBuff);
+        busNodes[index].statusTime = millis();
+    }
+}
+
+LinkStats UARTProtocol::getLinkStats() {
+    LinkStats stats = link.getStats();
+    stats.baudRate = baudRate;
+    stats.clockOffsetUs = clock.getOffsetUs();
+    stats.clockDriftPpm = clock.getDriftPpm();
+    stats.clockErrorUs = clock.getErrorUs(micros());
+    return stats;
+}
+
+bool UARTProtocol::isRepeat(PacketId packet, bool samePayload) {
+    if (packet != lastSentPacket || !samePayload) {
+        return false;
+    }
+
+    // Resent anyway if the WROOM never confirmed it, or as a periodic refresh
+    if (!lastFrameAcked) {
+        link.onRetransmit();
+        return false;
+    }
+    if (millis() - lastChangeTime >= UART_REFRESH_MS) {
+        return false;
+    }
+    link.onSuppressed();
+    return true;
+}
+
+void UARTProtocol::markSent(PacketId packet, uint8_t seq) {
+    link.onSent(seq);
+    lastSentPacket = packet;
+    lastMotionSeq = seq;
+    lastSendTime = millis();
+    lastChangeTime = lastSendTime;
+    lastFrameAcked = false;
+    isWaitingForAck = true;
 }
 
 
 void UARTProtocol::sendMotorCommand(MotorCommand cmd, uint8_t speed) {
     if (!initialized) return;
 
+    if (cmd == CMD_EMERGENCY_STOP) {
+        sendEmergencyStop();
+        return;
+    }
+    serviceEmergencyRequest();
+
     uint8_t cmdValue = (uint8_t)cmd;
     uint8_t speedValue = constrain(speed, 0, 100);
+
+    if (isRepeat(PACKET_MOTOR_COMMAND, cmd == lastSentCommand && speedValue == lastSentSpeed)) {
+        return;
+    }
     
     // DEBUG: Visualize outgoing command
     Log.print("-> MOTOR_TX: Cmd ");
@@ -31,33 +591,281 @@ void UARTProtocol::sendMotorCommand(MotorCommand cmd, uint8_t speed) {
     Log.print(" | Spd ");
     Log.println(speedValue);
     
-    // Put command and speed into distinct slots
-    transfer.txObj(cmdValue, 0);      
-    transfer.txObj(speedValue, 1);    
-
-    transfer.sendData(2); 
+    uint8_t seq = ++txSequence;
+    MotorCommandFrame frame = {cmd, speedValue, seq};
+    sendBusMessage(0, frame);
 
     // Update tracking state
+    markSent(PACKET_MOTOR_COMMAND, seq);
     lastSentCommand = cmd;
-    lastSendTime = millis();
-    isWaitingForAck = true;
+    lastSentSpeed = speedValue;
+}
+
+
+void UARTProtocol::sendWheelSetpoints(int8_t leftFront, int8_t leftBack, int8_t rightFront, int8_t rightBack) {
+    if (!initialized) return;
+    serviceEmergencyRequest();
+
+    WheelSetpoint setpoint;
+    setpoint.wheels[WHEEL_LEFT_FRONT] = constrain(leftFront, -100, 100);
+    setpoint.wheels[WHEEL_LEFT_BACK] = constrain(leftBack, -100, 100);
+    setpoint.wheels[WHEEL_RIGHT_FRONT] = constrain(rightFront, -100, 100);
+    setpoint.wheels[WHEEL_RIGHT_BACK] = constrain(rightBack, -100, 100);
+
+    if (isRepeat(PACKET_WHEEL_SETPOINT, memcmp(setpoint.wheels, lastSentWheels, sizeof(lastSentWheels)) == 0)) {
+        return;
+    }
+    setpoint.seq = ++txSequence;
+
+    Log.print("-> MOTOR_TX: Wheels #");
+    Log.print(setpoint.seq);
+    Log.print(" | ");
+    for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+        Log.print(setpoint.wheels[i]);
+        Log.print(i < WHEEL_COUNT - 1 ? " " : "\n");
+    }
+
+    sendBusMessage(0, setpoint);
+
+    markSent(PACKET_WHEEL_SETPOINT, setpoint.seq);
+    memcpy(lastSentWheels, setpoint.wheels, sizeof(lastSentWheels));
 }
 
+void UARTProtocol::sendBodyVelocity(int8_t vx, int8_t vy, int8_t omega) {
+    if (!initialized) return;
+    serviceEmergencyRequest();
+
+    BodyVelocitySetpoint velocity;
+    velocity.vx = constrain(vx, -100, 100);
+    velocity.vy = constrain(vy, -100, 100);
+    velocity.omega = constrain(omega, -100, 100);
+
+    if (isRepeat(PACKET_BODY_VELOCITY, memcmp(&velocity.vx, lastSentVelocity, sizeof(lastSentVelocity)) == 0)) {
+        return;
+    }
+    velocity.seq = ++txSequence;
+
+    Log.print("-> MOTOR_TX: Velocity #");
+    Log.print(velocity.seq);
+    Log.print(" | vx ");
+    Log.print(velocity.vx);
+    Log.print(" vy ");
+    Log.print(velocity.vy);
+    Log.print(" w ");
+    Log.println(velocity.omega);
+
+    sendBusMessage(0, velocity);
+
+    markSent(PACKET_BODY_VELOCITY, velocity.seq);
+    memcpy(lastSentVelocity, &velocity.vx, sizeof(lastSentVelocity));
+}
 
 void UARTProtocol::sendEmergencyStop() {
-    sendMotorCommand(CMD_EMERGENCY_STOP, 0);
+    if (!initialized) return;
+    estopRequested = false;
+
+    // Already latched on the motor board and confirmed - nothing to add
+    if (estopAcked && estopAttempts > 0 && isMotorEmergency()) return;
+
+    estopSeq = ++txSequence;
+    estopDecisionUs = micros();
+    estopAcked = false;
+    estopAttempts = 0;
+    link.onSent(estopSeq);
+    sendEmergencyBurst();
+
+    // Short bounded wait so the ack (and the latency) is known before the caller moves on
+    MotorCommand cmd;
+    uint8_t speed;
+    while (!estopAcked && micros() - estopDecisionUs < ESTOP_ACK_WAIT_US) {
+        receiveAcknowledgment(cmd, speed);
+    }
+
+    // Logged only once the frames are out
+    Log.print("-> MOTOR_TX: E-STOP #");
+    Log.print(estopSeq);
+    if (estopAcked) {
+        LinkStats stats = link.getStats();
+        if (stats.estopLastUs != 0) {
+            Log.print(" braked after ");
+            Log.print(stats.estopLastUs);
+            Log.print(" us,");
+        }
+        Log.print(" acked in ");
+        Log.print(stats.estopAckUs);
+        Log.println(" us");
+    } else {
+        Log.println(" - no ack yet, retrying");
+    }
+}
+
+void UARTProtocol::requestEmergencyStop() {
+    estopRequested = true;
+}
+
+void UARTProtocol::serviceEmergencyRequest() {
+    if (estopRequested.exchange(false)) {
+        sendEmergencyStop();
+    }
+}
+
+void UARTProtocol::sendEmergencyBurst() {
+    EmergencyFrame frame;
+    frame.seq = estopSeq;
+    frame.reserved = 0;
+    frame.decisionUs = estopDecisionUs;
+
+    // Never waits for the bus. On a bus the first copy stops every node; the
+    // rest go to the primary, which acks. The other nodes report the latch in
+    // their polled status.
+    for (uint8_t copy = 0; copy < ESTOP_COPIES; copy++) {
+        frame.copy = copy;
+        sendMessageTo((copy == 0 && isBus()) ? NODE_BROADCAST : NODE_PRIMARY, frame);
+    }
+
+    estopAttempts++;
+    estopLastBurst = millis();
+}
+
+uint8_t UARTProtocol::sendSegments(const MotionSegment* segments, uint8_t count) {
+    if (!initialized) return 0;
+    serviceEmergencyRequest();
+    count = min(count, (uint8_t)MAX_MOTION_SEGMENTS);
+
+    // Built in the frame buffer - only the segments in use go out
+    SegmentList* list = beginMessage<SegmentList>(transfer.packet.txBuff);
+    uint8_t seq = ++txSequence;
+    list->seq = seq;
+    list->count = count;
+    if (count > 0) {
+        memcpy(list->segments, segments, count * sizeof(MotionSegment));
+    }
+
+    Log.print("-> MOTOR_TX: Maneuver #");
+    Log.print(seq);
+    Log.print(" | ");
+    Log.print(count);
+    Log.println(" segments");
+
+    transmit(0, messageLength(*list), busFrameId(NODE_PRIMARY, PACKET_SEGMENT_LIST));
+
+    markSent(PACKET_SEGMENT_LIST, seq);
+    maneuverSeq = seq;
+    maneuverActive = (count > 0);
+    return seq;
+}
+
+void UARTProtocol::abortSegments() {
+    sendSegments(nullptr, 0);
+}
+
+bool UARTProtocol::takeSegmentStatus(SegmentStatus &status) {
+    if (!segmentStatusPending) return false;
+    status = lastSegmentStatus;
+    segmentStatusPending = false;
+    return true;
 }
 
 bool UARTProtocol::receiveAcknowledgment(MotorCommand &cmd, uint8_t &speed) {
     // Check if a full packet has been received
     if (transfer.available()) {
-        // Read command and speed from receive buffer
-        transfer.rxObj(cmd, 0);
-        transfer.rxObj(speed, 1);
+        uint32_t rxUs = micros();
+        bool matched = false;
+        lastRxTime = millis();
+
+        uint8_t node = busNode(transfer.currentPacketID());
+        uint8_t packet = busPacket(transfer.currentPacketID());
+        const uint8_t* payload = transfer.packet.rxBuff;
+        if (decodeMessage(TO_MAIN, packet, payload, transfer.bytesRead) != DECODE_OK) {
+            return false;   // Intact but not a layout this firmware knows
+        }
+
+        if (isBus()) {
+            releaseBus(node, packet, rxUs);
+            advanceBus();
+        }
+        if (node != NODE_PRIMARY) {
+            handleNodeFrame(node, packet);
+            return false;
+        }
+
+        if (packet == PACKET_SEGMENT_STATUS) {
+            // Not an ack - the maneuver ended on the motor board
+            lastSegmentStatus = *viewMessage<SegmentStatus>(payload);
+            segmentStatusPending = true;
+            if (lastSegmentStatus.seq == maneuverSeq) {
+                maneuverActive = false;
+            }
+            lastAckTime = millis();
+            return true;
+        }
+
+        if (packet == PACKET_EMERGENCY_STOP) {
+            // First ack of the current stop ends the retries; later copies are ignored
+            const EmergencyAck* ack = viewMessage<EmergencyAck>(payload);
+            if (ack->seq == estopSeq && !estopAcked) {
+                estopAcked = true;
+                link.onAck(ack->seq);
+                uint32_t ackUs = micros() - ack->decisionUs;
+                link.onEmergencyAck(ackUs, ack->brakeUs);
+
+                // The brake on the S3 timeline - it can't be after the ack, so
+                // the mapping error is clipped to that
+                if (clock.isSynced()) {
+                    int32_t brakeUs = (int32_t)(clock.toMainTime(ack->brakedUs) - ack->decisionUs);
+                    link.onEmergencyBraked(constrain(brakeUs, (int32_t)0, (int32_t)ackUs));
+                }
+                lastAckTime = millis();
+            }
+            return true;
+        }
+
+        if (packet == PACKET_MOTOR_STATUS) {
+            handleMotorStatus();
+            return false;
+        }
+
+        if (packet == PACKET_TIME_SYNC) {
+            handleTimeSync(rxUs);
+            return false;
+        }
+
+        uint8_t seq;
+        if (packet == PACKET_MOTOR_COMMAND) {
+            // Command and speed, then the echoed sequence number
+            const MotorCommandFrame* ack = viewMessage<MotorCommandFrame>(payload);
+            cmd = ack->cmd;
+            speed = ack->speed;
+            if (transfer.bytesRead >= sizeof(MotorCommandFrame)) {
+                seq = ack->seq;
+                matched = (lastSentPacket == PACKET_MOTOR_COMMAND && seq == lastMotionSeq);
+            } else {
+                // Motor board firmware without sequence numbers
+                seq = lastMotionSeq;
+                matched = (lastSentPacket == PACKET_MOTOR_COMMAND && cmd == lastSentCommand);
+            }
+        } else {
+            // Every other ack echoes the sequence number only
+            seq = viewMessage<FrameAck>(payload)->seq;
+            matched = (lastSentPacket == packet && seq == lastMotionSeq);
+        }
+        link.onAck(seq);
+
+        if (packet == PACKET_BAUD_PROPOSE || packet == PACKET_LINK_TEST) {
+            handleLinkFrame(packet);
+            return false;
+        }
+
+        if (packet == PACKET_HEARTBEAT) {
+            // Link is alive - nothing for the caller, the motion ack state is left alone
+            lastAckTime = millis();
+            return false;
+        }
 
         // Verify if this matches what we sent
-        if (isWaitingForAck && cmd == lastSentCommand) {
+        if (isWaitingForAck && matched) {
             isWaitingForAck = false;
+            lastFrameAcked = true;
             lastAckTime = millis();
             return true;  // Correct acknowledgment received
         }
@@ -65,10 +873,14 @@ bool UARTProtocol::receiveAcknowledgment(MotorCommand &cmd, uint8_t &speed) {
         return true; // Received some packet, even if not the specific ACK we waited for
     }
 
+    if (transfer.status <= 0) {
+        link.onCrcError();   // CRC, payload, stop byte or stale packet
+    }
+
     // Check for timeout
-    if (isWaitingForAck && (millis() - lastSendTime > 500)) {
+    if (isWaitingForAck && (millis() - lastSendTime > UART_ACK_TIMEOUT_MS)) {
         isWaitingForAck = false; 
     }
 
     return false;  // no data yet
-}
\ No newline at end of file
+}
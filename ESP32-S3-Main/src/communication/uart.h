@@ -2,21 +2,21 @@
 #define UART_H
 
 #include <Arduino.h>
+#include <atomic>
 #include "SerialTransfer.h"
+#include "synapse_protocol.h"
+#include "link_stats.h"
+#include "clock_sync.h"
+#include "../config/constants.h"
 
-enum MotorCommand {
-    CMD_STOP = 0,
-    CMD_FORWARD,
-    CMD_BACKWARD,
-    CMD_LEFT,
-    CMD_RIGHT,
-    CMD_ROTATE_LEFT,
-    CMD_ROTATE_RIGHT,
-    CMD_STRAFE_LEFT,
-    CMD_STRAFE_RIGHT,
-    CMD_EMERGENCY_STOP
-};
+#define BUS_MAX_NODES 4             // Including the primary drive board
 
+enum LinkState : uint8_t {
+    LINK_BASE_RATE,             // UART_BAUD_RATE, nothing in progress
+    LINK_PROPOSING,             // Waiting for the WROOM to accept a candidate rate
+    LINK_TESTING,               // Both switched, test patterns in flight
+    LINK_FAST                   // Running at a verified rate
+};
 
 class UARTProtocol {
 private:
@@ -25,20 +25,192 @@ private:
 
     unsigned long lastSendTime;
     
+    PacketId lastSentPacket;
     MotorCommand lastSentCommand;
+    uint8_t txSequence;         // Every frame carries the next one, acks echo it
+    uint8_t lastMotionSeq;      // Sequence number of the last motion frame
+    unsigned long lastChangeTime;   // Last motion frame that actually went out
+    bool lastFrameAcked;
+    uint8_t lastSentSpeed;
+    int8_t lastSentWheels[WHEEL_COUNT];
+    int8_t lastSentVelocity[3];
+    LinkMonitor link;
+
+    // Rate negotiation - candidates are indexes into LINK_BAUD_RATES
+    LinkState linkState;
+    uint8_t candidate;          // Next rate to try, LINK_BAUD_RATE_COUNT when none are left
+    uint32_t baudRate;
+    unsigned long linkStateTime;
+    uint8_t linkAttempts;
+    uint8_t testSeq;
+    uint8_t testsPassed;
+    bool testPending;
+    uint8_t testRetries;        // Timeouts resent at this rate so far
+    unsigned long errorWindowStart;
+    uint32_t errorWindowBase;
+    uint8_t maneuverSeq;        // Sequence number of the maneuver still playing
+    bool maneuverActive;
+    SegmentStatus lastSegmentStatus;
+    bool segmentStatusPending;
     bool isWaitingForAck;
     unsigned long lastAckTime;
+    unsigned long lastRxTime;   // Any valid frame from the WROOM
+
+    // E-stop lane
+    uint8_t estopSeq;
+    uint32_t estopDecisionUs;
+    bool estopAcked;
+    uint8_t estopAttempts;
+    unsigned long estopLastBurst;
+    std::atomic<bool> estopRequested;   // Set from other tasks, sent by the loop
+
+    MotorStatus motorStatus;    // Latest report from the motor board
+    unsigned long motorStatusTime;
+    uint8_t lastAppliedSeq;
+
+    // Clock probes - offset and drift of the WROOM's clock against micros()
+    ClockSync clock;
+    uint8_t syncSeq;
+    uint32_t syncSentUs;
+    unsigned long lastSyncTime;
+
+    // Motor bus - busNodes[0] is the primary once a second node is added
+    struct BusNode {
+        uint8_t node;
+        bool hasSetpoint;
+        int8_t wheels[WHEEL_COUNT];
+        MotorStatus status;
+        unsigned long statusTime;
+        BusNodeStats stats;
+        uint64_t latencySum;
+    };
+    BusNode busNodes[BUS_MAX_NODES];
+    uint8_t busNodeCount;
+    uint8_t busPollIndex;
+    unsigned long busCycleStart;
+    uint32_t busCycles;
+    uint32_t busOverruns;       // Cycles started more than a full period late
+    int8_t busPendingIndex;     // Node whose reply is due, -1 while the return line is free
+    uint32_t busPendingUs;
+
+    // Frames that came while a reply was due - sent in order as the slot frees
+    struct BusFrame {
+        uint8_t index;          // busNodes entry that answers it
+        uint8_t id;             // busFrameId
+        uint8_t length;
+        uint8_t payload[PROTOCOL_MAX_PAYLOAD];
+    };
+    BusFrame busQueue[BUS_QUEUE_LEN];
+    uint8_t busQueueHead;
+    uint8_t busQueueCount;
+    uint32_t busDropped;        // Oldest queued frame pushed out by a new one
     bool initialized;
 
+    bool isRepeat(PacketId packet, bool samePayload);
+    void markSent(PacketId packet, uint8_t seq);
+    void sendHeartbeat();
+    void sendTimeSync();
+    void handleTimeSync(uint32_t rxUs);
+    void handleMotorStatus();
+
+    bool isBus() const { return busNodeCount > 1; }
+    int8_t busIndex(uint8_t node) const;
+    bool isBusFree();
+    void claimBus(uint8_t index);
+    void expireBus();
+    void advanceBus();
+    void releaseBus(uint8_t node, uint8_t packet, uint32_t rxUs);
+    void serviceBus();
+    void transmit(uint8_t index, uint8_t length, uint8_t id);
+    void sendNodeSetpoint(uint8_t index);
+    void sendStatusPoll(uint8_t index);
+    void handleNodeFrame(uint8_t node, uint8_t packet);
+    void sendEmergencyBurst();
+    void serviceEmergencyRequest();
+
+    void updateLinkRate();
+    void proposeBaud();
+    void sendLinkTest();
+    void handleLinkFrame(uint8_t packet);
+    void setBaudRate(uint32_t baud);
+    void fallBack(bool rateFailed);
+
+    template <typename T>
+    void sendMessage(const T& message) {
+        sendMessageTo(NODE_PRIMARY, message);
+    }
+
+    template <typename T>
+    void sendMessageTo(uint8_t node, const T& message) {
+        transfer.sendData(encodeMessage(transfer.packet.txBuff, message), busFrameId(node, MessageTraits<T>::id));
+    }
+
+    // To busNodes[index] - queued on a bus until the reply slot is free
+    template <typename T>
+    void sendBusMessage(uint8_t index, const T& message) {
+        transmit(index, encodeMessage(transfer.packet.txBuff, message),
+                 busFrameId(busNodes[index].node, MessageTraits<T>::id));
+    }
+
 public:
     UARTProtocol();
     void begin();
+    void update();              // Heartbeat - call every loop
+
+    // Motion frames are only transmitted when they differ from the last acked
+    // one (or UART_REFRESH_MS has passed); repeats cost nothing
     void sendMotorCommand(MotorCommand cmd, uint8_t speed);
+    void sendWheelSetpoints(int8_t leftFront, int8_t leftBack, int8_t rightFront, int8_t rightBack);
+    void sendBodyVelocity(int8_t vx, int8_t vy, int8_t omega);
+
+    // Out-of-band e-stop: ESTOP_COPIES redundant frames ahead of anything else,
+    // then waits up to ESTOP_ACK_WAIT_US for the WROOM's ack. Retried from
+    // update() until acked. Skipped while the WROOM already reports a latch.
     void sendEmergencyStop();
+    void requestEmergencyStop();    // Safe from any task - sent before the next frame
+    bool isEmergencyAcked() const { return estopAcked; }
+
+    // Uploads a maneuver that the motor board plays back on its own; returns its
+    // sequence number. Don't stream other motion frames meanwhile - they abort it.
+    uint8_t sendSegments(const MotionSegment* segments, uint8_t count);
+    void abortSegments();
+    bool isManeuverActive() const { return maneuverActive; }
+    bool takeSegmentStatus(SegmentStatus &status);
+
+    // cmd/speed are only filled for acks of legacy motor command frames
     bool receiveAcknowledgment(MotorCommand &cmd, uint8_t &speed);
     
     bool isLastCommandAcked() const { return !isWaitingForAck; }
     bool isConnected() const { return (millis() - lastAckTime < 2000); }
+    LinkStats getLinkStats();
+
+    // Motor board state as last reported - check isMotorStatusFresh() before trusting it
+    const MotorStatus& getMotorStatus() const { return motorStatus; }
+    bool isMotorStatusFresh() const { return motorStatusTime != 0 && millis() - motorStatusTime < MOTOR_STATUS_STALE_MS; }
+    bool isMotorEmergency() const { return isMotorStatusFresh() && (motorStatus.flags & STATUS_ESTOP_ACTIVE); }
+    uint32_t getBaudRate() const { return baudRate; }
+
+    // WROOM timestamps (MotorStatus, EmergencyAck) on the S3's micros() timeline and back.
+    // Only meaningful once isClockSynced(); getLinkStats() has the error bound.
+    bool isClockSynced() const { return clock.isSynced(); }
+    uint32_t motorToLocalUs(uint32_t motorUs) const { return clock.toMainTime(motorUs); }
+    uint32_t localToMotorUs(uint32_t localUs) const { return clock.toMotorTime(localUs); }
+
+    // Motor bus - extra boards behind the same UART, addressed by node ID. Once one
+    // is added, every BUS_CYCLE_MS update() sends each extra node its setpoint and
+    // polls one node's status (round robin, the primary included). One reply is
+    // due at a time so the nodes never talk over each other; frames sent while
+    // it is outstanding queue up and go out from update() / receiveAcknowledgment()
+    // as replies arrive or time out - nothing waits. Rate negotiation is off on a
+    // bus - every board stays at UART_BAUD_RATE.
+    bool addBusNode(uint8_t node);
+    void setNodeWheels(uint8_t node, const int8_t wheels[WHEEL_COUNT]);   // Lift board: wheels[0]
+    bool getNodeStatus(uint8_t node, MotorStatus &status) const;         // false when stale
+    uint8_t getBusNodeCount() const { return busNodeCount; }
+    BusNodeStats getBusNodeStats(uint8_t index) const { return busNodes[index].stats; }
+    uint32_t getBusOverruns() const { return busOverruns; }
+    uint32_t getBusDropped() const { return busDropped; }
+    LinkState getLinkState() const { return linkState; }
 };
 
 #endif
\ No newline at end of file
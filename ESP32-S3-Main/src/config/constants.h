@@ -3,9 +3,75 @@
 
 // System Constants
 #define SERIAL_BAUD_RATE 115200
-#define UART_BAUD_RATE 115200
+#define UART_BAUD_RATE 115200        // Start-up rate - a faster one is negotiated with the WROOM
+#define UART_BAUD_RETRY_MS 100       // Between rate proposals
+#define UART_BAUD_ATTEMPTS 30        // 3 s of proposals - outlasts the WROOM's 1.5 s silence fallback
+#define UART_LINK_TEST_FRAMES 20     // Test patterns that must all echo back intact
+#define UART_LINK_TEST_TIMEOUT_MS 50
+#define UART_LINK_TEST_RETRIES 1     // Timed-out test frames resent before a rate counts as failed
+#define UART_LINK_SILENCE_MS 1000    // No ack at a negotiated rate -> back to UART_BAUD_RATE
+#define UART_LINK_ERROR_LIMIT 5      // Lost + corrupt frames per second before stepping down
+#define UART_RENEGOTIATE_MS 30000    // Retry when the WROOM never answered
+#define MOTOR_STATUS_STALE_MS 500    // WROOM sends MotorStatus every 100 ms, or when polled on a bus
+#define ESTOP_COPIES 3               // E-stop frames sent back-to-back per attempt
+#define ESTOP_ACK_WAIT_US 3000       // Caller blocks this long for the e-stop ack
+#define ESTOP_RETRY_MS 20            // Unacked e-stop resent from update()
+#define ESTOP_RETRY_LIMIT 25         // 0.5 s of retries
+#define UART_HEARTBEAT_MS 200        // Idle keepalive - well inside the WROOM's 500 ms command timeout
+#define UART_REFRESH_MS 1000         // An unchanged command is still resent this often
+#define UART_ACK_TIMEOUT_MS 500      // Frames not acked by then count as lost
+#define CLOCK_SYNC_PERIOD_MS 1000    // Clock probes to the WROOM once synced
+#define CLOCK_SYNC_FAST_MS 100       // Until the first CLOCK_SYNC_MIN_SAMPLES are in
+#define BUS_CYCLE_MS 20              // Motor bus schedule, once extra nodes are added
+#define BUS_REPLY_TIMEOUT_US 5000    // Reply slot per request - a MotorStatus takes ~3.5 ms at 115200
+#define BUS_QUEUE_LEN 6              // Frames waiting for the reply slot - a full cycle at BUS_MAX_NODES
+#define BUS_REAR_DRIVE_NODE 0        // Large cart: second drive board's node ID, 0 = not fitted
+#define BUS_LIFT_NODE 0              // Large cart: lift actuator board's node ID, 0 = not fitted
 #define I2C_FREQUENCY 100000
 
+// Network Task - Firebase and WebSerial, pinned away from the control loop
+#define NET_TASK_CORE 0              // With the WiFi stack; loop() runs on core 1
+#define NET_TASK_STACK 12288         // TLS handshakes need the room
+#define NET_TASK_PRIORITY 1
+#define NET_TELEMETRY_QUEUE_LEN 4    // Snapshots waiting for upload - the oldest is dropped when full
+#define FIREBASE_COMMAND_PATH "/commands"  // Dashboard writes, streamed to the S3
+#define FIREBASE_STREAM_RETRY_MS 1000      // First reconnect delay, doubled per failure
+#define FIREBASE_STREAM_RETRY_MAX_MS 30000
+#define FIREBASE_STATUS_PATH "/status"     // Live status keys - all the dashboard listens to, with the commands
+#define FIREBASE_TELEMETRY_PATH "/telemetry" // Batched fast-channel series and the offline backlog
+#define TELEMETRY_PERIOD_MS 2000           // Status snapshot to FIREBASE_STATUS_PATH
+#define TELEMETRY_FULL_REFRESH_MS 60000    // Every status key rewritten, changed or not
+#define TELEMETRY_SAMPLE_MS 100            // IMU / ultrasonic / light sampling
+#define TELEMETRY_BATCH_SAMPLES 20         // Slots per series upload - 2 s at 100 ms
+#define TELEMETRY_KEYFRAME_BATCHES 5       // Every nth batch carries every channel
+#define TELEMETRY_SERIES_SLOTS 30          // Batches kept in the database, oldest overwritten
+#define TELEMETRY_BACKLOG_SLOTS 10800      // Backfilled snapshots kept - one per TELEMETRY_PERIOD_MS of capture time, 6 h
+#define TELEMETRY_SERIES_QUEUE_LEN 2
+#define TELEMETRY_JSON_BUFFER 16384        // Upload text - a full backfill batch is the largest
+#define FIREBASE_REST_URI_MAX 1600         // Path + query with the ID token, about 1 KB on its own
+#define FIREBASE_REST_TIMEOUT_MS 5000
+#define NET_IDLE_WAIT_MS 20          // Longest wait for a snapshot before the log is drained again
+#define NET_LOG_BUFFER 4096          // Log bytes waiting for WebSerial
+#define NET_LOG_CHUNK 256            // Largest single WebSerial write
+#define STORE_PSRAM_BYTES (2 * 1024 * 1024)  // Offline snapshots - about 5 h at TELEMETRY_PERIOD_MS
+#define STORE_FALLBACK_RECORDS 64          // Internal RAM when the board has no PSRAM
+#define STORE_BACKFILL_BATCH 10            // Stored snapshots per backfill upload
+#define STORE_BACKFILL_INTERVAL_MS 1000    // Between backfill uploads - live data goes first
+#define NTP_SERVER "pool.ntp.org"          // Wall clock for stored snapshots
+#define CLOCK_VALID_EPOCH 1600000000UL     // Earlier than this, SNTP hasn't set the clock yet
+
+// LAN WebSocket - binary snapshots and commands on the WebSerial server
+#define LAN_SOCKET_PATH "/ws"
+#define LAN_MAX_CLIENTS 3                  // More are closed on connect
+#define LAN_SNAPSHOT_MAX_HZ 50
+#define LAN_SNAPSHOT_DEFAULT_HZ 10         // Until the client subscribes
+#define LAN_COMMAND_RATE 20                // Commands per second, per client
+#define LAN_COMMAND_BURST 5
+#define LAN_COMMAND_QUEUE_LEN 8            // Waiting for the loop - further ones are refused
+#define LAN_TICK_MS 5                      // Sender task period; an ack wakes it early
+#define LAN_TASK_STACK 4096
+#define LAN_TASK_PRIORITY 2                // Above the network task - TLS work doesn't hold snapshots up
+
 // Ultrasonic Constants
 #define MAX_ULTRASONIC_DISTANCE 100  // cm
 #define MIN_SAFE_DISTANCE 20         // cm
@@ -20,7 +86,8 @@
 #define DISPLAY_UPDATE_INTERVAL 50  // ms
 #define HEARTBEAT_INTERVAL 1000      // ms
 
-// Motor Speed Constants
+// Motor Speed Constants - % of wheel top speed once the motor board's tables are measured;
+// until then they map to duty % one to one, so these are the duty figures that clear the deadband
 #define MOTOR_SPEED_MIN 52            // %
 #define MOTOR_SPEED_MAX 100           // %
 #define MOTOR_SPEED_DEFAULT 68        // %
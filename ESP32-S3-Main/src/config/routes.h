@@ -0,0 +1,71 @@
+#ifndef ROUTES_H
+#define ROUTES_H
+
+#include <Arduino.h>
+
+/*
+    Taped route graph for the ward deliveries (kept in flash as const data).
+
+    Tape conventions:
+      - Junctions are branches leaving the line to the left and/or right.
+      - Stations are full-width bars that the line runs straight through.
+      - Corners with a single way out are handled by LineFollowing and are
+        NOT listed here.
+
+    Nodes are directional: the same physical junction appears once for every
+    direction it is approached from, because left/right swap with heading.
+    exits[] is indexed by LineBranch (LEFT, STRAIGHT, RIGHT) and holds the next
+    node met along that branch. For a station, "reverse" is the first node met
+    after turning around on its marker, so leave a short tail of tape past
+    every station bar.
+*/
+
+#define ROUTE_NONE 0xFF
+
+#define ROUTE_NODE_JUNCTION 0
+#define ROUTE_NODE_STATION  1
+
+struct RouteNode {
+    uint8_t type;
+    uint8_t stationId;     // Only for stations, 0 = home
+    uint8_t exits[3];      // LEFT, STRAIGHT, RIGHT
+    uint8_t reverse;       // Only for stations
+};
+
+/*
+    Example layout (main corridor runs north from the charging dock):
+
+                   [WARD 3]
+                      |
+                      B ---- [WARD 2]
+                      |
+        [WARD 1] ---- A
+                      |
+                   [HOME]
+*/
+static const RouteNode ROUTE_GRAPH[] = {
+    /* 0  HOME               */ {ROUTE_NODE_STATION,  0, {ROUTE_NONE, ROUTE_NONE, ROUTE_NONE}, 1},
+    /* 1  A northbound       */ {ROUTE_NODE_JUNCTION, 0, {2, 3, ROUTE_NONE}, ROUTE_NONE},
+    /* 2  WARD 1             */ {ROUTE_NODE_STATION,  1, {ROUTE_NONE, ROUTE_NONE, ROUTE_NONE}, 5},
+    /* 3  B northbound       */ {ROUTE_NODE_JUNCTION, 0, {ROUTE_NONE, 6, 4}, ROUTE_NONE},
+    /* 4  WARD 2             */ {ROUTE_NODE_STATION,  2, {ROUTE_NONE, ROUTE_NONE, ROUTE_NONE}, 7},
+    /* 5  A from Ward 1      */ {ROUTE_NODE_JUNCTION, 0, {3, ROUTE_NONE, 0}, ROUTE_NONE},
+    /* 6  WARD 3             */ {ROUTE_NODE_STATION,  3, {ROUTE_NONE, ROUTE_NONE, ROUTE_NONE}, 8},
+    /* 7  B from Ward 2      */ {ROUTE_NODE_JUNCTION, 0, {9, ROUTE_NONE, 6}, ROUTE_NONE},
+    /* 8  B southbound       */ {ROUTE_NODE_JUNCTION, 0, {4, 9, ROUTE_NONE}, ROUTE_NONE},
+    /* 9  A southbound       */ {ROUTE_NODE_JUNCTION, 0, {ROUTE_NONE, 0, 2}, ROUTE_NONE},
+};
+
+static const uint8_t ROUTE_NODE_COUNT = sizeof(ROUTE_GRAPH) / sizeof(ROUTE_GRAPH[0]);
+static const uint8_t ROUTE_HOME_NODE = 0;
+
+static const char* const ROUTE_STATION_NAMES[] = {
+    "HOME",
+    "WARD 1",
+    "WARD 2",
+    "WARD 3"
+};
+
+static const uint8_t ROUTE_STATION_COUNT = sizeof(ROUTE_STATION_NAMES) / sizeof(ROUTE_STATION_NAMES[0]);
+
+#endif
@@ -45,6 +45,23 @@
 #define COLLISION_DISTANCE_SIDE 50   // cm
 #define EMERGENCY_STOP_DISTANCE 20   // cm
 
+// Line Junction Detection
+#define LINE_NODE_CONFIRM_SAMPLES 2       // consecutive reads before a pattern change is trusted
+#define LINE_JUNCTION_ADVANCE_MS 250      // creep forward so the axle sits over the junction
+#define LINE_TURN_TIMEOUT 4000            // ms, give up re-acquiring the branch
+#define LINE_LOST_TIMEOUT 300             // ms without any black before stopping
+#define ROUTE_DWELL_TIME 8000             // ms parked at the destination for unloading
+
+// Obstacles on the line
+#define LINE_OBSTACLE_SLOW_DISTANCE 50    // cm, start slowing down below this
+#define LINE_OBSTACLE_STOP_DISTANCE 25    // cm, pause below this
+#define LINE_OBSTACLE_RESUME_MARGIN 10    // cm of hysteresis before resuming
+#define LINE_OBSTACLE_RESUME_MS 1000      // path must stay clear this long
+#define LINE_SIDESTEP_ENABLED 1           // try to go around a blockage that does not move
+#define LINE_SIDESTEP_WAIT 5000           // ms paused before side-stepping
+#define LINE_SIDESTEP_STRAFE_MS 1200      // ms strafing off the line
+#define LINE_SIDESTEP_PASS_MS 2000        // ms driving past the obstacle
+
 
 #define AM2303_READ_INTERVAL 2000UL
 
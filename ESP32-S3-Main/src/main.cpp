@@ -11,6 +11,9 @@
 #include "communication/wifi_manager.h"
 #include "communication/firebase_manager.h"
 #include "communication/uart.h"
+#include "communication/network_task.h"
+#include "communication/telemetry_series.h"
+#include "communication/lan_socket.h"
 
 // Sensors & Actuators
 #include "sensors/max30102.h"
@@ -29,6 +32,7 @@
 #include "modes/monitoring.h"
 #include "modes/assistant_mode.h"
 #include "modes/line_following.h"
+#include "modes/route_executor.h"
 #include "modes/obstacle_avoidance.h"
 #include "modes/automatic_lighting.h"
 #include "ui/menu.h"
@@ -39,6 +43,9 @@
 WiFiManager wifi;
 FirebaseManager firebase;
 UARTProtocol uart;
+NetworkTask network(&firebase, &wifi);
+TelemetrySeries series;
+LanSocket lan;
 Display display;
 Buzzer buzzer;
 RotaryEncoder encoder;
@@ -62,7 +69,8 @@ void onWebSerialMessage(uint8_t *data, size_t len) {
         ESP.restart();
     }
     if (msg == "STOP") {
-        uart.sendEmergencyStop();
+        // WebSerial callbacks run outside the loop - the UART owner sends it next
+        uart.requestEmergencyStop();
         WebSerial.println("EMERGENCY STOP SENT!");
     }
 }
@@ -82,6 +90,7 @@ Battery battery;
 MonitoringSystem* monitoring;
 AssistantMode* assistant;
 LineFollowing* lineFollower;
+RouteExecutor* routeExecutor;
 ObstacleAvoidance* obstacleAvoid;
 AutomaticLighting* autoLighting;
 
@@ -141,6 +150,7 @@ void setup() {
         // Initialize WebSerial
         WebSerial.begin(&server);
         WebSerial.onMessage(onWebSerialMessage);
+        lan.begin(&server);
         server.begin();
         Log.println("✓ WebSerial Started");
 
@@ -158,6 +168,9 @@ void setup() {
         delay(2000);
     }
 
+    // From here on WiFi upkeep, Firebase and WebSerial output run on core 0
+    network.begin();
+
     // 4. Initialize Sensors
     Log.print("Initializing HeartRate (MAX30102)...");
     heartRate.begin();
@@ -200,13 +213,16 @@ void setup() {
     uart.begin();
     // Send a "Kick-start" command to initialize the connection
     uart.sendMotorCommand(CMD_STOP, 0); 
+    if (BUS_REAR_DRIVE_NODE) uart.addBusNode(BUS_REAR_DRIVE_NODE);
+    if (BUS_LIFT_NODE) uart.addBusNode(BUS_LIFT_NODE);
     Log.println("Done.");
 
     // 6. Instantiate Modes
     Log.print("Setting up Modes & Menu...");
     monitoring = new MonitoringSystem(&heartRate, &environmental, &lightSensor, &display, &buzzer);
     assistant = new AssistantMode(&colorSensor, &ultrasonic, &uart, &display, &buzzer);
-    lineFollower = new LineFollowing(&lineSensor, &uart, &display);
+    lineFollower = new LineFollowing(&lineSensor, &ultrasonic, &uart, &display);
+    routeExecutor = new RouteExecutor(lineFollower, &display, &buzzer);
     obstacleAvoid = new ObstacleAvoidance(&ultrasonic, &motion, &uart, &display, &buzzer);
     autoLighting = new AutomaticLighting(&lightSensor, &leds);
 
@@ -223,43 +239,65 @@ void setup() {
 }
 
 void loop() {
-    // Background Tasks
-    wifi.update();
-    
-    // One-time Firebase authentication status check
-    static bool firebaseAuthLogged = false;
-    if (!firebaseAuthLogged && Firebase.ready()) {
-        Log.println("✓ Firebase Authentication Complete!");
-        firebaseAuthLogged = true;
-    }
-    
+    // Background Tasks - the network ones run in NetworkTask
     lightSensor.update();
     autoLighting->update();
     motion.update();
     buzzer.update();
     
+    // Heartbeat to the motor board while the modes have nothing new to send
+    uart.update();
+
     // UART Acknowledgment Check - SKIPPED FOR DEBUG
     MotorCommand ackCmd;
     uint8_t ackSpeed;
     if (uart.receiveAcknowledgment(ackCmd, ackSpeed)) {
         Log.println("ACK: Command received by Motor Controller");
     }
+    SegmentStatus maneuver;
+    if (uart.takeSegmentStatus(maneuver)) {
+        Log.print("Maneuver #");
+        Log.print(maneuver.seq);
+        Log.print(maneuver.state == SEGMENT_DONE ? " done" :
+                  maneuver.state == SEGMENT_ABORTED ? " aborted at segment " : " rejected");
+        if (maneuver.state == SEGMENT_ABORTED) Log.print(maneuver.index);
+        Log.print(" after ");
+        Log.print(maneuver.elapsedMs);
+        Log.println(" ms");
+    }
 
-    // Check for Firebase commands every loop for low latency
-    static unsigned long lastFirebaseRx = 0;
+    // Dashboard commands, as fetched by the network task
     static FirebaseRxData rx;
     static int currentHR = 0, currentSpO2 = 0;
     static int usCenter = 0, usLeft = 0, usRear = 0, usRight = 0;
-    static String currentColor = "UNKNOWN";
+    static ColorType currentColor = COLOR_UNKNOWN;
     static int currentCompartment = 255;
 
-    if (millis() - lastFirebaseRx >= 100) { // Check every 100ms
-        lastFirebaseRx = millis();
-        if (firebase.receiveData(rx)) {
-            // Actuator real-time control
-            buzzer.controlFromFirebase(rx.buzzer01ring, rx.buzzer02ring, rx.buzzersound);
-            leds.controlFromFirebase(rx.lightadj_left, rx.lightadj_right);
+    // Dashboard and LAN each patch only the fields they changed - the latest change to a field wins
+    bool commandsChanged = network.takeCommands(rx);
+    if (lan.takeCommands(rx)) commandsChanged = true;
+
+    if (commandsChanged) {
+        // Actuator real-time control
+        buzzer.controlFromFirebase(rx.buzzer01ring, rx.buzzer02ring, rx.buzzersound);
+        leds.controlFromFirebase(rx.lightadj_left, rx.lightadj_right);
+    }
+
+    // Delivery dispatch from the dashboard or a LAN client. A request is taken
+    // once no delivery is under way - one sent mid-delivery waits for it - and
+    // is then cleared, here and in the database, so the same station can be
+    // sent again.
+    static int lastRouteDestination = 0;    // Delivery under way, 0 when none
+    if (lastRouteDestination != 0 && !routeExecutor->isActive()) {
+        lastRouteDestination = 0;           // Finished or aborted
+    }
+    if (rx.route_destination > 0 && lastRouteDestination == 0) {
+        if (routeExecutor->startDelivery(rx.route_destination)) {
+            lastRouteDestination = rx.route_destination;
+            menu->enterMode(LINE_FOLLOWING);
         }
+        rx.route_destination = 0;
+        network.clearRouteCommand();
     }
 
     // Real-time sensor monitoring (Mode independent)
@@ -267,10 +305,69 @@ void loop() {
     ultrasonic.monitorUltrasonic(rx.ultrasonic_start, usCenter, usLeft, usRear, usRight);
     currentColor = colorSensor.monitorColor(rx.colour_start);
     currentCompartment = lightSensor.monitorCompartment(rx.compartment_start);
+
+    // Fast channels at TELEMETRY_SAMPLE_MS, uploaded in batches by the network task
+    static unsigned long lastSeriesSample = 0;
+    if (millis() - lastSeriesSample >= TELEMETRY_SAMPLE_MS) {
+        lastSeriesSample = millis();
+
+        static TelemetryBatch finished;
+        if (series.takeBatch(lastSeriesSample, finished)) {
+            network.queueSeries(finished);
+        }
+
+        float values[SERIES_CHANNEL_COUNT];
+        int angular;
+        motion.getMotionData(values[SERIES_ACCELERATION], angular);
+        values[SERIES_ANGULAR] = angular;
+        values[SERIES_US_CENTER] = usCenter;
+        values[SERIES_US_LEFT] = usLeft;
+        values[SERIES_US_REAR] = usRear;
+        values[SERIES_US_RIGHT] = usRight;
+        values[SERIES_LIGHT] = lightSensor.getPathLightLevel();
+        series.add(lastSeriesSample, values);
+    }
+
+    // LAN snapshot - the socket task sends it on at each client's rate
+    static unsigned long lastLanSnapshot = 0;
+    if (lan.hasClients() && millis() - lastLanSnapshot >= 1000 / LAN_SNAPSHOT_MAX_HZ) {
+        lastLanSnapshot = millis();
+
+        LanSnapshot snap;
+        float acceleration, voltage;
+        int angular, temp, humidity, batteryLevel;
+        motion.getMotionData(acceleration, angular);
+        environmental.getEnvironmentData(temp, humidity);
+        battery.getBatteryData(batteryLevel, voltage);
+
+        snap.timeMs = lastLanSnapshot;
+        snap.acceleration = (int16_t)lroundf(acceleration * 100);
+        snap.angular = angular;
+        snap.battery = batteryLevel;
+        snap.voltage = (uint16_t)lroundf(voltage * 1000);
+        snap.temp = temp;
+        snap.humidity = humidity;
+        snap.light = lightSensor.getPathLightLevel();
+        snap.hr = currentHR;
+        snap.spo2 = currentSpO2;
+        snap.ultrasonic[0] = usCenter;
+        snap.ultrasonic[1] = usLeft;
+        snap.ultrasonic[2] = usRear;
+        snap.ultrasonic[3] = usRight;
+        snap.colour = currentColor;
+        snap.compartment = currentCompartment;
+
+        const MotorStatus& motorStatus = uart.getMotorStatus();
+        snap.motorEstop = uart.isMotorStatusFresh() ?
+            ((motorStatus.flags & STATUS_ESTOP_ACTIVE) ? motorStatus.estopSource : 0) : -1;
+        for (uint8_t w = 0; w < WHEEL_COUNT; w++) snap.duty[w] = motorStatus.duty[w];
+
+        lan.publish(snap);
+    }
     
-    // Firebase Telemetry update (Keep at 2s)
+    // Firebase status snapshot - only changed keys are uploaded
     static unsigned long lastFirebaseUpdate = 0;
-    if (millis() - lastFirebaseUpdate >= 2000) {
+    if (millis() - lastFirebaseUpdate >= TELEMETRY_PERIOD_MS) {
         lastFirebaseUpdate = millis();
 
         // Telemetry update using new methods and cached real-time values
@@ -290,8 +387,75 @@ void loop() {
         
         tx.colour = currentColor;
         tx.compartment = currentCompartment;
+
+        LinkStats link = uart.getLinkStats();
+        tx.link_rtt_p50 = link.rttP50Us / 1000.0f;
+        tx.link_rtt_p99 = link.rttP99Us / 1000.0f;
+        tx.link_rtt_max = link.rttMaxUs / 1000.0f;
+        tx.link_lost = link.lost;
+        tx.link_crc = link.crcErrors;
+        tx.link_retx = link.retransmits;
+        tx.link_baud = link.baudRate;
+        tx.link_estop_ms = link.estopLastUs / 1000.0f;
+        tx.link_estop_max_ms = link.estopMaxUs / 1000.0f;
+        tx.link_apply_ms = link.applyLastUs / 1000.0f;
+        tx.link_clock_err_us = uart.isClockSynced() ? (int)link.clockErrorUs : -1;
+
+        const MotorStatus& motorStatus = uart.getMotorStatus();
+        bool motorFresh = uart.isMotorStatusFresh();
+        tx.motor_estop = motorFresh ? ((motorStatus.flags & STATUS_ESTOP_ACTIVE) ? motorStatus.estopSource : 0) : -1;
+        tx.motor_duty_lf = motorStatus.duty[WHEEL_LEFT_FRONT];
+        tx.motor_duty_lb = motorStatus.duty[WHEEL_LEFT_BACK];
+        tx.motor_duty_rf = motorStatus.duty[WHEEL_RIGHT_FRONT];
+        tx.motor_duty_rb = motorStatus.duty[WHEEL_RIGHT_BACK];
+        tx.motor_timeouts = motorStatus.timeouts;
+        tx.motor_exec_max = motorStatus.execMaxUs;
+        tx.motor_frame_errors = motorStatus.frameErrors;
         
-        firebase.sendData(tx);
+        NetworkStats net = network.getStats();
+        tx.net_tx_ms = net.txLastMs;
+        tx.net_rx_ms = net.rxMaxMs;
+        tx.net_queue_max = net.telemetryQueueMax;
+        tx.net_dropped = net.telemetryDropped;
+        tx.net_log_dropped = net.logDropped;
+        tx.net_stream_reconnects = net.streamReconnects;
+        tx.net_tx_kb = net.txBytes / 1024;
+        tx.net_store_fill = net.storeFill;
+        tx.net_store_lost = net.storeLost;
+
+        LanStats lanStats = lan.getStats();
+        tx.lan_clients = lanStats.clients;
+        tx.lan_refused = lanStats.clientsRejected + lanStats.commandsLimited +
+                         lanStats.commandsBusy + lanStats.malformed;
+
+        // Uploaded by the network task - never waits here
+        network.queueTelemetry(tx);
+    }
+
+    // Per-node request -> reply latency while the motor bus is running
+    static unsigned long lastBusReport = 0;
+    if (uart.getBusNodeCount() > 1 && millis() - lastBusReport >= 10000) {
+        lastBusReport = millis();
+        for (uint8_t i = 0; i < uart.getBusNodeCount(); i++) {
+            BusNodeStats node = uart.getBusNodeStats(i);
+            Log.print("BUS node ");
+            Log.print(node.node);
+            Log.print(": ");
+            Log.print(node.replies);
+            Log.print("/");
+            Log.print(node.requests);
+            Log.print(" replies, ");
+            Log.print(node.timeouts);
+            Log.print(" timeouts, latency ");
+            Log.print(node.latencyAvgUs);
+            Log.print(" avg / ");
+            Log.print(node.latencyMaxUs);
+            Log.println(" max us");
+        }
+        Log.print("BUS overruns: ");
+        Log.print(uart.getBusOverruns());
+        Log.print(", frames dropped: ");
+        Log.println(uart.getBusDropped());
     }
 
     // Update Menu and UI
@@ -319,6 +483,16 @@ void loop() {
         // We still allow the loop to continue so it can RETRY sending commands
     }
 
+    // Motor board latched by its own e-stop button - it ignores motion until released
+    static bool motorEstopShown = false;
+    bool motorEstop = uart.isMotorEmergency() && uart.getMotorStatus().estopSource == 1;
+    if (motorEstop && !motorEstopShown) {
+        Log.println("⚠ Motor board E-STOP button latched");
+        display.displayError("MOTOR E-STOP");
+        buzzer.playTone(TONE_ERROR);
+    }
+    motorEstopShown = motorEstop;
+
     // Global Battery Failsafe
     float currentVoltage = battery.readVoltage();
     if (currentVoltage < BATTERY_CRITICAL_VOLTAGE) {
@@ -350,6 +524,7 @@ void loop() {
                 monitoring->stopMonitoring();
                 break;
             case LINE_FOLLOWING:
+                routeExecutor->abort();
                 lineFollower->stop();
                 break;
             case OBSTACLE_AVOIDANCE_MODE:
@@ -420,13 +595,25 @@ void loop() {
                 break;
                 
             case LINE_FOLLOWING:
-                if (lineFollower->isLineDetected()) {
+                // LineFollowing handles a lost line and obstacles itself (stops and waits)
+                if (routeExecutor->isActive()) {
+                    routeExecutor->update();
+                } else {
                     lineFollower->update();
                 }
                 break;
                 
-            case SYSTEM_INFO:
+            case SYSTEM_INFO: {
+                // Live page - redraw with fresh link statistics once a second
+                static unsigned long lastInfoRefresh = 0;
+                if (millis() - lastInfoRefresh >= 1000) {
+                    lastInfoRefresh = millis();
+                    menu->setLinkStats(uart.getLinkStats());
+                    menu->setMotorStatus(uart.getMotorStatus(), uart.isMotorStatusFresh());
+                    menu->updateDisplay();
+                }
                 break;
+            }
                 
             case AUTO_LIGHTING_SUBMENU:
                 break;
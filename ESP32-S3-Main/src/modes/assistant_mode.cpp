@@ -178,9 +178,9 @@ void AssistantMode::waitForCardPunch() {
         delay(500);
     }
     
-    String detectedColor = colorSensor->monitorColor(true);
+    ColorType detectedColor = colorSensor->monitorColor(true);
     
-    if (detectedColor != "UNKNOWN") {
+    if (detectedColor != COLOR_UNKNOWN) {
         currentState = ASSISTANT_STATE_IDENTIFYING;
         stateStartTime = millis();
         buzzer->playTone(TONE_CONFIRM);
@@ -354,7 +354,7 @@ void AssistantMode::sendFollowingCommand() {
     
     // Safety check first
     if (centerDistance < MIN_FOLLOW_DISTANCE) {
-        uart->sendMotorCommand(CMD_EMERGENCY_STOP, 0);
+        uart->sendEmergencyStop();
         buzzer->playTone(TONE_WARNING);
         Log.println("⚠ Too close! Following safety halt.");
         followingMotionActive = false;
@@ -1,7 +1,34 @@
 #include "line_following.h"
+#include "../utils/logger.h"
 
-LineFollowing::LineFollowing(BFD1000* s, UARTProtocol* u, Display* d) 
-    : sensor(s), uart(u), display(d), isActive(false), baseSpeed(MOTOR_SPEED_DEFAULT), lastError(0) {}
+// Sensor bits (bit 0 = leftmost)
+#define LINE_MASK_LEFT_EDGE  0x01
+#define LINE_MASK_CENTER     0x04
+#define LINE_MASK_RIGHT_EDGE 0x10
+#define LINE_MASK_INNER      0x0E   // S2..S4, used to decide if the line carries on
+
+LineFollowing::LineFollowing(BFD1000* s, UltrasonicManager* us, UARTProtocol* u, Display* d)
+    : sensor(s), ultrasonic(us), uart(u), display(d), isActive(false), baseSpeed(MOTOR_SPEED_DEFAULT),
+      turnSpeed(MOTOR_SPEED_MIN), currentSpeed(MOTOR_SPEED_DEFAULT), lastError(0) {
+    state = LF_FOLLOWING;
+    stateStartTime = 0;
+    lastLineSeenTime = 0;
+    wideSamples = 0;
+    narrowSamples = 0;
+    seenLeft = false;
+    seenRight = false;
+    seenAllBlack = false;
+    eventPending = false;
+    pendingEvent = {LINE_EVENT_NONE, 0, 0};
+    turnCommand = CMD_STOP;
+    turnNeedsClear = false;
+    resumeState = LF_FOLLOWING;
+    clearSince = 0;
+    sidestepEnabled = LINE_SIDESTEP_ENABLED;
+    sidestepPhase = SIDESTEP_OUT;
+    sidestepOut = CMD_STRAFE_LEFT;
+    sidestepBack = CMD_STRAFE_RIGHT;
+}
 
 void LineFollowing::begin() {
     sensor->begin();
@@ -9,6 +36,11 @@ void LineFollowing::begin() {
 
 void LineFollowing::start() {
     isActive = true;
+    eventPending = false;
+    wideSamples = 0;
+    lastLineSeenTime = millis();
+    setState(LF_FOLLOWING);
+
     display->clear();
     display->setCursor(0, 0);
     display->print("Line Following");
@@ -18,6 +50,7 @@ void LineFollowing::start() {
 
 void LineFollowing::stop() {
     isActive = false;
+    eventPending = false;
     uart->sendMotorCommand(CMD_STOP, 0);
 }
 
@@ -25,9 +58,370 @@ void LineFollowing::update() {
     if (!isActive) return;
 
     sensor->update();
+    ultrasonic->update();
+
+    // Pauses the forward-moving states when something blocks the tape
+    if (checkObstacle()) return;
+
+    switch (state) {
+        case LF_FOLLOWING:
+            followLine();
+            break;
+
+        case LF_CROSSING:
+            crossNode();
+            break;
+
+        case LF_AT_NODE:
+            // Nobody claimed the event in the previous pass - pick a sensible default
+            applyDefaultBranch();
+            break;
+
+        case LF_ADVANCING:
+            uart->sendMotorCommand(CMD_FORWARD, turnSpeed);
+            if (millis() - stateStartTime >= LINE_JUNCTION_ADVANCE_MS) {
+                startRotation();
+            }
+            break;
+
+        case LF_TURNING:
+            updateTurn();
+            break;
+
+        case LF_PAUSED:
+            updatePaused();
+            break;
+
+        case LF_SIDESTEP:
+            updateSidestep();
+            break;
+
+        case LF_HALTED:
+            break;
+
+        case LF_LOST:
+            if (sensor->isAnyBlack()) {
+                Log.println("Line re-acquired");
+                lastLineSeenTime = millis();
+                setState(LF_FOLLOWING);
+            }
+            break;
+    }
+}
+
+void LineFollowing::followLine() {
+    uint8_t pattern = sensor->getPattern();
+
+    if (pattern != 0) {
+        lastLineSeenTime = millis();
+    } else if (millis() - lastLineSeenTime > LINE_LOST_TIMEOUT) {
+        Log.println("Line lost - stopping");
+        uart->sendMotorCommand(CMD_STOP, 0);
+        setState(LF_LOST);
+        return;
+    }
+
+    if (isLeftBranch(pattern) || isRightBranch(pattern)) {
+        if (++wideSamples >= LINE_NODE_CONFIRM_SAMPLES) {
+            seenLeft = isLeftBranch(pattern);
+            seenRight = isRightBranch(pattern);
+            seenAllBlack = sensor->isAllBlack();
+            narrowSamples = 0;
+            setState(LF_CROSSING);
+            uart->sendMotorCommand(CMD_FORWARD, currentSpeed);
+            return;
+        }
+    } else {
+        wideSamples = 0;
+    }
+
     updateSteering();
 }
 
+void LineFollowing::crossNode() {
+    uint8_t pattern = sensor->getPattern();
+
+    if (isLeftBranch(pattern) || isRightBranch(pattern)) {
+        // Still over the junction - hold the heading, steering would chase the branch
+        seenLeft |= isLeftBranch(pattern);
+        seenRight |= isRightBranch(pattern);
+        seenAllBlack |= sensor->isAllBlack();
+        narrowSamples = 0;
+        uart->sendMotorCommand(CMD_FORWARD, currentSpeed);
+        return;
+    }
+
+    if (++narrowSamples < LINE_NODE_CONFIRM_SAMPLES) {
+        uart->sendMotorCommand(CMD_FORWARD, currentSpeed);
+        return;
+    }
+
+    classifyNode(pattern);
+}
+
+void LineFollowing::classifyNode(uint8_t pattern) {
+    uint8_t exits = 0;
+    if (seenLeft) exits |= EXIT_LEFT;
+    if (seenRight) exits |= EXIT_RIGHT;
+    if (pattern & LINE_MASK_INNER) exits |= EXIT_STRAIGHT;
+
+    wideSamples = 0;
+    lastLineSeenTime = millis();
+
+    // A full-width bar that the line runs straight through is a station marker
+    if (seenAllBlack && (exits & EXIT_STRAIGHT)) {
+        pendingEvent = {LINE_EVENT_MARKER, exits, millis()};
+        eventPending = true;
+        setState(LF_AT_NODE);
+        return;
+    }
+
+    switch (exits) {
+        case 0:
+            // Line ends after the bar - end of track
+            Log.println("End of line reached");
+            halt();
+            return;
+        case EXIT_STRAIGHT:
+            setState(LF_FOLLOWING);
+            return;
+        case EXIT_LEFT:
+            // Plain corner, no decision to make
+            takeBranch(BRANCH_LEFT);
+            return;
+        case EXIT_RIGHT:
+            takeBranch(BRANCH_RIGHT);
+            return;
+        default:
+            pendingEvent = {LINE_EVENT_JUNCTION, exits, millis()};
+            eventPending = true;
+            setState(LF_AT_NODE);
+            return;
+    }
+}
+
+void LineFollowing::applyDefaultBranch() {
+    LineEvent event;
+    if (!takeEvent(event)) return;
+
+    if (event.exits & EXIT_STRAIGHT) {
+        takeBranch(BRANCH_STRAIGHT);
+    } else {
+        // T-junction without a route to follow - wait for an operator
+        Log.println("Junction without route - halting");
+        halt();
+    }
+}
+
+bool LineFollowing::takeEvent(LineEvent& event) {
+    if (!eventPending) return false;
+    event = pendingEvent;
+    eventPending = false;
+    return true;
+}
+
+void LineFollowing::takeBranch(LineBranch branch) {
+    eventPending = false;
+
+    switch (branch) {
+        case BRANCH_LEFT:
+            turnCommand = CMD_ROTATE_LEFT;
+            setState(LF_ADVANCING);
+            uart->sendMotorCommand(CMD_FORWARD, turnSpeed);
+            break;
+        case BRANCH_RIGHT:
+            turnCommand = CMD_ROTATE_RIGHT;
+            setState(LF_ADVANCING);
+            uart->sendMotorCommand(CMD_FORWARD, turnSpeed);
+            break;
+        default:
+            lastLineSeenTime = millis();
+            setState(LF_FOLLOWING);
+            break;
+    }
+}
+
+void LineFollowing::turnAround() {
+    eventPending = false;
+    turnCommand = CMD_ROTATE_RIGHT;
+    startRotation();
+}
+
+void LineFollowing::halt() {
+    eventPending = false;
+    setState(LF_HALTED);
+    uart->sendMotorCommand(CMD_STOP, 0);
+}
+
+void LineFollowing::startRotation() {
+    // If the centre sensor starts on a line it must leave it before the new one counts
+    turnNeedsClear = sensor->isBlack(2);
+    setState(LF_TURNING);
+    uart->sendMotorCommand(turnCommand, turnSpeed);
+}
+
+void LineFollowing::updateTurn() {
+    if (millis() - stateStartTime > LINE_TURN_TIMEOUT) {
+        Log.println("Turn timeout - branch not found");
+        uart->sendMotorCommand(CMD_STOP, 0);
+        setState(LF_LOST);
+        return;
+    }
+
+    bool centerBlack = sensor->isBlack(2);
+    if (turnNeedsClear) {
+        if (!centerBlack) turnNeedsClear = false;
+    } else if (centerBlack) {
+        lastError = 0;
+        lastLineSeenTime = millis();
+        setState(LF_FOLLOWING);
+        updateSteering();
+        return;
+    }
+
+    uart->sendMotorCommand(turnCommand, turnSpeed);
+}
+
+void LineFollowing::setState(LineFollowState newState) {
+    state = newState;
+    stateStartTime = millis();
+}
+
+bool LineFollowing::checkObstacle() {
+    float front = ultrasonic->getDistance(US_FRONT);
+
+    // Speed governor - scale down linearly between the slow and stop distances
+    if (front >= LINE_OBSTACLE_SLOW_DISTANCE) {
+        currentSpeed = baseSpeed;
+    } else if (front <= LINE_OBSTACLE_STOP_DISTANCE) {
+        currentSpeed = MOTOR_SPEED_MIN;
+    } else {
+        currentSpeed = MOTOR_SPEED_MIN + (int)((baseSpeed - MOTOR_SPEED_MIN) *
+                       (front - LINE_OBSTACLE_STOP_DISTANCE) /
+                       (LINE_OBSTACLE_SLOW_DISTANCE - LINE_OBSTACLE_STOP_DISTANCE));
+    }
+
+    bool movingForward = (state == LF_FOLLOWING || state == LF_CROSSING || state == LF_ADVANCING);
+    if (!movingForward || front >= LINE_OBSTACLE_STOP_DISTANCE) return false;
+
+    Log.print("Obstacle on line at ");
+    Log.print((int)front);
+    Log.println("cm - pausing");
+
+    resumeState = state;
+    clearSince = 0;
+    uart->sendMotorCommand(CMD_STOP, 0);
+    setState(LF_PAUSED);
+    return true;
+}
+
+void LineFollowing::updatePaused() {
+    float front = ultrasonic->getDistance(US_FRONT);
+
+    if (front >= LINE_OBSTACLE_STOP_DISTANCE + LINE_OBSTACLE_RESUME_MARGIN) {
+        if (clearSince == 0) clearSince = millis();
+        if (millis() - clearSince >= LINE_OBSTACLE_RESUME_MS) {
+            Log.println("Path clear - resuming");
+            lastLineSeenTime = millis();
+            setState(resumeState);
+        }
+        return;
+    }
+    clearSince = 0;
+
+    // Something parked on the tape - go around it, but never in the middle of a junction
+    if (sidestepEnabled && resumeState == LF_FOLLOWING &&
+        millis() - stateStartTime >= LINE_SIDESTEP_WAIT) {
+        startSidestep();
+    }
+}
+
+void LineFollowing::startSidestep() {
+    float left = ultrasonic->getDistance(US_LEFT);
+    float right = ultrasonic->getDistance(US_RIGHT);
+
+    if (left < COLLISION_DISTANCE_SIDE && right < COLLISION_DISTANCE_SIDE) {
+        // No room either side - keep waiting
+        setState(LF_PAUSED);
+        return;
+    }
+
+    if (left >= right) {
+        sidestepOut = CMD_STRAFE_LEFT;
+        sidestepBack = CMD_STRAFE_RIGHT;
+    } else {
+        sidestepOut = CMD_STRAFE_RIGHT;
+        sidestepBack = CMD_STRAFE_LEFT;
+    }
+
+    Log.println(sidestepOut == CMD_STRAFE_LEFT ? "Side-stepping left around obstacle"
+                                               : "Side-stepping right around obstacle");
+    sidestepPhase = SIDESTEP_OUT;
+    setState(LF_SIDESTEP);
+    uart->sendMotorCommand(sidestepOut, turnSpeed);
+}
+
+void LineFollowing::updateSidestep() {
+    unsigned long elapsed = millis() - stateStartTime;
+    UltrasonicPosition outSide = (sidestepOut == CMD_STRAFE_LEFT) ? US_LEFT : US_RIGHT;
+
+    switch (sidestepPhase) {
+        case SIDESTEP_OUT:
+            if (ultrasonic->getDistance(outSide) < EMERGENCY_STOP_DISTANCE) {
+                Log.println("Side-step blocked - stopping");
+                uart->sendMotorCommand(CMD_STOP, 0);
+                setState(LF_LOST);
+                return;
+            }
+            if (elapsed >= LINE_SIDESTEP_STRAFE_MS) {
+                sidestepPhase = SIDESTEP_PASS;
+                stateStartTime = millis();
+            }
+            uart->sendMotorCommand(sidestepOut, turnSpeed);
+            break;
+
+        case SIDESTEP_PASS:
+            if (ultrasonic->getDistance(US_FRONT) < LINE_OBSTACLE_STOP_DISTANCE) {
+                // Hold position until the lane beside the obstacle clears, then pass in full
+                uart->sendMotorCommand(CMD_STOP, 0);
+                stateStartTime = millis();
+                return;
+            }
+            if (elapsed >= LINE_SIDESTEP_PASS_MS) {
+                sidestepPhase = SIDESTEP_BACK;
+                stateStartTime = millis();
+            }
+            uart->sendMotorCommand(CMD_FORWARD, turnSpeed);
+            break;
+
+        case SIDESTEP_BACK:
+            if (sensor->isAnyBlack()) {
+                Log.println("Line re-acquired after side-step");
+                lastError = 0;
+                lastLineSeenTime = millis();
+                setState(LF_FOLLOWING);
+                return;
+            }
+            // Allow some extra travel in case the line curved away meanwhile
+            if (elapsed >= 2 * LINE_SIDESTEP_STRAFE_MS) {
+                Log.println("Side-step failed - line not found");
+                uart->sendMotorCommand(CMD_STOP, 0);
+                setState(LF_LOST);
+                return;
+            }
+            uart->sendMotorCommand(sidestepBack, turnSpeed);
+            break;
+    }
+}
+
+bool LineFollowing::isLeftBranch(uint8_t pattern) {
+    return (pattern & LINE_MASK_LEFT_EDGE) && (pattern & LINE_MASK_CENTER);
+}
+
+bool LineFollowing::isRightBranch(uint8_t pattern) {
+    return (pattern & LINE_MASK_RIGHT_EDGE) && (pattern & LINE_MASK_CENTER);
+}
+
 float LineFollowing::calculateError() {
     float error = 0;
     int count = 0;
@@ -39,7 +433,7 @@ float LineFollowing::calculateError() {
     if (sensor->isBlack(4)) { error += 2; count++; }// Rightmost
 
     if (count == 0) return lastError; // Keep last error if line lost
-    
+
     return error / count;
 }
 
@@ -50,15 +444,10 @@ void LineFollowing::updateSteering() {
 
     float steering = (error * KP) + (dError * KD);
 
-    if (abs(error) < 0.5f) {
-        uart->sendMotorCommand(CMD_FORWARD, baseSpeed);
-    } else if (steering > 0) {
-        // Line is to the right, turn right
-        uart->sendMotorCommand(CMD_RIGHT, baseSpeed);
-    } else {
-        // Line is to the left, turn left
-        uart->sendMotorCommand(CMD_LEFT, baseSpeed);
-    }
+    // Differential drive - positive error means the line is to the right
+    int left = constrain((int)(currentSpeed + steering), -100, 100);
+    int right = constrain((int)(currentSpeed - steering), -100, 100);
+    uart->sendWheelSetpoints(left, left, right, right);
 }
 
 bool LineFollowing::isLineDetected() {
@@ -3,20 +3,92 @@
 
 #include <Arduino.h>
 #include "sensors/bfd1000.h"
+#include "sensors/hcsr04.h"
 #include "communication/uart.h"
 #include "actuators/ermc1604syg.h"
 #include "config/constants.h"
+#include "config/thresholds.h"
+
+// Branches leaving a junction, relative to the direction of travel
+enum LineBranch : uint8_t {
+    BRANCH_LEFT = 0,
+    BRANCH_STRAIGHT,
+    BRANCH_RIGHT,
+    BRANCH_COUNT
+};
+
+#define EXIT_LEFT     (1 << BRANCH_LEFT)
+#define EXIT_STRAIGHT (1 << BRANCH_STRAIGHT)
+#define EXIT_RIGHT    (1 << BRANCH_RIGHT)
+
+enum LineEventType {
+    LINE_EVENT_NONE = 0,
+    LINE_EVENT_JUNCTION,   // Two or more ways out - a decision is needed
+    LINE_EVENT_MARKER      // Full-width bar with the line continuing (station)
+};
+
+struct LineEvent {
+    LineEventType type;
+    uint8_t exits;         // EXIT_* mask seen while crossing
+    unsigned long timestamp;
+};
+
+enum LineFollowState {
+    LF_FOLLOWING,
+    LF_CROSSING,      // Sensor array is over a junction/marker
+    LF_AT_NODE,       // Waiting for a branch decision
+    LF_ADVANCING,     // Creeping forward before a turn
+    LF_TURNING,       // Rotating onto a branch
+    LF_PAUSED,        // Obstacle ahead, waiting for it to clear
+    LF_SIDESTEP,      // Going around a blockage
+    LF_HALTED,
+    LF_LOST
+};
+
+enum SidestepPhase {
+    SIDESTEP_OUT,
+    SIDESTEP_PASS,
+    SIDESTEP_BACK
+};
 
 class LineFollowing {
 private:
     BFD1000* sensor;
+    UltrasonicManager* ultrasonic;
     UARTProtocol* uart;
     Display* display;
 
     bool isActive;
     int baseSpeed;
+    int turnSpeed;
+    int currentSpeed;         // baseSpeed after the obstacle governor
     float lastError;
-    
+
+    LineFollowState state;
+    unsigned long stateStartTime;
+    unsigned long lastLineSeenTime;
+
+    // Junction detection
+    uint8_t wideSamples;
+    uint8_t narrowSamples;
+    bool seenLeft;
+    bool seenRight;
+    bool seenAllBlack;
+    bool eventPending;
+    LineEvent pendingEvent;
+
+    // Turn manoeuvre
+    MotorCommand turnCommand;
+    bool turnNeedsClear;
+
+    // Obstacle handling
+    LineFollowState resumeState;
+    unsigned long clearSince;
+    bool sidestepEnabled;
+    SidestepPhase sidestepPhase;
+    MotorCommand sidestepOut;
+    MotorCommand sidestepBack;
+
     // PID-like constants for steering
     const float KP = 20.0f;
     const float KD = 10.0f;
@@ -24,15 +96,43 @@ private:
     void updateSteering();
     float calculateError();
 
+    void followLine();
+    void crossNode();
+    void classifyNode(uint8_t pattern);
+    void applyDefaultBranch();
+    void startRotation();
+    void updateTurn();
+    void setState(LineFollowState newState);
+
+    bool checkObstacle();
+    void updatePaused();
+    void startSidestep();
+    void updateSidestep();
+
+    static bool isLeftBranch(uint8_t pattern);
+    static bool isRightBranch(uint8_t pattern);
+
 public:
-    LineFollowing(BFD1000* s, UARTProtocol* u, Display* d);
-    
+    LineFollowing(BFD1000* s, UltrasonicManager* us, UARTProtocol* u, Display* d);
+
     void begin();
     void start();
     void stop();
     void update();
-    
+
     bool isLineDetected();
+
+    // Junction handling - call takeBranch() in the same loop pass the event was taken
+    bool takeEvent(LineEvent& event);
+    void takeBranch(LineBranch branch);
+    void turnAround();
+    void halt();
+
+    LineFollowState getState() { return state; }
+    bool isTurning() { return state == LF_ADVANCING || state == LF_TURNING; }
+    bool isLost() { return state == LF_LOST; }
+    bool isPaused() { return state == LF_PAUSED || state == LF_SIDESTEP; }
+    void setSidestepEnabled(bool enable) { sidestepEnabled = enable; }
 };
 
 #endif
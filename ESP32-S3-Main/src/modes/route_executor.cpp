@@ -0,0 +1,277 @@
+#include "route_executor.h"
+#include "../config/routes.h"
+#include "../config/thresholds.h"
+#include "../utils/logger.h"
+
+RouteExecutor::RouteExecutor(LineFollowing* lf, Display* d, Buzzer* b)
+    : lineFollower(lf), display(d), buzzer(b) {
+    state = ROUTE_IDLE;
+    destination = 0;
+    nextNode = ROUTE_NONE;
+    parkedNode = ROUTE_HOME_NODE;
+    pathLength = 0;
+    pathIndex = 0;
+    dispatchTime = 0;
+    stateStartTime = 0;
+    lastDisplayUpdate = 0;
+    stats = {0, 0, 0, 0, 0};
+}
+
+bool RouteExecutor::startDelivery(uint8_t stationId) {
+    if (isActive()) {
+        Log.println("Route busy - delivery rejected");
+        return false;
+    }
+    if (stationId >= ROUTE_STATION_COUNT || stationId == ROUTE_GRAPH[parkedNode].stationId) {
+        Log.print("Invalid delivery destination: ");
+        Log.println(stationId);
+        return false;
+    }
+
+    if (!planRoute(ROUTE_GRAPH[parkedNode].reverse, stationId)) {
+        Log.print("No route to ");
+        Log.println(ROUTE_STATION_NAMES[stationId]);
+        return false;
+    }
+
+    destination = stationId;
+    dispatchTime = millis();
+    setState(ROUTE_OUTBOUND);
+    lineFollower->start();
+
+    Log.print("Delivery started -> ");
+    Log.print(ROUTE_STATION_NAMES[stationId]);
+    Log.print(" (");
+    Log.print(pathLength);
+    Log.println(" nodes)");
+    buzzer->playTone(TONE_CONFIRM);
+    return true;
+}
+
+void RouteExecutor::abort() {
+    if (state == ROUTE_IDLE) return;
+    lineFollower->halt();
+    Log.println("Delivery aborted");
+    stats.failed++;
+    // Position is unknown from here on - staff bring the cart back to the dock
+    parkedNode = ROUTE_HOME_NODE;
+    setState(ROUTE_IDLE);
+}
+
+void RouteExecutor::update() {
+    if (!isActive()) return;
+
+    lineFollower->update();
+
+    switch (state) {
+        case ROUTE_OUTBOUND:
+        case ROUTE_RETURNING: {
+            LineEvent event;
+            if (lineFollower->takeEvent(event)) {
+                handleNode(event);
+            } else if (lineFollower->isLost()) {
+                fail("LINE LOST");
+            } else if (lineFollower->getState() == LF_HALTED) {
+                fail("END OF LINE");
+            }
+            break;
+        }
+
+        case ROUTE_DWELLING:
+            if (millis() - stateStartTime >= ROUTE_DWELL_TIME) {
+                if (!planRoute(ROUTE_GRAPH[parkedNode].reverse, ROUTE_GRAPH[ROUTE_HOME_NODE].stationId)) {
+                    fail("NO ROUTE HOME");
+                    break;
+                }
+                setState(ROUTE_RETURNING);
+                lineFollower->turnAround();
+                Log.println("Returning home");
+            }
+            break;
+
+        case ROUTE_PARKING:
+            // Turned around on the home marker - park facing the corridor
+            if (lineFollower->isLost()) {
+                fail("PARK FAILED");
+            } else if (!lineFollower->isTurning()) {
+                lineFollower->halt();
+
+                stats.lastRoundTripMs = millis() - dispatchTime;
+                stats.totalRoundTripMs += stats.lastRoundTripMs;
+                stats.completed++;
+
+                Log.print("Delivery complete. Round trip: ");
+                Log.print(stats.lastRoundTripMs / 1000.0f, 1);
+                Log.print("s | Avg: ");
+                Log.print((stats.totalRoundTripMs / stats.completed) / 1000.0f, 1);
+                Log.print("s over ");
+                Log.print(stats.completed);
+                Log.println(" deliveries");
+
+                buzzer->doubleBeep();
+                setState(ROUTE_IDLE);
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (millis() - lastDisplayUpdate >= 500) {
+        lastDisplayUpdate = millis();
+        displayProgress();
+    }
+}
+
+bool RouteExecutor::planRoute(uint8_t fromNode, uint8_t stationId) {
+    if (fromNode >= ROUTE_NODE_COUNT) return false;
+
+    // Breadth-first search over the directional graph - the graph is tiny
+    uint8_t previous[ROUTE_NODE_COUNT];
+    uint8_t queue[ROUTE_NODE_COUNT];
+    uint8_t head = 0, tail = 0;
+
+    for (uint8_t i = 0; i < ROUTE_NODE_COUNT; i++) previous[i] = ROUTE_NONE;
+    previous[fromNode] = fromNode;
+    queue[tail++] = fromNode;
+
+    uint8_t goal = ROUTE_NONE;
+    while (head < tail) {
+        uint8_t node = queue[head++];
+        const RouteNode& n = ROUTE_GRAPH[node];
+
+        if (n.type == ROUTE_NODE_STATION && n.stationId == stationId) {
+            goal = node;
+            break;
+        }
+
+        for (uint8_t b = 0; b < BRANCH_COUNT; b++) {
+            uint8_t next = n.exits[b];
+            if (next < ROUTE_NODE_COUNT && previous[next] == ROUTE_NONE) {
+                previous[next] = node;
+                queue[tail++] = next;
+            }
+        }
+    }
+
+    if (goal == ROUTE_NONE) return false;
+
+    // Walk back from the goal to count the steps, then fill the path in order
+    uint8_t length = 1;
+    for (uint8_t node = goal; node != fromNode; node = previous[node]) length++;
+    if (length > ROUTE_MAX_STEPS) return false;
+
+    uint8_t node = goal;
+    for (int8_t i = length - 1; i >= 0; i--) {
+        path[i] = node;
+        node = previous[node];
+    }
+
+    pathLength = length;
+    pathIndex = 0;
+    nextNode = path[0];
+    return true;
+}
+
+void RouteExecutor::handleNode(const LineEvent& event) {
+    const RouteNode& node = ROUTE_GRAPH[nextNode];
+
+    bool isMarker = (event.type == LINE_EVENT_MARKER);
+    if (isMarker != (node.type == ROUTE_NODE_STATION)) {
+        fail("ROUTE DESYNC");
+        return;
+    }
+
+    if (pathIndex + 1 >= pathLength) {
+        arrive();
+        return;
+    }
+
+    // Stations on the way are driven straight through
+    uint8_t upcoming = path[pathIndex + 1];
+    LineBranch branch = BRANCH_STRAIGHT;
+    for (uint8_t b = 0; b < BRANCH_COUNT; b++) {
+        if (node.exits[b] == upcoming) {
+            branch = (LineBranch)b;
+            break;
+        }
+    }
+
+    if (!(event.exits & (1 << branch))) {
+        fail("BRANCH MISSING");
+        return;
+    }
+
+    lineFollower->takeBranch(branch);
+    pathIndex++;
+    nextNode = upcoming;
+}
+
+void RouteExecutor::arrive() {
+    lineFollower->halt();
+    parkedNode = nextNode;
+
+    if (state == ROUTE_OUTBOUND) {
+        stats.lastOutboundMs = millis() - dispatchTime;
+        Log.print("Arrived at ");
+        Log.print(ROUTE_STATION_NAMES[destination]);
+        Log.print(" in ");
+        Log.print(stats.lastOutboundMs / 1000.0f, 1);
+        Log.println("s");
+        buzzer->tripleBeep();
+        setState(ROUTE_DWELLING);
+    } else {
+        setState(ROUTE_PARKING);
+        lineFollower->turnAround();
+    }
+}
+
+void RouteExecutor::fail(const char* reason) {
+    lineFollower->halt();
+    stats.failed++;
+
+    Log.print("Route failed: ");
+    Log.println(reason);
+
+    buzzer->playTone(TONE_ERROR);
+    display->displayError(reason);
+    parkedNode = ROUTE_HOME_NODE;
+    setState(ROUTE_ERROR);
+}
+
+void RouteExecutor::setState(RouteState newState) {
+    state = newState;
+    stateStartTime = millis();
+}
+
+void RouteExecutor::displayProgress() {
+    display->clear();
+    display->setCursor(0, 0);
+    display->print("ROUTE>");
+    display->print(ROUTE_STATION_NAMES[destination]);
+
+    display->setCursor(0, 1);
+    switch (state) {
+        case ROUTE_OUTBOUND:  display->print("OUT "); break;
+        case ROUTE_DWELLING:  display->print("UNLOADING"); break;
+        case ROUTE_RETURNING: display->print("BACK "); break;
+        case ROUTE_PARKING:   display->print("PARKING"); break;
+        default: break;
+    }
+    if (state == ROUTE_OUTBOUND || state == ROUTE_RETURNING) {
+        display->print(pathIndex + 1);
+        display->print("/");
+        display->print(pathLength);
+    }
+
+    display->setCursor(0, 2);
+    display->print("Done:");
+    display->print(stats.completed);
+    display->print(" Fail:");
+    display->print(stats.failed);
+
+    display->setCursor(0, 3);
+    display->print("Avg:");
+    display->print(stats.completed ? (int)(stats.totalRoundTripMs / stats.completed / 1000) : 0);
+    display->print("s");
+}
@@ -0,0 +1,67 @@
+#ifndef ROUTE_EXECUTOR_H
+#define ROUTE_EXECUTOR_H
+
+#include <Arduino.h>
+#include "modes/line_following.h"
+#include "actuators/ermc1604syg.h"
+#include "actuators/sfm27.h"
+
+#define ROUTE_MAX_STEPS 16
+
+enum RouteState {
+    ROUTE_IDLE = 0,
+    ROUTE_OUTBOUND,
+    ROUTE_DWELLING,
+    ROUTE_RETURNING,
+    ROUTE_PARKING,
+    ROUTE_ERROR
+};
+
+struct DeliveryStats {
+    uint16_t completed;
+    uint16_t failed;
+    unsigned long lastOutboundMs;    // dispatch -> arrival at the destination
+    unsigned long lastRoundTripMs;   // dispatch -> parked at home again
+    unsigned long totalRoundTripMs;
+};
+
+class RouteExecutor {
+private:
+    LineFollowing* lineFollower;
+    Display* display;
+    Buzzer* buzzer;
+
+    RouteState state;
+    uint8_t destination;          // Station ID
+    uint8_t nextNode;             // Node expected to be met next
+    uint8_t parkedNode;           // Station node the robot is parked at
+
+    uint8_t path[ROUTE_MAX_STEPS];
+    uint8_t pathLength;
+    uint8_t pathIndex;
+
+    unsigned long dispatchTime;
+    unsigned long stateStartTime;
+    unsigned long lastDisplayUpdate;
+    DeliveryStats stats;
+
+    bool planRoute(uint8_t fromNode, uint8_t stationId);
+    void handleNode(const LineEvent& event);
+    void arrive();
+    void fail(const char* reason);
+    void setState(RouteState newState);
+    void displayProgress();
+
+public:
+    RouteExecutor(LineFollowing* lf, Display* d, Buzzer* b);
+
+    bool startDelivery(uint8_t stationId);
+    void abort();
+    void update();
+
+    bool isActive() { return state != ROUTE_IDLE && state != ROUTE_ERROR; }
+    RouteState getState() { return state; }
+    DeliveryStats getStats() { return stats; }
+};
+
+#endif
@@ -80,3 +80,11 @@ bool BFD1000::isAllWhite() {
     }
     return true;
 }
+
+uint8_t BFD1000::getPattern() {
+    uint8_t pattern = 0;
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (blackState[i]) pattern |= (1 << i);
+    }
+    return pattern;
+}
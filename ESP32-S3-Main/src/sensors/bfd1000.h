@@ -20,6 +20,7 @@ public:
     bool isAnyBlack();             
     bool isAllBlack();             
     bool isAllWhite();             
+    uint8_t getPattern();          // Bit i set when sensor i sees black (bit 0 = leftmost)
 
 private:
     uint8_t sensorPins[SENSOR_COUNT];
@@ -0,0 +1,24 @@
+#ifndef COLOR_TYPE_H
+#define COLOR_TYPE_H
+
+// Staff card colours - kept apart from the TCS3200 driver so telemetry can use them
+enum ColorType {
+    COLOR_WHITE,    //Minor Staaff
+    COLOR_BLUE,     //Surgeon | Doctor
+    COLOR_RED,      //Medical Students
+    COLOR_GREEN,    //Nurses
+    COLOR_UNKNOWN
+};
+
+// Name as the dashboard shows it - a string literal, nothing allocated
+inline const char* colorTypeToString(int type) {
+    switch (type) {
+        case COLOR_WHITE:   return "WHITE";
+        case COLOR_BLUE:    return "BLUE";
+        case COLOR_RED:     return "RED";
+        case COLOR_GREEN:   return "GREEN";
+        default:            return "UNKNOWN";
+    }
+}
+
+#endif
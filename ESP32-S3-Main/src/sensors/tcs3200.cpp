@@ -9,7 +9,9 @@ ColorSensor::ColorSensor()
       lastReadTime(0),
       ambientClear(0),
       bufferIndex(0),
-      bufferFilled(false)
+      bufferFilled(false),
+      isColorSensingActive(false),
+      lastDetectedColor(COLOR_UNKNOWN)
 {
     currentColor = {0, 0, 0};
 
@@ -185,33 +187,21 @@ ColorType ColorSensor::getColorType() {
     return COLOR_UNKNOWN;
 }
 
-String ColorSensor::colorTypeToString(ColorType type) {
-    switch(type) {
-        case COLOR_WHITE:   return "WHITE";
-        case COLOR_BLUE:    return "BLUE";
-        case COLOR_RED:     return "RED";
-        case COLOR_GREEN:   return "GREEN";
-        case COLOR_UNKNOWN: return "UNKNOWN";
-        default:            return "UNKNOWN";
-    }
-}
-
-String ColorSensor::monitorColor(bool colour_start) {
+ColorType ColorSensor::monitorColor(bool colour_start) {
     if (colour_start) {
         if (!isColorSensingActive) {
             isColorSensingActive = true;
             Serial.println("Color sensing STARTED");
-            lastDetectedColor = "UNKNOWN";
+            lastDetectedColor = COLOR_UNKNOWN;
         }
         update();
         
         ColorType detectedType = getColorType();
-        String detectedColorStr = colorTypeToString(detectedType);
         
-        if (detectedColorStr != lastDetectedColor) {
-            lastDetectedColor = detectedColorStr;
+        if (detectedType != lastDetectedColor) {
+            lastDetectedColor = detectedType;
             Serial.print("Color changed to: ");
-            Serial.println(lastDetectedColor);
+            Serial.println(colorTypeToString(lastDetectedColor));
         }
         
         return lastDetectedColor;
@@ -220,9 +210,9 @@ String ColorSensor::monitorColor(bool colour_start) {
         if (isColorSensingActive) {
             isColorSensingActive = false;
             Serial.println("Color sensing STOPPED");
-            lastDetectedColor = "UNKNOWN";
+            lastDetectedColor = COLOR_UNKNOWN;
         }
         
-        return "UNKNOWN";
+        return COLOR_UNKNOWN;
     }
 }
\ No newline at end of file
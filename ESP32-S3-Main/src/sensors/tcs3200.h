@@ -4,14 +4,7 @@
 #include <Arduino.h>
 #include <tcs3200.h>
 #include "../config/thresholds.h"
-
-enum ColorType {
-    COLOR_WHITE,    //Minor Staaff
-    COLOR_BLUE,     //Surgeon | Doctor
-    COLOR_RED,      //Medical Students
-    COLOR_GREEN,    //Nurses
-    COLOR_UNKNOWN
-};
+#include "color_type.h"
 
 struct RGBColor {
     int red;
@@ -35,7 +28,7 @@ private:
 
 
     bool isColorSensingActive;
-    String lastDetectedColor;
+    ColorType lastDetectedColor;
     
 public:
     ColorSensor();
@@ -46,8 +39,8 @@ public:
     ColorType getColorType();
 
 
-    String monitorColor(bool colour_start);
-    String colorTypeToString(ColorType type);
+    // Called every loop pass - returns the card colour, COLOR_UNKNOWN while sensing is off
+    ColorType monitorColor(bool colour_start);
 };
 
 #endif
\ No newline at end of file
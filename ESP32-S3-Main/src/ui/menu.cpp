@@ -20,6 +20,9 @@ MenuSystem::MenuSystem(Display* disp, Buzzer* bz, RotaryEncoder* enc, AutomaticL
     settings.currentSpeed = 0;
     settings.currentSpeed = 0;
     settings.wifiConnected = false;
+    memset(&linkStats, 0, sizeof(linkStats));
+    memset(&motorStatus, 0, sizeof(motorStatus));
+    motorStatusFresh = false;
     
     splashStartTime = 0;
     isSplashActive = false;
@@ -67,7 +70,10 @@ void MenuSystem::select() {
             case 1: currentMenu = MONITORING_MENU; break;
             case 2: currentMenu = OBSTACLE_AVOIDANCE_MODE; break;
             case 3: currentMenu = LINE_FOLLOWING; break;
-            case 4: currentMenu = SYSTEM_INFO; break;
+            case 4: currentMenu = SYSTEM_INFO;
+                    currentSelection = 0;
+                    maxMenuItems = 3;   // Status, motor link, motor board pages
+                    break;
             case 5: currentMenu = AUTO_LIGHTING_SUBMENU; 
                     currentSelection = 0; 
                     maxMenuItems = 2; 
@@ -95,6 +101,21 @@ void MenuSystem::select() {
     updateDisplay();
 }
 
+void MenuSystem::enterMode(MenuState mode) {
+    // Remote mode switch (e.g. dispatched delivery) - same splash as a menu select
+    if (currentMenu == mode) return;
+
+    previousMenu = currentMenu;
+    currentMenu = mode;
+    maxMenuItems = 6;
+    currentSelection = 0;
+    splashStartTime = millis();
+    isSplashActive = true;
+
+    buzzer->playTone(TONE_CONFIRM);
+    updateDisplay();
+}
+
 void MenuSystem::exit() {
     if (currentMenu != MAIN_MENU) {
         currentMenu = MAIN_MENU;
@@ -198,6 +219,15 @@ void MenuSystem::displayLineFollowing() {
 }
 
 void MenuSystem::displaySystemInfo() {
+    if (currentSelection == 1) {
+        displayLinkInfo();
+        return;
+    }
+    if (currentSelection == 2) {
+        displayMotorInfo();
+        return;
+    }
+
     int activeModeNum = 0;
     // 1.assistant mode, 2.monitoring, 3.obstacle avoidance 4. line following
     switch (previousMenu) {
@@ -211,6 +241,48 @@ void MenuSystem::displaySystemInfo() {
     display->displayStatus(settings.batteryLevel, settings.temperature, settings.humidity, activeModeNum);
 }
 
+void MenuSystem::displayLinkInfo() {
+    display->setCursor(0, 0);
+    display->print("LINK " + String(linkStats.baudRate / 1000) + "k RTT ms");
+
+    display->setCursor(0, 1);
+    display->print("50%:" + String(linkStats.rttP50Us / 1000.0f, 1) +
+                   " 99%:" + String(linkStats.rttP99Us / 1000.0f, 1));
+
+    display->setCursor(0, 2);
+    display->print("Max:" + String(linkStats.rttMaxUs / 1000.0f, 1) +
+                   " Lost:" + String(linkStats.lost));
+
+    display->setCursor(0, 3);
+    display->print("CRC:" + String(linkStats.crcErrors) + " Retx:" + String(linkStats.retransmits));
+}
+
+void MenuSystem::displayMotorInfo() {
+    display->setCursor(0, 0);
+    if (!motorStatusFresh) {
+        display->print("MOTOR: NO DATA");
+        return;
+    }
+    if (motorStatus.flags & STATUS_ESTOP_ACTIVE) {
+        display->print(motorStatus.estopSource == 1 ? "MOTOR: ESTOP BTN" : "MOTOR: ESTOP UART");
+    } else if (motorStatus.flags & STATUS_TIMEOUT_STOP) {
+        display->print("MOTOR: TIMEOUT");
+    } else {
+        display->print(motorStatus.flags & STATUS_MOVING ? "MOTOR: MOVING" : "MOTOR: IDLE");
+    }
+
+    display->setCursor(0, 1);
+    display->print("LF:" + String(motorStatus.duty[WHEEL_LEFT_FRONT]) +
+                   " LB:" + String(motorStatus.duty[WHEEL_LEFT_BACK]));
+
+    display->setCursor(0, 2);
+    display->print("RF:" + String(motorStatus.duty[WHEEL_RIGHT_FRONT]) +
+                   " RB:" + String(motorStatus.duty[WHEEL_RIGHT_BACK]));
+
+    display->setCursor(0, 3);
+    display->print("TO:" + String(motorStatus.timeouts) + " Exec:" + String(motorStatus.execMaxUs) + "us");
+}
+
 void MenuSystem::displayAutomaticLighting() {
     display->setCursor(0, 0);
     display->print("-- AUTO LIGHT --");
@@ -232,6 +304,15 @@ void MenuSystem::setEnvironmentalData(float temp, float hum) {
     settings.humidity = hum;
 }
 
+void MenuSystem::setLinkStats(const LinkStats& stats) {
+    linkStats = stats;
+}
+
+void MenuSystem::setMotorStatus(const MotorStatus& status, bool fresh) {
+    motorStatus = status;
+    motorStatusFresh = fresh;
+}
+
 void MenuSystem::getBatteryLevel(int level) {
     settings.batteryLevel = level;
 }
@@ -2,6 +2,8 @@
 #define MENU_H
 
 #include <Arduino.h>
+#include "communication/link_stats.h"
+#include "communication/uart.h"
 
 // Forward declarations
 class Display;
@@ -37,6 +39,9 @@ private:
     MenuState currentMenu;
     MenuState previousMenu;
     SystemInfo settings;
+    LinkStats linkStats;
+    MotorStatus motorStatus;
+    bool motorStatusFresh;
 
     int currentSelection;
     int maxMenuItems;
@@ -52,6 +57,8 @@ private:
     void displayMonitoring();
     void displayObstacleAvoidance();
     void displaySystemInfo();
+    void displayLinkInfo();
+    void displayMotorInfo();
     void displayAutomaticLighting();
     
 public:
@@ -60,9 +67,12 @@ public:
     void update();
     MenuState getCurrentState() { return currentMenu; }
     void setEnvironmentalData(float temp, float hum);
+    void setLinkStats(const LinkStats& stats);
+    void setMotorStatus(const MotorStatus& status, bool fresh);
     void enter();
     void exit();
     void select();
+    void enterMode(MenuState mode);
     bool isActive();
     void updateDisplay();
     bool shouldShowSplash();
@@ -2,30 +2,47 @@
 #define LOGGER_H
 
 #include <Arduino.h>
+#include <atomic>
 #include <WiFi.h>
 #include <WebSerial.h>
+#include <freertos/ringbuf.h>
 
 class UnifiedLogger : public Print {
+private:
+    // Once the network task runs, WebSerial is fed from there - a slow
+    // client must not hold up whoever is logging
+    RingbufHandle_t webBuffer = nullptr;
+    std::atomic<uint32_t> webDropped{0};
+
+    void writeWeb(const uint8_t *buffer, size_t size) {
+        if (webBuffer) {
+            if (xRingbufferSend(webBuffer, buffer, size, 0) != pdTRUE) {
+                webDropped += size;
+            }
+        } else if (WiFi.status() == WL_CONNECTED) {
+            WebSerial.write(buffer, size);
+        }
+    }
+
 public:
     virtual size_t write(uint8_t c) override {
         size_t s = Serial.write(c);
-        if (WiFi.status() == WL_CONNECTED) {
-            WebSerial.write(c);
-        }
+        writeWeb(&c, 1);
         return s;
     }
 
     virtual size_t write(const uint8_t *buffer, size_t size) override {
         size_t s = Serial.write(buffer, size);
-        if (WiFi.status() == WL_CONNECTED) {
-            WebSerial.write(buffer, size);
-        }
+        writeWeb(buffer, size);
         return s;
     }
 
     void flush() {
         Serial.flush();
     }
+
+    void attachWebBuffer(RingbufHandle_t buffer) { webBuffer = buffer; }
+    uint32_t getWebDropped() const { return webDropped; }
 };
 
 extern UnifiedLogger Log;
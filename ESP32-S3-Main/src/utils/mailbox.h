@@ -0,0 +1,47 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <Arduino.h>
+#include <atomic>
+
+/*
+    Newest-value mailbox from one writer task to one reader task, without
+    locks. Three slots: the writer fills its own and swaps it into the
+    middle, the reader swaps the middle out for its own when the writer has
+    put something new there. Neither side ever waits, and the reader only
+    ever sees complete values.
+*/
+template <typename T>
+class Mailbox {
+private:
+    static constexpr uint8_t FRESH = 0x04;      // Set on the middle index by post()
+
+    T slots[3];
+    std::atomic<uint8_t> middle;
+    uint8_t back;                               // Writer's slot
+    uint8_t front;                              // Reader's slot
+    std::atomic<uint32_t> overwritten;          // Posted values the reader never took
+
+public:
+    Mailbox() : slots(), middle(1), back(0), front(2), overwritten(0) {}
+
+    // Writer side
+    void post(const T& value) {
+        slots[back] = value;
+        uint8_t previous = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+        if (previous & FRESH) overwritten++;
+        back = previous & ~FRESH;
+    }
+
+    // Reader side - false when nothing new was posted since the last take()
+    bool take(T& value) {
+        if (!(middle.load(std::memory_order_acquire) & FRESH)) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+        value = slots[front];
+        return true;
+    }
+
+    uint32_t getOverwritten() const { return overwritten; }
+};
+
+#endif
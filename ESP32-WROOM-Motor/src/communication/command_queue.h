@@ -0,0 +1,49 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+/*
+    Single-producer / single-consumer ring buffer. The UART receive task
+    pushes decoded frames, the control task pops them; neither side ever
+    blocks or takes a lock. N must be a power of two.
+*/
+template <typename T, uint8_t N>
+class CommandQueue {
+private:
+    static_assert(N >= 2 && N <= 128 && (N & (N - 1)) == 0, "CommandQueue size must be a power of two");
+
+    T items[N];
+    std::atomic<uint8_t> head;     // Next slot to write (producer)
+    std::atomic<uint8_t> tail;     // Next slot to read (consumer)
+
+public:
+    CommandQueue() : head(0), tail(0) {}
+
+    bool push(const T& item) {
+        uint8_t h = head.load(std::memory_order_relaxed);
+        if ((uint8_t)(h - tail.load(std::memory_order_acquire)) >= N) {
+            return false;  // Full
+        }
+        items[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        uint8_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;  // Empty
+        }
+        item = items[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint8_t size() {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+};
+
+#endif
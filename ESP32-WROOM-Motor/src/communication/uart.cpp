@@ -2,43 +2,379 @@
 #include "config/pins.h"
 #include "config/constants.h"
 #include "config/debug.h"
+#include "esp_timer.h"
+#include "motor/l298n.h"
 
 
 UARTProtocol::UARTProtocol() {
     serial = &Serial;
+    txLock = nullptr;
     newDataAvailable = false;
     lastReceivedCommand = CMD_STOP;
     lastReceivedSpeed = 0;
+    lastReceivedSetpoint = {0, {0, 0, 0, 0}};
+    lastReceivedVelocity = {0, 0, 0, 0};
+    lastReceivedSegments.seq = 0;
+    lastReceivedSegments.count = 0;
+    frameTime = 0;
+    frameSeq = 0;
+    emergencyPending = false;
+    emergencyTime = 0;
+    emergencyFrameSeq = 0;
+    lastEmergencySeq = 0;
+    emergencySeen = false;
+    stats = {0, 0, 0, 0, 0, 0};
+    baudRate = UART_BAUD_RATE;
+    lastValidFrame = 0;
+    errorWindowStart = 0;
+    errorWindowBase = 0;
+    polled = false;
+    memset(&polledStatus, 0, sizeof(polledStatus));
+    statusReady = false;
+    pendingSegmentStatus = {0, SEGMENT_DONE, 0, 0};
+    segmentStatusPending = false;
 }
 
 void UARTProtocol::begin() {
+    txLock = xSemaphoreCreateMutex();
     serial->begin(UART_BAUD_RATE, SERIAL_8N1, UART_RX, UART_TX);
     transfer.begin(*serial);
+
+    // Event-driven RX - the driver calls back on FIFO threshold or line idle
+    serial->setRxFIFOFull(UART_RX_FIFO_THRESHOLD);
+    serial->onReceive([this]() { onReceive(); });
     DEBUG_PRINTLN("UART Communication Started - ESP32 WROOM");
 }
 
-bool UARTProtocol::receiveMotorCommand(MotorCommand &cmd, uint8_t &speed) {
+void UARTProtocol::onReceive() {
+    // Runs in the UART event task - decode everything that has arrived
+    MotorFrame frame;
+    while (serial->available()) {
+        if (!decodeFrame(frame)) continue;
+
+        // E-stop lane first - brake before anything else is looked at
+        if (frame.type == PACKET_EMERGENCY_STOP) {
+            handleEmergencyFrame(frame);
+            continue;
+        }
+
+        stats.framesDecoded++;
+        lastValidFrame = millis();
+
+        if (frame.broadcast) {
+            handleBroadcast(frame);
+            continue;
+        }
+
+        // Link maintenance frames never reach the control task
+        if (frame.type == PACKET_BAUD_PROPOSE) {
+            handleBaudProposal(frame.baud);
+            continue;
+        }
+        if (frame.type == PACKET_TIME_SYNC) {
+            handleTimeSync(frame.sync, frame.rxTime);
+            continue;
+        }
+        if (frame.type == PACKET_LINK_TEST) {
+            xSemaphoreTake(txLock, portMAX_DELAY);
+            sendMessage(frame.test);
+            xSemaphoreGive(txLock);
+            continue;
+        }
+        if (frame.type == PACKET_STATUS_POLL) {
+            handleStatusPoll(frame.poll.seq);
+            continue;
+        }
+
+        if (frame.type == PACKET_MOTOR_COMMAND && frame.command.cmd == CMD_EMERGENCY_STOP) {
+            // Bypass the queue - brake now, the control task picks up the state change
+            L298NController::brakeFromISR();
+            raiseEmergency(frame.rxTime, frame.command.seq);
+            sendAcknowledgment(frame.command.cmd, frame.command.speed, frame.command.seq);
+            continue;
+        }
+
+        if (!queue.push(frame)) {
+            stats.queueOverflows++;
+        }
+
+        if (frame.type == PACKET_MOTOR_COMMAND) {
+            sendAcknowledgment(frame.command.cmd, frame.command.speed, frame.command.seq);
+        } else if (frame.type == PACKET_WHEEL_SETPOINT) {
+            sendSetpointAcknowledgment(PACKET_WHEEL_SETPOINT, frame.wheels.seq);
+        } else if (frame.type == PACKET_BODY_VELOCITY) {
+            sendSetpointAcknowledgment(PACKET_BODY_VELOCITY, frame.velocity.seq);
+        } else if (frame.type == PACKET_HEARTBEAT) {
+            sendSetpointAcknowledgment(PACKET_HEARTBEAT, frame.heartbeat.seq);
+        } else if (frame.type == PACKET_SEGMENT_LIST) {
+            // Receipt only - the control task reports how the maneuver ends
+            sendSetpointAcknowledgment(PACKET_SEGMENT_LIST, frame.segments.seq);
+        }
+    }
+}
+
+bool UARTProtocol::decodeFrame(MotorFrame& frame) {
+    if (!transfer.available()) {
+        if (transfer.status <= 0) stats.decodeErrors++;   // CRC, payload, stop byte or stale packet
+        return false;
+    }
+
+    uint8_t frameId = transfer.currentPacketID();
+    frame.rxTime = esp_timer_get_time();
+
+    // Other nodes' traffic is intact, just not ours
+    uint8_t node = busNode(frameId);
+    if (node != MOTOR_NODE_ID && node != NODE_BROADCAST) {
+        stats.otherNodeFrames++;
+        lastValidFrame = millis();
+        return false;
+    }
+    frame.broadcast = (node == NODE_BROADCAST);
+    uint8_t packet = busPacket(frameId);
+
+    DecodeResult result = decodeMessage(TO_MOTOR, packet, transfer.packet.rxBuff, transfer.bytesRead);
+    if (result != DECODE_OK) {
+        DEBUG_PRINT("Frame ");
+        DEBUG_PRINT(packet);
+        DEBUG_PRINT(" dropped: ");
+        DEBUG_PRINTLN(decodeResultName(result));
+        return false;
+    }
+
+    // One copy, straight from the frame buffer into the queue entry
+    frame.type = (PacketId)packet;
+    memcpy(&frame.segments, transfer.packet.rxBuff, min((size_t)transfer.bytesRead, sizeof(SegmentList)));
+    if (packet == PACKET_MOTOR_COMMAND && transfer.bytesRead < sizeof(MotorCommandFrame)) {
+        frame.command.seq = 0;
+    }
+    return true;
+}
+
+void UARTProtocol::handleEmergencyFrame(const MotorFrame& frame) {
+    L298NController::brakeFromISR();
+    int64_t braked = esp_timer_get_time();
+
+    EmergencyAck ack;
+    ack.seq = frame.emergency.seq;
+    ack.copy = frame.emergency.copy;
+    ack.brakeUs = (uint16_t)min(braked - frame.rxTime, (int64_t)UINT16_MAX);
+    ack.decisionUs = frame.emergency.decisionUs;
+    ack.brakedUs = (uint32_t)braked;
+
+    // Fast ack for every addressed copy, ahead of anything the control task has to say
+    if (!frame.broadcast) {
+        xSemaphoreTake(txLock, portMAX_DELAY);
+        sendMessage(ack);
+        xSemaphoreGive(txLock);
+    }
+
+    stats.framesDecoded++;
+    lastValidFrame = millis();
+
+    // The remaining copies of the same stop only get their ack
+    if (emergencySeen && frame.emergency.seq == lastEmergencySeq) return;
+    emergencySeen = true;
+    lastEmergencySeq = frame.emergency.seq;
+
+    raiseEmergency(frame.rxTime, frame.emergency.seq);
+}
+
+void UARTProtocol::raiseEmergency(int64_t rxTime, uint8_t seq) {
+    emergencyTime = rxTime;
+    emergencyFrameSeq = seq;
+    emergencyPending.store(true, std::memory_order_release);
+    stats.emergencyFrames++;
+}
+
+void UARTProtocol::handleBroadcast(const MotorFrame& frame) {
+    if (frame.type == PACKET_MOTOR_COMMAND && frame.command.cmd == CMD_EMERGENCY_STOP) {
+        L298NController::brakeFromISR();
+        raiseEmergency(frame.rxTime, frame.command.seq);
+        return;
+    }
+
+    // Motion applies to every node alike; link maintenance and polls are per node
+    switch (frame.type) {
+        case PACKET_MOTOR_COMMAND:
+        case PACKET_WHEEL_SETPOINT:
+        case PACKET_BODY_VELOCITY:
+        case PACKET_HEARTBEAT:
+            if (!queue.push(frame)) stats.queueOverflows++;
+            break;
+        default:
+            break;
+    }
+}
+
+void UARTProtocol::handleStatusPoll(uint8_t seq) {
+    polled = true;
+
+    // A finished maneuver goes first - the S3 closes the slot on the MotorStatus
+    xSemaphoreTake(txLock, portMAX_DELAY);
+    if (segmentStatusPending) {
+        sendMessage(pendingSegmentStatus);
+        segmentStatusPending = false;
+    }
+    if (statusReady) {
+        MotorStatus reply = polledStatus;
+        reply.seq = seq;
+        sendMessage(reply);
+    }
+    xSemaphoreGive(txLock);
+}
+
+void UARTProtocol::updateStatus(const MotorStatus& status) {
+    xSemaphoreTake(txLock, portMAX_DELAY);
+    polledStatus = status;
+    statusReady = true;
+    xSemaphoreGive(txLock);
+}
+
+void UARTProtocol::handleTimeSync(TimeSyncFrame sync, int64_t rxTime) {
+    // Receive time is when the frame was decoded; the transmit time is taken
+    // as late as possible so the S3 can subtract the time spent here
+    sync.motorRxUs = (uint32_t)rxTime;
+
+    xSemaphoreTake(txLock, portMAX_DELAY);
+    sync.motorTxUs = (uint32_t)esp_timer_get_time();
+    sendMessage(sync);
+    xSemaphoreGive(txLock);
+}
+
+void UARTProtocol::handleBaudProposal(BaudProposal proposal) {
+    proposal.accepted = (proposal.baud == UART_BAUD_RATE);
+    for (uint8_t i = 0; i < LINK_BAUD_RATE_COUNT; i++) {
+        if (proposal.baud == LINK_BAUD_RATES[i]) proposal.accepted = 1;
+    }
+
+    // Boards built from different protocol versions stay at the base rate
+    if (proposal.version != PROTOCOL_VERSION) {
+        DEBUG_PRINT("Protocol version mismatch - S3 v");
+        DEBUG_PRINTLN(proposal.version);
+        proposal.accepted = 0;
+    }
+    proposal.version = PROTOCOL_VERSION;
+
+    // Answer at the current rate, then follow the S3 once the reply is on the wire
+    xSemaphoreTake(txLock, portMAX_DELAY);
+    sendMessage(proposal);
+    xSemaphoreGive(txLock);
+    if (!proposal.accepted) return;
+
+    // The control task sends under txLock - it must not wait out the drain.
+    // A frame it slips in before the switch is lost to CRC, as is anything
+    // the S3 sends while it changes rate too.
+    serial->flush();
+    xSemaphoreTake(txLock, portMAX_DELAY);
+    setBaudRate(proposal.baud);
+    xSemaphoreGive(txLock);
+}
+
+void UARTProtocol::setBaudRate(uint32_t baud) {
+    if (baud == baudRate.load()) return;
+
+    serial->updateBaudRate(baud);
+    baudRate = baud;
+    lastValidFrame = millis();
+    errorWindowStart = millis();
+    errorWindowBase = stats.decodeErrors;
+    DEBUG_PRINT("UART rate: ");
+    DEBUG_PRINTLN(baud);
+}
+
+void UARTProtocol::update() {
+    if (baudRate.load() == UART_BAUD_RATE) return;
 
-    if (transfer.available()) {
+    // Quiet or corrupt at the negotiated rate - go back to the rate both ends start at.
+    // The S3 does the same when its acks stop, then renegotiates.
+    bool silent = (millis() - lastValidFrame.load()) > UART_LINK_SILENCE_MS;
+    bool noisy = (stats.decodeErrors - errorWindowBase) > UART_LINK_ERROR_LIMIT;
 
-        transfer.rxObj(cmd, 0);
-        transfer.rxObj(speed, 1);
-        
-        lastReceivedCommand = cmd;
-        lastReceivedSpeed = speed;
+    if (silent || noisy) {
+        xSemaphoreTake(txLock, portMAX_DELAY);
+        setBaudRate(UART_BAUD_RATE);
+        xSemaphoreGive(txLock);
+        stats.baudFallbacks++;
+        return;
+    }
+
+    if (millis() - errorWindowStart >= 1000) {
+        errorWindowStart = millis();
+        errorWindowBase = stats.decodeErrors;
+    }
+}
+
+PacketId UARTProtocol::receivePacket() {
+    if (emergencyPending.exchange(false, std::memory_order_acquire)) {
+        lastReceivedCommand = CMD_EMERGENCY_STOP;
+        lastReceivedSpeed = 0;
+        frameTime = emergencyTime;
+        frameSeq = emergencyFrameSeq;
         newDataAvailable = true;
-        
-        sendAcknowledgment(cmd, speed);
-        
-        return true;
+        return PACKET_MOTOR_COMMAND;
+    }
+
+    MotorFrame frame;
+    if (!queue.pop(frame)) {
+        return PACKET_NONE;
+    }
+
+    frameTime = frame.rxTime;
+    newDataAvailable = true;
+
+    // Every S3 -> WROOM frame but the legacy command starts with its sequence number
+    frameSeq = (frame.type == PACKET_MOTOR_COMMAND) ? frame.command.seq : frame.heartbeat.seq;
+
+    switch (frame.type) {
+        case PACKET_MOTOR_COMMAND:
+            lastReceivedCommand = frame.command.cmd;
+            lastReceivedSpeed = frame.command.speed;
+            break;
+        case PACKET_WHEEL_SETPOINT:
+            lastReceivedSetpoint = frame.wheels;
+            break;
+        case PACKET_BODY_VELOCITY:
+            lastReceivedVelocity = frame.velocity;
+            break;
+        case PACKET_SEGMENT_LIST:
+            lastReceivedSegments = frame.segments;
+            break;
+        default:
+            break;
+    }
+    return frame.type;
+}
+
+void UARTProtocol::sendAcknowledgment(MotorCommand cmd, uint8_t speed, uint8_t seq) {
+    MotorCommandFrame ack = {cmd, speed, seq};
+    xSemaphoreTake(txLock, portMAX_DELAY);
+    sendMessage(ack);
+    xSemaphoreGive(txLock);
+}
+
+void UARTProtocol::sendSetpointAcknowledgment(PacketId packet, uint8_t seq) {
+    FrameAck ack = {seq};
+    xSemaphoreTake(txLock, portMAX_DELAY);
+    transfer.sendData(encodeMessage(transfer.packet.txBuff, ack), busFrameId(MOTOR_NODE_ID, packet));
+    xSemaphoreGive(txLock);
+}
+
+void UARTProtocol::sendSegmentStatus(const SegmentStatus& status) {
+    // On a polled bus it would collide with another node's reply - held for the next poll
+    xSemaphoreTake(txLock, portMAX_DELAY);
+    if (polled.load()) {
+        pendingSegmentStatus = status;
+        segmentStatusPending = true;
+    } else {
+        sendMessage(status);
     }
-    return false;
+    xSemaphoreGive(txLock);
 }
 
-void UARTProtocol::sendAcknowledgment(MotorCommand cmd, uint8_t speed) {
-    transfer.txObj(cmd, 0);
-    transfer.txObj(speed, 1);
-    transfer.sendData(2);
+void UARTProtocol::sendMotorStatus(const MotorStatus& status) {
+    xSemaphoreTake(txLock, portMAX_DELAY);
+    sendMessage(status);
+    xSemaphoreGive(txLock);
 }
 
 bool UARTProtocol::isNewDataAvailable() {
@@ -3,34 +3,117 @@
 
 #include <Arduino.h>
 #include "SerialTransfer.h"
+#include "synapse_protocol.h"
+#include "command_queue.h"
+#include "config/constants.h"
 
-enum MotorCommand : uint8_t {
-    CMD_STOP = 0,
-    CMD_FORWARD,
-    CMD_BACKWARD,
-    CMD_LEFT,
-    CMD_RIGHT,
-    CMD_ROTATE_LEFT,
-    CMD_ROTATE_RIGHT,
-    CMD_STRAFE_LEFT,
-    CMD_STRAFE_RIGHT,
-    CMD_EMERGENCY_STOP
+// One decoded frame as handed from the receive task to the control task
+struct MotorFrame {
+    PacketId type;
+    bool broadcast;             // Addressed to every node - acted on, never answered
+    int64_t rxTime;             // esp_timer time the frame was decoded
+    union {
+        MotorCommandFrame command;  // seq is 0 from senders that predate sequence numbers
+        WheelSetpoint wheels;
+        BodyVelocitySetpoint velocity;
+        SegmentList segments;
+        Heartbeat heartbeat;
+        BaudProposal baud;
+        LinkTestFrame test;
+        EmergencyFrame emergency;
+        TimeSyncFrame sync;
+        StatusPoll poll;
+    };
+};
+
+struct UARTStats {
+    uint32_t framesDecoded;
+    uint32_t queueOverflows;     // Frames dropped because the control task fell behind
+    uint32_t decodeErrors;       // CRC / framing errors reported by SerialTransfer
+    uint32_t emergencyFrames;
+    uint32_t baudFallbacks;      // Negotiated rates abandoned for UART_BAUD_RATE
+    uint32_t otherNodeFrames;    // Bus frames addressed to another node
 };
 
 class UARTProtocol {
 private:
     HardwareSerial* serial;
     SerialTransfer transfer;
+    SemaphoreHandle_t txLock;
     
     MotorCommand lastReceivedCommand;
     uint8_t lastReceivedSpeed;
+    WheelSetpoint lastReceivedSetpoint;
+    BodyVelocitySetpoint lastReceivedVelocity;
+    SegmentList lastReceivedSegments;
     bool newDataAvailable;
+    int64_t frameTime;
+    uint8_t frameSeq;
+
+    // Filled by the UART event task, drained by the control task
+    CommandQueue<MotorFrame, UART_QUEUE_LENGTH> queue;
+    std::atomic<bool> emergencyPending;
+    int64_t emergencyTime;
+    uint8_t emergencyFrameSeq;
+    uint8_t lastEmergencySeq;
+    bool emergencySeen;
+    UARTStats stats;
+
+    // Link rate - changed by the receive task on request, reverted by update()
+    std::atomic<uint32_t> baudRate;
+    std::atomic<uint32_t> lastValidFrame;   // millis()
+    uint32_t errorWindowStart;
+    uint32_t errorWindowBase;
+
+    // Bus polling - once the S3 polls, status only goes out as a poll reply
+    std::atomic<bool> polled;
+    MotorStatus polledStatus;   // Latest snapshot from the status reporter, under txLock
+    bool statusReady;
+    SegmentStatus pendingSegmentStatus;
+    bool segmentStatusPending;
+
+    void onReceive();
+    bool decodeFrame(MotorFrame& frame);
+    void handleBaudProposal(BaudProposal proposal);
+    void handleEmergencyFrame(const MotorFrame& frame);
+    void handleTimeSync(TimeSyncFrame sync, int64_t rxTime);
+    void handleStatusPoll(uint8_t seq);
+    void handleBroadcast(const MotorFrame& frame);
+    void raiseEmergency(int64_t rxTime, uint8_t seq);
+    void setBaudRate(uint32_t baud);
+
+    // Caller holds txLock. Replies carry this board's node address.
+    template <typename T>
+    void sendMessage(const T& message) {
+        transfer.sendData(encodeMessage(transfer.packet.txBuff, message),
+                          busFrameId(MOTOR_NODE_ID, MessageTraits<T>::id));
+    }
 
 public:
     UARTProtocol();
     void begin();
-    bool receiveMotorCommand(MotorCommand &cmd, uint8_t &speed);
-    void sendAcknowledgment(MotorCommand cmd, uint8_t speed);
+    void update();              // Link rate fallback - call periodically from loop()
+    uint32_t getBaudRate() { return baudRate.load(); }
+
+    // Returns the next received frame (PACKET_NONE if nothing) and fills the getters.
+    // Frames are decoded in the UART event task as bytes arrive; an emergency stop
+    // brakes the motors there and is returned here ahead of anything queued.
+    PacketId receivePacket();
+    int64_t getFrameTime() { return frameTime; }   // esp_timer time the last frame was decoded
+    uint8_t getFrameSeq() { return frameSeq; }      // Its sequence number, reported back when applied
+    MotorCommand getReceivedCommand() { return lastReceivedCommand; }
+    uint8_t getReceivedSpeed() { return lastReceivedSpeed; }
+    const WheelSetpoint& getReceivedSetpoint() { return lastReceivedSetpoint; }
+    const BodyVelocitySetpoint& getReceivedVelocity() { return lastReceivedVelocity; }
+    const SegmentList& getReceivedSegments() { return lastReceivedSegments; }
+    UARTStats getStats() { return stats; }
+
+    void sendAcknowledgment(MotorCommand cmd, uint8_t speed, uint8_t seq);
+    void sendSetpointAcknowledgment(PacketId packet, uint8_t seq);
+    void sendSegmentStatus(const SegmentStatus& status);
+    void sendMotorStatus(const MotorStatus& status);
+    void updateStatus(const MotorStatus& status);   // Snapshot returned to bus polls
+    bool isPolled() { return polled.load(); }
     bool isNewDataAvailable();
     void clearNewDataFlag();
 };
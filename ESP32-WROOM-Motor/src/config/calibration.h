@@ -0,0 +1,32 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <Arduino.h>
+
+/*
+    Per-motor speed -> duty calibration.
+
+    Entry i is the duty (per mille of full scale) that gives i * 10 % of the
+    wheel's top speed. Entry 0 is the breakaway duty: the lowest duty at which
+    the wheel still turns under load, used for any non-zero request so the
+    deadband is skipped. Values in between are interpolated linearly.
+
+    The tables below are nominal placeholders, not measurements: a straight
+    line with no breakaway, so speed % is duty % as before calibration.
+    Measure each motor with test/test9_deadband_calibration.cpp and replace
+    them - then the S3's MOTOR_SPEED_MIN / MOTOR_SPEED_DEFAULT, which are
+    still the old duty figures, can come down to the speeds they stand for.
+*/
+
+#define MOTOR_CAL_POINTS 11
+
+struct MotorCalibration {
+    uint16_t duty[MOTOR_CAL_POINTS];
+};
+
+static const MotorCalibration LEFT_FRONT_CAL  = {{0, 100, 200, 300, 400, 500, 600, 700, 800, 900, 1000}};
+static const MotorCalibration LEFT_BACK_CAL   = {{0, 100, 200, 300, 400, 500, 600, 700, 800, 900, 1000}};
+static const MotorCalibration RIGHT_FRONT_CAL = {{0, 100, 200, 300, 400, 500, 600, 700, 800, 900, 1000}};
+static const MotorCalibration RIGHT_BACK_CAL  = {{0, 100, 200, 300, 400, 500, 600, 700, 800, 900, 1000}};
+
+#endif
@@ -5,6 +5,32 @@
 #define TURN_SPEED_RATIO 30
 
 //Baud rate UART
-#define UART_BAUD_RATE 115200
+#define UART_BAUD_RATE 115200        // Start-up rate - the S3 negotiates a faster one
+#define UART_LINK_SILENCE_MS 1500     // No valid frame at a negotiated rate -> back to UART_BAUD_RATE
+#define UART_LINK_ERROR_LIMIT 5       // Decode errors per second at a negotiated rate -> back to base
+#define UART_RX_FIFO_THRESHOLD 8      // Bytes before the RX event fires (line idle also fires it)
+#define UART_QUEUE_LENGTH 16          // Decoded frames waiting for the control task
+#ifndef MOTOR_NODE_ID
+#define MOTOR_NODE_ID 0               // Bus address - extra boards are built with -DMOTOR_NODE_ID=n
+#endif
 
-#endif
\ No newline at end of file
+//Motor PWM - frequency * 2^resolution must not exceed the 80 MHz APB clock
+#define MOTOR_PWM_FREQ 18000          // Hz, above the audible whine of 5 kHz
+#define MOTOR_PWM_RESOLUTION 12       // bits (10-12)
+#define MCPWM_TIMER_RESOLUTION_HZ 80000000
+#define MOTOR_DEAD_TIME_US 200        // Zero-duty gap before an H-bridge reverses
+
+//Control loop
+#define CONTROL_PERIOD_US 1000        // 1 kHz
+#define CONTROL_TASK_PRIORITY 20      // Above the Arduino loop and UART event tasks
+#define CONTROL_TASK_CORE 1
+#define CONTROL_TASK_STACK 4096
+#define COMMAND_TIMEOUT_MS 500        // Ramp down when the S3 goes quiet
+#define MOTOR_STATUS_PERIOD_MS 100    // MotorStatus frames to the S3 until it starts polling
+#define SEGMENT_MAX_DURATION_MS 5000  // Longest single segment of an uploaded maneuver
+
+//Motion profile (wheel duty in %)
+#define PROFILE_MAX_ACCEL 250.0f      // %/s  - 0 to full duty in 0.4 s
+#define PROFILE_MAX_JERK 2500.0f      // %/s^2 - full acceleration reached in 0.1 s
+
+#endif
@@ -0,0 +1,291 @@
+#include "control_loop.h"
+#include "config/debug.h"
+
+ControlLoop::ControlLoop(UARTProtocol* u, MovementController* m, SpeedController* s,
+                         EmergencyStop* e, MotionProfiler* p, SegmentPlayer* sp)
+    : uart(u), movement(m), speed(s), emergency(e), profiler(p), player(sp) {
+    task = nullptr;
+    timer = nullptr;
+    lastCommandTime = 0;
+    timedOut = false;
+    lastWake = 0;
+    latencySum = 0;
+    statsMux = portMUX_INITIALIZER_UNLOCKED;
+    resetStats();
+}
+
+void ControlLoop::begin() {
+    xTaskCreatePinnedToCore(taskEntry, "control", CONTROL_TASK_STACK, this,
+                            CONTROL_TASK_PRIORITY, &task, CONTROL_TASK_CORE);
+
+    esp_timer_create_args_t args = {};
+    args.callback = &ControlLoop::onTimer;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "control";
+
+    if (task == nullptr || esp_timer_create(&args, &timer) != ESP_OK) {
+        DEBUG_PRINTLN("ERROR: Control loop setup failed");
+        return;
+    }
+
+    esp_timer_start_periodic(timer, CONTROL_PERIOD_US);
+    DEBUG_PRINTLN("Control Loop Started");
+}
+
+void ControlLoop::onTimer(void* arg) {
+    ControlLoop* loop = static_cast<ControlLoop*>(arg);
+    xTaskNotifyGive(loop->task);
+}
+
+void ControlLoop::taskEntry(void* arg) {
+    static_cast<ControlLoop*>(arg)->run();
+}
+
+void ControlLoop::run() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        int64_t wake = esp_timer_get_time();
+        if (lastWake != 0) {
+            int32_t jitter = (int32_t)(wake - lastWake) - CONTROL_PERIOD_US;
+            portENTER_CRITICAL(&statsMux);
+            if (jitter < stats.jitterMin) stats.jitterMin = jitter;
+            if (jitter > stats.jitterMax) stats.jitterMax = jitter;
+            if (jitter >= (int32_t)CONTROL_PERIOD_US) stats.overruns++;
+            portEXIT_CRITICAL(&statsMux);
+        }
+        lastWake = wake;
+
+        cycle();
+
+        uint32_t exec = (uint32_t)(esp_timer_get_time() - wake);
+        portENTER_CRITICAL(&statsMux);
+        stats.cycles++;
+        if (exec > stats.execMax) stats.execMax = exec;
+        portEXIT_CRITICAL(&statsMux);
+    }
+}
+
+void ControlLoop::cycle() {
+    // Update emergency stop system (handles physical button)
+    emergency->update();
+
+    // Drain everything the receive task decoded since the last cycle. An
+    // emergency stop is handled at once; of the motion frames only the
+    // newest is applied, older ones are stale by now. A maneuver upload
+    // starts in arrival order and replaces any motion frame before it.
+    PacketId motion = PACKET_NONE;
+    int64_t motionTime = 0;
+    uint8_t motionSeq = 0;
+    uint32_t superseded = 0;
+    PacketId packet;
+    while ((packet = uart->receivePacket()) != PACKET_NONE) {
+        if (packet == PACKET_MOTOR_COMMAND && uart->getReceivedCommand() == CMD_EMERGENCY_STOP) {
+            handlePacket(packet);
+            recordLatency(uart->getFrameTime(), uart->getFrameSeq());
+            continue;
+        }
+        if (packet == PACKET_HEARTBEAT) {
+            handlePacket(packet);
+            continue;
+        }
+        if (motion != PACKET_NONE) superseded++;
+        if (packet == PACKET_SEGMENT_LIST) {
+            motion = PACKET_NONE;
+            motionTime = handlePacket(packet) ? uart->getFrameTime() : 0;
+            motionSeq = uart->getFrameSeq();
+            continue;
+        }
+        motion = packet;
+        motionTime = uart->getFrameTime();
+        motionSeq = uart->getFrameSeq();
+    }
+    if (motion != PACKET_NONE && !handlePacket(motion)) {
+        motionTime = 0;
+    }
+    if (superseded > 0) {
+        portENTER_CRITICAL(&statsMux);
+        stats.coalesced += superseded;
+        portEXIT_CRITICAL(&statsMux);
+    }
+
+    // A maneuver never outlives an e-stop, whichever source raised it
+    if (player->isActive()) {
+        if (emergency->isEmergencyActive()) {
+            player->abort(esp_timer_get_time());
+        } else {
+            player->update(esp_timer_get_time());
+            lastCommandTime = millis();   // The S3 is silent on purpose while it plays
+        }
+    }
+
+    // Safety timeout - ramp down if no command received for a while
+    if ((millis() - lastCommandTime) > COMMAND_TIMEOUT_MS && movement->getIsMoving()) {
+        DEBUG_PRINTLN("Command timeout - decelerating to stop");
+        movement->stop();
+        timedOut = true;
+        portENTER_CRITICAL(&statsMux);
+        stats.timeouts++;
+        portEXIT_CRITICAL(&statsMux);
+    }
+
+    if (profiler != nullptr) {
+        profiler->update();
+    }
+
+    if (motionTime != 0) {
+        timedOut = false;
+        recordLatency(motionTime, motionSeq);
+    }
+}
+
+bool ControlLoop::handlePacket(PacketId packet) {
+    if (packet == PACKET_MOTOR_COMMAND) {
+        lastCommandTime = millis();
+        MotorCommand receivedCommand = uart->getReceivedCommand();
+        uint8_t receivedSpeed = uart->getReceivedSpeed();
+        
+        // Handle emergency stop command from UART
+        if (receivedCommand == CMD_EMERGENCY_STOP) {
+            emergency->activate(UART);
+            DEBUG_PRINTLN("Emergency stop activated via UART!");
+            return true;
+        }
+        
+        // If emergency is active, don't execute movement commands
+        if (emergency->isEmergencyActive()) {
+            DEBUG_PRINTLN("Movement blocked: Emergency Active");
+            return false;
+        }
+        
+        // Anything streamed takes over from an uploaded maneuver
+        player->abort(esp_timer_get_time());
+
+        uint8_t adjustedSpeed = speed->applySpeedLimit(receivedSpeed);
+        movement->executeCommand(receivedCommand, adjustedSpeed);
+        stats.appliedSpeed = adjustedSpeed;
+        
+        DEBUG_PRINT("Command: ");
+        switch (receivedCommand) {
+            case CMD_FORWARD: DEBUG_PRINT("FORWARD"); break;
+            case CMD_BACKWARD: DEBUG_PRINT("BACKWARD"); break;
+            case CMD_LEFT: DEBUG_PRINT("LEFT"); break;
+            case CMD_RIGHT: DEBUG_PRINT("RIGHT"); break;
+            case CMD_ROTATE_LEFT: DEBUG_PRINT("ROTATE_LEFT"); break;
+            case CMD_ROTATE_RIGHT: DEBUG_PRINT("ROTATE_RIGHT"); break;
+            case CMD_STRAFE_LEFT: DEBUG_PRINT("STRAFE_LEFT"); break;
+            case CMD_STRAFE_RIGHT: DEBUG_PRINT("STRAFE_RIGHT"); break;
+            case CMD_STOP: DEBUG_PRINT("STOP"); break;
+            default: DEBUG_PRINT("UNKNOWN"); break;
+        }
+        DEBUG_PRINT(" | Speed: ");
+        DEBUG_PRINTLN(adjustedSpeed);
+    } else if (packet == PACKET_WHEEL_SETPOINT) {
+        lastCommandTime = millis();
+
+        if (emergency->isEmergencyActive()) {
+            DEBUG_PRINTLN("Setpoint blocked: Emergency Active");
+            return false;
+        }
+
+        player->abort(esp_timer_get_time());
+
+        // Speed limits apply to each wheel's magnitude, direction is kept
+        WheelSetpoint setpoint = uart->getReceivedSetpoint();
+        for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+            if (setpoint.wheels[i] == 0) continue;
+            uint8_t limited = speed->applySpeedLimit(abs(setpoint.wheels[i]));
+            setpoint.wheels[i] = (setpoint.wheels[i] < 0) ? -(int8_t)limited : (int8_t)limited;
+        }
+        movement->applyWheelSetpoint(setpoint);
+
+        DEBUG_PRINT("Setpoint #");
+        DEBUG_PRINT(setpoint.seq);
+        DEBUG_PRINT(": ");
+        for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+            DEBUG_PRINT(setpoint.wheels[i]);
+            DEBUG_PRINT(i < WHEEL_COUNT - 1 ? " " : "\n");
+        }
+    } else if (packet == PACKET_BODY_VELOCITY) {
+        lastCommandTime = millis();
+
+        if (emergency->isEmergencyActive()) {
+            DEBUG_PRINTLN("Velocity blocked: Emergency Active");
+            return false;
+        }
+
+        player->abort(esp_timer_get_time());
+
+        // The speed limit caps the fastest wheel, the IK keeps the direction
+        const BodyVelocitySetpoint& velocity = uart->getReceivedVelocity();
+        movement->setBodyVelocity(velocity.vx, velocity.vy, velocity.omega,
+                                  speed->getMaxSpeed());
+
+        DEBUG_PRINT("Velocity #");
+        DEBUG_PRINT(velocity.seq);
+        DEBUG_PRINT(": vx ");
+        DEBUG_PRINT(velocity.vx);
+        DEBUG_PRINT(" vy ");
+        DEBUG_PRINT(velocity.vy);
+        DEBUG_PRINT(" w ");
+        DEBUG_PRINTLN(velocity.omega);
+    } else if (packet == PACKET_HEARTBEAT) {
+        // The S3 only transmits changes - this says the last one still stands
+        lastCommandTime = millis();
+        return false;
+    } else if (packet == PACKET_SEGMENT_LIST) {
+        lastCommandTime = millis();
+        const SegmentList& segments = uart->getReceivedSegments();
+
+        if (segments.count == 0) {
+            // Explicit abort - ramp down from wherever the maneuver got to
+            if (!player->isActive()) return false;
+            player->abort(esp_timer_get_time());
+            movement->stop();
+            return true;
+        }
+
+        if (emergency->isEmergencyActive()) {
+            DEBUG_PRINTLN("Maneuver blocked: Emergency Active");
+            player->reject(segments.seq);
+            return false;
+        }
+
+        return player->load(segments, esp_timer_get_time());
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+void ControlLoop::recordLatency(int64_t frameTime, uint8_t seq) {
+    // Motion frames are timed after the profiler step, so this is frame -> first output change
+    int64_t now = esp_timer_get_time();
+    uint32_t latency = (uint32_t)(now - frameTime);
+
+    portENTER_CRITICAL(&statsMux);
+    stats.commands++;
+    stats.appliedUs = (uint32_t)now;
+    stats.appliedSeq = seq;
+    stats.latencyLast = latency;
+    if (latency > stats.latencyMax) stats.latencyMax = latency;
+    latencySum += latency;
+    stats.latencyAvg = latencySum / stats.commands;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+ControlStats ControlLoop::getStats() {
+    portENTER_CRITICAL(&statsMux);
+    ControlStats copy = stats;
+    portEXIT_CRITICAL(&statsMux);
+    return copy;
+}
+
+void ControlLoop::resetStats() {
+    portENTER_CRITICAL(&statsMux);
+    stats = {0, 0, INT32_MAX, INT32_MIN, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    latencySum = 0;
+    portEXIT_CRITICAL(&statsMux);
+}
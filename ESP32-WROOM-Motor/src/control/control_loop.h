@@ -0,0 +1,74 @@
+#ifndef CONTROL_LOOP_H
+#define CONTROL_LOOP_H
+
+#include <Arduino.h>
+#include "esp_timer.h"
+#include "communication/uart.h"
+#include "motor/movement.h"
+#include "motor/profiler.h"
+#include "motor/segment_player.h"
+#include "motor/speed.h"
+#include "safety/emergency.h"
+#include "config/constants.h"
+
+// All times in microseconds
+struct ControlStats {
+    uint32_t cycles;
+    uint32_t overruns;          // Cycles that started a full period late
+    int32_t jitterMin;          // Wake-up period minus CONTROL_PERIOD_US
+    int32_t jitterMax;
+    uint32_t execMax;           // Longest cycle body
+    uint32_t latencyLast;       // UART frame received -> outputs committed
+    uint32_t latencyMax;
+    uint32_t latencyAvg;
+    uint32_t commands;
+    uint32_t coalesced;         // Motion frames superseded within the same cycle
+    uint32_t timeouts;          // Ramp-downs because the S3 went quiet
+    uint8_t appliedSpeed;       // Last command speed after the speed limits, %
+    uint32_t appliedUs;         // esp_timer time (low 32 bits) a frame last reached the outputs
+    uint8_t appliedSeq;         // That frame's sequence number
+};
+
+/*
+    Motor control cycle at a fixed rate. An esp_timer wakes a high-priority
+    task pinned to CONTROL_TASK_CORE every CONTROL_PERIOD_US; each pass
+    handles the e-stop, decodes any received frame, advances an uploaded
+    maneuver, runs the timeout check and steps the motion profiler.
+*/
+class ControlLoop {
+private:
+    UARTProtocol* uart;
+    MovementController* movement;
+    SpeedController* speed;
+    EmergencyStop* emergency;
+    MotionProfiler* profiler;
+    SegmentPlayer* player;
+
+    TaskHandle_t task;
+    esp_timer_handle_t timer;
+    unsigned long lastCommandTime;
+    bool timedOut;              // Stopped by the timeout, no motion frame since
+
+    ControlStats stats;
+    int64_t lastWake;
+    uint64_t latencySum;
+    portMUX_TYPE statsMux;
+
+    static void onTimer(void* arg);
+    static void taskEntry(void* arg);
+    void run();
+    void cycle();
+    bool handlePacket(PacketId packet);   // true if the frame changed the outputs
+    void recordLatency(int64_t frameTime, uint8_t seq);
+
+public:
+    ControlLoop(UARTProtocol* u, MovementController* m, SpeedController* s,
+                EmergencyStop* e, MotionProfiler* p, SegmentPlayer* sp);
+    void begin();
+
+    ControlStats getStats();
+    void resetStats();
+    bool isTimedOut() { return timedOut; }
+};
+
+#endif
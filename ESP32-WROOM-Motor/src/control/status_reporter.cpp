@@ -0,0 +1,61 @@
+#include "status_reporter.h"
+
+StatusReporter::StatusReporter(UARTProtocol* u, L298NController* m, ControlLoop* c,
+                               EmergencyStop* e, SegmentPlayer* p)
+    : uart(u), motors(m), control(c), emergency(e), player(p) {
+    seq = 0;
+    lastReport = 0;
+}
+
+uint16_t StatusReporter::clamp16(int64_t value) {
+    return (uint16_t)constrain(value, (int64_t)0, (int64_t)UINT16_MAX);
+}
+
+void StatusReporter::update() {
+    ControlStats timing = control->getStats();
+    UARTStats link = uart->getStats();
+
+    MotorStatus status;
+    status.seq = seq;
+    status.flags = 0;
+    if (emergency->isEmergencyActive()) status.flags |= STATUS_ESTOP_ACTIVE;
+    if (L298NController::isBrakedFromISR()) status.flags |= STATUS_BRAKED;
+    if (control->isTimedOut()) status.flags |= STATUS_TIMEOUT_STOP;
+    if (player->isActive()) status.flags |= STATUS_MANEUVER;
+
+    status.estopSource = emergency->isEmergencyActive() ? emergency->getLastSource() : NONE;
+    status.appliedSpeed = timing.appliedSpeed;
+
+    // Outputs as last committed - percent of full scale, signed by direction
+    uint32_t maxDuty = motors->getMaxDuty();
+    for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+        MotorDirection direction = motors->getAppliedDirection(i);
+        int8_t percent = (int8_t)((motors->getAppliedDuty(i) * 100 + maxDuty / 2) / maxDuty);
+
+        status.direction[i] = direction;
+        status.duty[i] = (direction == MOTOR_BACKWARD) ? -percent : percent;
+        if (percent > 0 && (direction == MOTOR_FORWARD || direction == MOTOR_BACKWARD)) {
+            status.flags |= STATUS_MOVING;
+        }
+    }
+
+    status.timeouts = clamp16(timing.timeouts);
+    status.overruns = clamp16(timing.overruns);
+    status.jitterMaxUs = clamp16(timing.jitterMax);
+    status.execMaxUs = clamp16(timing.execMax);
+    status.latencyAvgUs = clamp16(timing.latencyAvg);
+    status.frameErrors = clamp16(link.decodeErrors);
+
+    // Raw WROOM clock - the S3 maps these onto its own timeline
+    status.timeUs = (uint32_t)esp_timer_get_time();
+    status.appliedUs = timing.appliedUs;
+    status.appliedSeq = timing.appliedSeq;
+
+    // Bus polls are answered with the latest snapshot; unpolled, it is pushed periodically
+    uart->updateStatus(status);
+    if (uart->isPolled() || millis() - lastReport < MOTOR_STATUS_PERIOD_MS) return;
+    lastReport = millis();
+
+    status.seq = ++seq;
+    uart->sendMotorStatus(status);
+}
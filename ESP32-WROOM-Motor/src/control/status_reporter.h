@@ -0,0 +1,40 @@
+#ifndef STATUS_REPORTER_H
+#define STATUS_REPORTER_H
+
+#include <Arduino.h>
+#include "control_loop.h"
+#include "communication/uart.h"
+#include "motor/l298n.h"
+#include "motor/segment_player.h"
+#include "safety/emergency.h"
+#include "config/constants.h"
+
+/*
+    Sends a MotorStatus frame to the S3 every MOTOR_STATUS_PERIOD_MS, so it
+    can see what the motor board is actually doing: applied duty, e-stop
+    latch, timeout stops, control loop timing and link errors. Runs from
+    loop() - it only reads state, it never touches the outputs.
+
+    On a motor bus the S3 polls instead; the snapshot is refreshed on every
+    call and the UART receive task answers polls with it.
+*/
+class StatusReporter {
+private:
+    UARTProtocol* uart;
+    L298NController* motors;
+    ControlLoop* control;
+    EmergencyStop* emergency;
+    SegmentPlayer* player;
+
+    uint8_t seq;
+    unsigned long lastReport;
+
+    static uint16_t clamp16(int64_t value);
+
+public:
+    StatusReporter(UARTProtocol* u, L298NController* m, ControlLoop* c,
+                   EmergencyStop* e, SegmentPlayer* p);
+    void update();
+};
+
+#endif
@@ -2,21 +2,26 @@
 #include "communication/uart.h"
 #include "motor/l298n.h"
 #include "motor/movement.h"
+#include "motor/profiler.h"
+#include "motor/segment_player.h"
 #include "motor/speed.h"
 #include "safety/emergency.h"
+#include "control/control_loop.h"
+#include "control/status_reporter.h"
 #include "config/pins.h"
 #include "config/debug.h"
 
 // Global objects
 UARTProtocol uart;
 L298NController motorController;
-MovementController movementController(&motorController);
+MotionProfiler motionProfiler(&motorController);
+MovementController movementController(&motorController, &motionProfiler);
 SpeedController speedController;
 EmergencyStop emergencyStop(EMERGENCY_STOP_PIN, &movementController);
-
-// Timing
-unsigned long lastCommandTime = 0;
-const unsigned long COMMAND_TIMEOUT = 500;
+SegmentPlayer segmentPlayer(&movementController, &speedController, &uart);
+ControlLoop controlLoop(&uart, &movementController, &speedController, &emergencyStop,
+                        &motionProfiler, &segmentPlayer);
+StatusReporter statusReporter(&uart, &motorController, &controlLoop, &emergencyStop, &segmentPlayer);
 
 void setup() {
     // Initialize UART first so Serial is ready for debug prints
@@ -29,63 +34,74 @@ void setup() {
     
     // Initialize remaining systems
     motorController.begin();
+    motionProfiler.begin();
     movementController.begin();
     speedController.begin();
     emergencyStop.begin();
+    controlLoop.begin();
     
     DEBUG_PRINTLN("All systems initialized!");
     DEBUG_PRINTLN("Waiting for commands from ESP32 S3...\n");
 }
 
 void loop() {
-    // Update emergency stop system (handles physical button)
-    emergencyStop.update();
-    
-    // Receive and process motor commands
-    MotorCommand receivedCommand;
-    uint8_t receivedSpeed;
-    
-    if (uart.receiveMotorCommand(receivedCommand, receivedSpeed)) {
-        lastCommandTime = millis();
-        
-        // Handle emergency stop command from UART
-        if (receivedCommand == CMD_EMERGENCY_STOP) {
-            emergencyStop.activate(UART);
-            DEBUG_PRINTLN("Emergency stop activated via UART!");
-            return;
-        }
-        
-        // If emergency is active, don't execute movement commands
-        if (emergencyStop.isEmergencyActive()) {
-            DEBUG_PRINTLN("Movement blocked: Emergency Active");
-            return;
-        }
-        
-        uint8_t adjustedSpeed = speedController.applySpeedLimit(receivedSpeed);
-        movementController.executeCommand(receivedCommand, adjustedSpeed);
-        
-        DEBUG_PRINT("Command: ");
-        switch (receivedCommand) {
-            case CMD_FORWARD: DEBUG_PRINT("FORWARD"); break;
-            case CMD_BACKWARD: DEBUG_PRINT("BACKWARD"); break;
-            case CMD_LEFT: DEBUG_PRINT("LEFT"); break;
-            case CMD_RIGHT: DEBUG_PRINT("RIGHT"); break;
-            case CMD_ROTATE_LEFT: DEBUG_PRINT("ROTATE_LEFT"); break;
-            case CMD_ROTATE_RIGHT: DEBUG_PRINT("ROTATE_RIGHT"); break;
-            case CMD_STRAFE_LEFT: DEBUG_PRINT("STRAFE_LEFT"); break;
-            case CMD_STRAFE_RIGHT: DEBUG_PRINT("STRAFE_RIGHT"); break;
-            case CMD_STOP: DEBUG_PRINT("STOP"); break;
-            default: DEBUG_PRINT("UNKNOWN"); break;
+    // Motor control runs in the control task - the loop only watches the link
+    // rate and reports status
+    uart.update();
+    statusReporter.update();
+
+#ifdef DEBUG_MODE
+    static unsigned long lastReport = 0;
+    if (millis() - lastReport >= 5000) {
+        lastReport = millis();
+        ControlStats stats = controlLoop.getStats();
+
+        DEBUG_PRINT("Control: ");
+        DEBUG_PRINT(stats.cycles);
+        DEBUG_PRINT(" cycles | jitter ");
+        DEBUG_PRINT(stats.jitterMin);
+        DEBUG_PRINT("..");
+        DEBUG_PRINT(stats.jitterMax);
+        DEBUG_PRINT(" us | exec max ");
+        DEBUG_PRINT(stats.execMax);
+        DEBUG_PRINT(" us | overruns ");
+        DEBUG_PRINT(stats.overruns);
+        DEBUG_PRINT(" | latency avg ");
+        DEBUG_PRINT(stats.latencyAvg);
+        DEBUG_PRINT(" max ");
+        DEBUG_PRINT(stats.latencyMax);
+        DEBUG_PRINTLN(" us");
+
+        UARTStats link = uart.getStats();
+        DEBUG_PRINT("UART: ");
+        DEBUG_PRINT(link.framesDecoded);
+        DEBUG_PRINT(" frames | coalesced ");
+        DEBUG_PRINT(stats.coalesced);
+        DEBUG_PRINT(" | overflows ");
+        DEBUG_PRINT(link.queueOverflows);
+        DEBUG_PRINT(" | errors ");
+        DEBUG_PRINT(link.decodeErrors);
+        DEBUG_PRINT(" | ");
+        DEBUG_PRINT(uart.getBaudRate());
+        DEBUG_PRINT(" baud, fallbacks ");
+        DEBUG_PRINT(link.baudFallbacks);
+        DEBUG_PRINT(" | node ");
+        DEBUG_PRINT(MOTOR_NODE_ID);
+        DEBUG_PRINT(uart.isPolled() ? " polled" : "");
+        DEBUG_PRINT(", other nodes ");
+        DEBUG_PRINTLN(link.otherNodeFrames);
+
+        EmergencyStats estop = emergencyStop.getStats();
+        if (estop.events > 0) {
+            DEBUG_PRINT("E-stop: ");
+            DEBUG_PRINT(estop.events);
+            DEBUG_PRINT(" presses | ISR->brake max ");
+            DEBUG_PRINT(estop.maxBrakeNs);
+            DEBUG_PRINT(" ns | ISR->handled max ");
+            DEBUG_PRINT(estop.maxHandledUs);
+            DEBUG_PRINTLN(" us");
         }
-        DEBUG_PRINT(" | Speed: ");
-        DEBUG_PRINTLN(adjustedSpeed);
-    }
-    
-    // Safety timeout - stop if no command received for a while
-    if ((millis() - lastCommandTime) > COMMAND_TIMEOUT && movementController.getIsMoving()) {
-        DEBUG_PRINTLN("Command timeout - stopping motors");
-        movementController.stop();
     }
-    
-    delay(10);
-}
\ No newline at end of file
+#endif
+    vTaskDelay(pdMS_TO_TICKS(10));
+}
@@ -2,12 +2,31 @@
 #include "config/pins.h"
 #include "config/debug.h"
 #include "config/constants.h"
+#include "driver/mcpwm.h"
+#include "soc/gpio_struct.h"
+#include "soc/gpio_sig_map.h"
 
-L298NMotor::L298NMotor(uint8_t in1, uint8_t in2, uint8_t en, uint8_t pwmChannel)
-    : in1Pin(in1), in2Pin(in2), enPin(en), PWM_CHANNEL(pwmChannel) {
+uint32_t L298NController::isrInMask = 0;
+uint32_t L298NController::isrEnMask = 0;
+uint8_t L298NController::isrEnPins[4] = {0, 0, 0, 0};
+volatile bool L298NController::isrBraked = false;
+volatile bool L298NController::isrDetached = false;
+portMUX_TYPE L298NController::outputMux = portMUX_INITIALIZER_UNLOCKED;
+
+static_assert((uint64_t)MOTOR_PWM_FREQ << MOTOR_PWM_RESOLUTION <= 80000000ULL,
+              "MOTOR_PWM_FREQ too high for MOTOR_PWM_RESOLUTION");
+
+L298NMotor::L298NMotor(uint8_t in1, uint8_t in2, uint8_t en, uint8_t pwmChannel,
+                       const MotorCalibration* cal, uint32_t pwmFreq, uint8_t pwmResolution)
+    : in1Pin(in1), in2Pin(in2), enPin(en), PWM_CHANNEL(pwmChannel),
+      PWM_FREQ(pwmFreq), PWM_RESOLUTION(pwmResolution),
+      PWM_MAX_DUTY((1UL << pwmResolution) - 1), calibration(cal) {
     currentSpeed = 0;
+    currentDuty = 0;
+    direction = MOTOR_COAST;
     isEnabled = true;
     initialized = false;
+    deferred = false;
     // Validate PWM channel
     if (PWM_CHANNEL > 15) {
         DEBUG_PRINT("ERROR: Invalid PWM channel ");
@@ -42,42 +61,66 @@ void L298NMotor::begin() {
     stop();
 }
 
+void L298NMotor::beginDeferred() {
+    pinMode(in1Pin, OUTPUT);
+    pinMode(in2Pin, OUTPUT);
+    digitalWrite(in1Pin, LOW);
+    digitalWrite(in2Pin, LOW);
+
+    deferred = true;
+    initialized = true;
+    currentSpeed = 0;
+    currentDuty = 0;
+    direction = MOTOR_COAST;
+}
+
 void L298NMotor::forward(uint8_t speed) {
     if (!isEnabled || !initialized) return;
-    
-    digitalWrite(in1Pin, LOW);
-    digitalWrite(in2Pin, HIGH);
-    
-    currentSpeed = constrain(speed, 0, 100);
-    uint8_t pwmValue = map(currentSpeed, 0, 100, 0, 255);
-    ledcWrite(PWM_CHANNEL, pwmValue);
+    setState(MOTOR_FORWARD, speed);
 }
 
 void L298NMotor::backward(uint8_t speed) {
     if (!isEnabled || !initialized) return;
-    
-    digitalWrite(in1Pin, HIGH);
-    digitalWrite(in2Pin, LOW);
-    
-    currentSpeed = constrain(speed, 0, 100);
-    uint8_t pwmValue = map(currentSpeed, 0, 100, 0, 255);
-    ledcWrite(PWM_CHANNEL, pwmValue);
+    setState(MOTOR_BACKWARD, speed);
 }
 
 void L298NMotor::stop() {
-    digitalWrite(in1Pin, LOW);
-    digitalWrite(in2Pin, LOW);
+    setState(MOTOR_COAST, 0);
+}
+
+void L298NMotor::brake() {
+    setState(MOTOR_BRAKE, 0);
+}
+
+void L298NMotor::setState(MotorDirection dir, uint8_t speed) {
+    direction = dir;
+    currentSpeed = constrain(speed, 0, 100);
+    if (dir == MOTOR_BRAKE) {
+        currentDuty = PWM_MAX_DUTY;
+    } else if (dir == MOTOR_COAST) {
+        currentDuty = 0;
+    } else {
+        currentDuty = speedToDuty(currentSpeed);
+    }
+
+    // Under a controller the state is only staged until commit()
+    if (deferred) return;
+
+    digitalWrite(in1Pin, (dir == MOTOR_BACKWARD || dir == MOTOR_BRAKE) ? HIGH : LOW);
+    digitalWrite(in2Pin, (dir == MOTOR_FORWARD || dir == MOTOR_BRAKE) ? HIGH : LOW);
     if (initialized) {
-        ledcWrite(PWM_CHANNEL, 0);
+        ledcWrite(PWM_CHANNEL, currentDuty);
     }
-    currentSpeed = 0;
 }
 
-void L298NMotor::brake() {
-    digitalWrite(in1Pin, HIGH);
-    digitalWrite(in2Pin, HIGH);
-    ledcWrite(PWM_CHANNEL, 255);
-    currentSpeed = 0;
+void L298NMotor::drive(int8_t speed) {
+    if (speed > 0) {
+        forward(speed);
+    } else if (speed < 0) {
+        backward(-speed);
+    } else {
+        stop();
+    }
 }
 
 uint8_t L298NMotor::getCurrentSpeed() {
@@ -87,16 +130,50 @@ uint8_t L298NMotor::getCurrentSpeed() {
 void L298NMotor::setSpeed(uint8_t speed) {
     if (!isEnabled || !initialized) return;
     
-    currentSpeed = constrain(speed, 0, 100);
-    uint8_t pwmValue = map(currentSpeed, 0, 100, 0, 255);
-    ledcWrite(PWM_CHANNEL, pwmValue);
+    setState(direction, speed);
+}
+
+uint32_t L298NMotor::speedToDuty(uint8_t speed) {
+    if (speed == 0) return 0;
+    if (calibration == nullptr) {
+        return (PWM_MAX_DUTY * speed + 50) / 100;
+    }
+
+    // Interpolate between the 10 % calibration points
+    uint16_t position = (uint16_t)speed * (MOTOR_CAL_POINTS - 1);
+    uint8_t index = position / 100;
+    uint8_t fraction = position % 100;
+
+    uint32_t permille = calibration->duty[index];
+    if (index < MOTOR_CAL_POINTS - 1) {
+        int32_t span = (int32_t)calibration->duty[index + 1] - calibration->duty[index];
+        permille += (span * fraction) / 100;
+    }
+
+    permille = constrain(permille, 0, 1000);
+    return (PWM_MAX_DUTY * permille + 500) / 1000;
 }
 
 L298NController::L298NController() {
-    leftFrontMotor = new L298NMotor(LEFT_FRONT_IN1, LEFT_FRONT_IN2, LEFT_FRONT_ENA, 0);
-    leftBackMotor = new L298NMotor(LEFT_BACK_IN1, LEFT_BACK_IN2, LEFT_BACK_ENB, 1);
-    rightFrontMotor = new L298NMotor(RIGHT_FRONT_IN1, RIGHT_FRONT_IN2, RIGHT_FRONT_ENA, 2);
-    rightBackMotor = new L298NMotor(RIGHT_BACK_IN1, RIGHT_BACK_IN2, RIGHT_BACK_ENB, 3);
+    leftFrontMotor = new L298NMotor(LEFT_FRONT_IN1, LEFT_FRONT_IN2, LEFT_FRONT_ENA, 0, &LEFT_FRONT_CAL);
+    leftBackMotor = new L298NMotor(LEFT_BACK_IN1, LEFT_BACK_IN2, LEFT_BACK_ENB, 1, &LEFT_BACK_CAL);
+    rightFrontMotor = new L298NMotor(RIGHT_FRONT_IN1, RIGHT_FRONT_IN2, RIGHT_FRONT_ENA, 2, &RIGHT_FRONT_CAL);
+    rightBackMotor = new L298NMotor(RIGHT_BACK_IN1, RIGHT_BACK_IN2, RIGHT_BACK_ENB, 3, &RIGHT_BACK_CAL);
+
+    motors[0] = leftFrontMotor;
+    motors[1] = leftBackMotor;
+    motors[2] = rightFrontMotor;
+    motors[3] = rightBackMotor;
+
+    initialized = false;
+    directionMask = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        appliedDirection[i] = MOTOR_COAST;
+        appliedDuty[i] = 0;
+        directionHeld[i] = false;
+        settling[i] = false;
+        settleDeadline[i] = 0;
+    }
 }
 
 L298NController::~L298NController() {
@@ -116,27 +193,177 @@ L298NController::~L298NController() {
 }
 
 void L298NController::begin() {
-    leftFrontMotor->begin();
-    leftBackMotor->begin();
-    rightFrontMotor->begin();
-    rightBackMotor->begin();
-    
-    // Check if all motors
-    if (!leftFrontMotor->isInitialized() || 
-        !leftBackMotor->isInitialized() || 
-        !rightFrontMotor->isInitialized() || 
-        !rightBackMotor->isInitialized()) {
-        DEBUG_PRINTLN("WARNING: One or more motors failed to initialize");
+    directionMask = 0;
+    isrEnMask = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        motors[i]->beginDeferred();
+        directionMask |= (1UL << motors[i]->getIn1Pin()) | (1UL << motors[i]->getIn2Pin());
+        isrEnPins[i] = motors[i]->getEnPin();
+        isrEnMask |= (1UL << isrEnPins[i]);
     }
-    
+    isrInMask = directionMask;
+
+    attachEnables();
+
+    // 80 MHz tick gives ~12 bit duty steps at MOTOR_PWM_FREQ
+    mcpwm_group_set_resolution(MCPWM_UNIT_0, MCPWM_TIMER_RESOLUTION_HZ);
+    mcpwm_timer_set_resolution(MCPWM_UNIT_0, MCPWM_TIMER_0, MCPWM_TIMER_RESOLUTION_HZ);
+    mcpwm_timer_set_resolution(MCPWM_UNIT_0, MCPWM_TIMER_1, MCPWM_TIMER_RESOLUTION_HZ);
+
+    mcpwm_config_t config = {};
+    config.frequency = MOTOR_PWM_FREQ;
+    config.cmpr_a = 0;
+    config.cmpr_b = 0;
+    config.counter_mode = MCPWM_UP_COUNTER;
+    config.duty_mode = MCPWM_DUTY_MODE_0;
+
+    if (mcpwm_init(MCPWM_UNIT_0, MCPWM_TIMER_0, &config) != ESP_OK ||
+        mcpwm_init(MCPWM_UNIT_0, MCPWM_TIMER_1, &config) != ESP_OK) {
+        DEBUG_PRINTLN("WARNING: MCPWM setup failed - motors disabled");
+        return;
+    }
+
+    // Timer 0 resets timer 1 on every period start so both latch duties together
+    mcpwm_set_timer_sync_output(MCPWM_UNIT_0, MCPWM_TIMER_0, MCPWM_SWSYNC_SOURCE_TEZ);
+    mcpwm_sync_config_t sync = {};
+    sync.sync_sig = MCPWM_SELECT_TIMER0_SYNC;
+    sync.timer_val = 0;
+    sync.count_direction = MCPWM_TIMER_DIRECTION_UP;
+    mcpwm_sync_configure(MCPWM_UNIT_0, MCPWM_TIMER_1, &sync);
+
+    initialized = true;
     allStop();
 }
 
+void L298NController::attachEnables() {
+    // Front motors on timer 0, rear motors on timer 1 (A = left, B = right)
+    mcpwm_gpio_init(MCPWM_UNIT_0, MCPWM0A, LEFT_FRONT_ENA);
+    mcpwm_gpio_init(MCPWM_UNIT_0, MCPWM0B, RIGHT_FRONT_ENA);
+    mcpwm_gpio_init(MCPWM_UNIT_0, MCPWM1A, LEFT_BACK_ENB);
+    mcpwm_gpio_init(MCPWM_UNIT_0, MCPWM1B, RIGHT_BACK_ENB);
+}
+
+void IRAM_ATTR L298NController::brakeFromISR() {
+    if (isrEnMask == 0) return;
+
+    // IN1 = IN2 = HIGH on every bridge, then hand the enable pins to the GPIO
+    // matrix with their output latched HIGH - a full-strength brake
+    portENTER_CRITICAL_ISR(&outputMux);
+    GPIO.out_w1ts = isrInMask | isrEnMask;
+    for (uint8_t i = 0; i < 4; i++) {
+        GPIO.func_out_sel_cfg[isrEnPins[i]].func_sel = SIG_GPIO_OUT_IDX;
+    }
+
+    isrBraked = true;
+    isrDetached = true;
+    portEXIT_CRITICAL_ISR(&outputMux);
+}
+
+void L298NController::commit() {
+    if (!initialized) return;
+
+    // The interrupt brake owns the outputs until the e-stop logic releases it
+    if (isrBraked) return;
+    if (isrDetached) {
+        attachEnables();
+        isrDetached = false;
+        if (isrBraked) {
+            // A brake landed while re-attaching - put it back and stay braked
+            brakeFromISR();
+            return;
+        }
+        for (uint8_t i = 0; i < 4; i++) {
+            appliedDirection[i] = MOTOR_BRAKE;
+            appliedDuty[i] = motors[i]->getMaxDuty();
+        }
+    }
+
+    uint32_t duty[4];
+    MotorDirection dir[4];
+    uint32_t now = micros();
+    for (uint8_t i = 0; i < 4; i++) {
+        MotorDirection next = motors[i]->getDirection();
+        uint32_t nextDuty = motors[i]->getCurrentDuty();
+        if (settling[i] && (int32_t)(now - settleDeadline[i]) >= 0) settling[i] = false;
+
+        // The IN pins change at once but a duty only at the next period start,
+        // so a bridge changes direction only while it is off: zero duty for
+        // one PWM period, so the zero latches, plus the dead time. The wait is
+        // left to later commits rather than spent here.
+        if (next != appliedDirection[i] && (appliedDuty[i] > 0 || settling[i])) {
+            if (appliedDuty[i] > 0) {
+                settling[i] = true;
+                settleDeadline[i] = now + 1000000UL / MOTOR_PWM_FREQ + MOTOR_DEAD_TIME_US;
+            }
+            directionHeld[i] = true;
+            dir[i] = appliedDirection[i];
+            duty[i] = 0;
+            continue;
+        }
+
+        // Going to zero in the same direction - a direction change right after
+        // must still wait for the zero to latch
+        if (nextDuty == 0 && appliedDuty[i] > 0) {
+            settling[i] = true;
+            settleDeadline[i] = now + 1000000UL / MOTOR_PWM_FREQ + MOTOR_DEAD_TIME_US;
+        }
+        directionHeld[i] = false;
+        dir[i] = next;
+        duty[i] = nextDuty;
+    }
+
+    // A bridge whose direction changes here is off, so its new duty starts
+    // at the next period start together with every other bridge's
+    writeDirections(dir);
+    writeDuties(duty);
+}
+
+void L298NController::update() {
+    if (isHoldingDirection()) commit();
+}
+
+bool L298NController::isHoldingDirection() {
+    for (uint8_t i = 0; i < 4; i++) {
+        if (directionHeld[i]) return true;
+    }
+    return false;
+}
+
+void L298NController::writeDuties(const uint32_t duty[4]) {
+    static const mcpwm_timer_t timers[4] = {MCPWM_TIMER_0, MCPWM_TIMER_1, MCPWM_TIMER_0, MCPWM_TIMER_1};
+    static const mcpwm_generator_t generators[4] = {MCPWM_GEN_A, MCPWM_GEN_A, MCPWM_GEN_B, MCPWM_GEN_B};
+
+    // Compare values are shadowed and only take effect at the next period start (TEZ)
+    for (uint8_t i = 0; i < 4; i++) {
+        float percent = (duty[i] * 100.0f) / motors[i]->getMaxDuty();
+        mcpwm_set_duty(MCPWM_UNIT_0, timers[i], generators[i], percent);
+        appliedDuty[i] = duty[i];
+    }
+}
+
+void L298NController::writeDirections(const MotorDirection dir[4]) {
+    uint32_t levels = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        if (dir[i] == MOTOR_BACKWARD || dir[i] == MOTOR_BRAKE) levels |= (1UL << motors[i]->getIn1Pin());
+        if (dir[i] == MOTOR_FORWARD || dir[i] == MOTOR_BRAKE) levels |= (1UL << motors[i]->getIn2Pin());
+        appliedDirection[i] = dir[i];
+    }
+
+    // One store updates all eight IN pins (all below GPIO 32). The brake may
+    // have landed from the other core since commit() checked - it wins.
+    portENTER_CRITICAL(&outputMux);
+    if (!isrBraked) {
+        GPIO.out = (GPIO.out & ~directionMask) | levels;
+    }
+    portEXIT_CRITICAL(&outputMux);
+}
+
 void L298NController::allForward(uint8_t speed) {
     leftFrontMotor->forward(speed);
     leftBackMotor->forward(speed);
     rightFrontMotor->forward(speed);
     rightBackMotor->forward(speed);
+    commit();
 }
 
 void L298NController::allBackward(uint8_t speed) {
@@ -144,6 +371,7 @@ void L298NController::allBackward(uint8_t speed) {
     leftBackMotor->backward(speed);
     rightFrontMotor->backward(speed);
     rightBackMotor->backward(speed);
+    commit();
 }
 
 void L298NController::allStop() {
@@ -151,6 +379,7 @@ void L298NController::allStop() {
     leftBackMotor->stop();
     rightFrontMotor->stop();
     rightBackMotor->stop();
+    commit();
 }
 
 void L298NController::allBrake() {
@@ -158,26 +387,31 @@ void L298NController::allBrake() {
     leftBackMotor->brake();
     rightFrontMotor->brake();
     rightBackMotor->brake();
+    commit();
 }
 
 void L298NController::leftSideForward(uint8_t speed) {
     leftFrontMotor->forward(speed);
     leftBackMotor->forward(speed);
+    commit();
 }
 
 void L298NController::leftSideBackward(uint8_t speed) {
     leftFrontMotor->backward(speed);
     leftBackMotor->backward(speed);
+    commit();
 }
 
 void L298NController::rightSideForward(uint8_t speed) {
     rightFrontMotor->forward(speed);
     rightBackMotor->forward(speed);
+    commit();
 }
 
 void L298NController::rightSideBackward(uint8_t speed) {
     rightFrontMotor->backward(speed);
     rightBackMotor->backward(speed);
+    commit();
 }
 
 void L298NController::strafeLeft(uint8_t speed) {
@@ -186,6 +420,7 @@ void L298NController::strafeLeft(uint8_t speed) {
     rightFrontMotor->forward(speed);
     leftBackMotor->forward(speed);
     rightBackMotor->backward(speed);
+    commit();
 }
 
 void L298NController::strafeRight(uint8_t speed) {
@@ -194,14 +429,25 @@ void L298NController::strafeRight(uint8_t speed) {
     rightFrontMotor->backward(speed);
     leftBackMotor->backward(speed);
     rightBackMotor->forward(speed);
+    commit();
 }
 
 void L298NController::leftSideStop() {
     leftFrontMotor->stop();
     leftBackMotor->stop();
+    commit();
 }
 
 void L298NController::rightSideStop() {
     rightFrontMotor->stop();
     rightBackMotor->stop();
-}
\ No newline at end of file
+    commit();
+}
+
+void L298NController::setWheels(int8_t leftFront, int8_t leftBack, int8_t rightFront, int8_t rightBack) {
+    leftFrontMotor->drive(leftFront);
+    leftBackMotor->drive(leftBack);
+    rightFrontMotor->drive(rightFront);
+    rightBackMotor->drive(rightBack);
+    commit();
+}
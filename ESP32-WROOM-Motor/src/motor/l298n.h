@@ -2,6 +2,16 @@
 #define L298N_H
 
 #include <Arduino.h>
+#include "config/constants.h"
+#include "config/calibration.h"
+
+// H-bridge state of one motor: IN1/IN2 levels
+enum MotorDirection : uint8_t {
+    MOTOR_COAST = 0,     // LOW/LOW
+    MOTOR_FORWARD,       // LOW/HIGH
+    MOTOR_BACKWARD,      // HIGH/LOW
+    MOTOR_BRAKE          // HIGH/HIGH
+};
 
 class L298NMotor {
 private:
@@ -9,31 +19,85 @@ private:
     uint8_t in2Pin;
     uint8_t enPin;
     uint8_t currentSpeed;
+    uint32_t currentDuty;
+    MotorDirection direction;
     bool isEnabled;
     bool initialized;
+    bool deferred;                         // Outputs are written by L298NController::commit()
     
     const uint8_t PWM_CHANNEL;
-    const uint32_t PWM_FREQ = 5000;
-    const uint8_t PWM_RESOLUTION = 8;
+    const uint32_t PWM_FREQ;
+    const uint8_t PWM_RESOLUTION;
+    const uint32_t PWM_MAX_DUTY;
+    const MotorCalibration* calibration;   // nullptr = linear, no deadband
+
+    uint32_t speedToDuty(uint8_t speed);
+    void setState(MotorDirection dir, uint8_t speed);
 
 public:
-    L298NMotor(uint8_t in1, uint8_t in2, uint8_t en, uint8_t pwmChannel);
+    L298NMotor(uint8_t in1, uint8_t in2, uint8_t en, uint8_t pwmChannel,
+               const MotorCalibration* cal = nullptr,
+               uint32_t pwmFreq = MOTOR_PWM_FREQ, uint8_t pwmResolution = MOTOR_PWM_RESOLUTION);
     void begin();
+    void beginDeferred();          // Direction pins only - the enable pin is driven by MCPWM
     void forward(uint8_t speed);
     void backward(uint8_t speed);
     void stop();
     void brake();
+    void drive(int8_t speed);      // Signed: positive forward, negative backward
     uint8_t getCurrentSpeed();
+    uint32_t getCurrentDuty() { return currentDuty; }
+    uint32_t getMaxDuty() { return PWM_MAX_DUTY; }
+    MotorDirection getDirection() { return direction; }
+    uint8_t getIn1Pin() { return in1Pin; }
+    uint8_t getIn2Pin() { return in2Pin; }
+    uint8_t getEnPin() { return enPin; }
     void setSpeed(uint8_t speed);
+    void setCalibration(const MotorCalibration* cal) { calibration = cal; }
     bool isInitialized() { return initialized; }
 };
 
+/*
+    The controller owns all four motors and updates them together: the
+    enable pins run on MCPWM unit 0 (timers 0 and 1, synchronised), so new
+    duties latch on the same PWM period boundary, and all eight direction
+    pins change in a single GPIO register write. Group methods stage every
+    motor first and then call commit().
+
+    The direction pins are written at once but duties only latch at the next
+    period start, so the two can't land on the same boundary. Instead a
+    bridge's direction only changes once it has been off - zero duty latched
+    for a full period - so the new direction waits at zero duty and the new
+    state begins together with its duty at the period start after the write.
+*/
 class L298NController {
 private:
     L298NMotor* leftFrontMotor;
     L298NMotor* leftBackMotor;
     L298NMotor* rightFrontMotor;
     L298NMotor* rightBackMotor;
+    L298NMotor* motors[4];
+
+    bool initialized;
+    uint32_t directionMask;                // All IN pins
+    MotorDirection appliedDirection[4];
+    uint32_t appliedDuty[4];
+    bool directionHeld[4];                 // At zero duty, waiting to change direction
+    bool settling[4];                      // Zero duty written, maybe not latched yet
+    uint32_t settleDeadline[4];            // micros() when the zero has latched and the dead time passed
+
+    // Register masks for the interrupt-level brake (static - there is one controller)
+    static uint32_t isrInMask;
+    static uint32_t isrEnMask;
+    static uint8_t isrEnPins[4];
+    static volatile bool isrBraked;        // Outputs held in brake until released
+    static volatile bool isrDetached;      // Enable pins routed away from MCPWM
+    static portMUX_TYPE outputMux;         // Direction writes vs. the brake, across both cores
+
+    void attachEnables();
+    void writeDuties(const uint32_t duty[4]);
+    void writeDirections(const MotorDirection dir[4]);
+    void commit();
 
 public:
     L298NController();
@@ -56,6 +120,26 @@ public:
     
     void leftSideStop();
     void rightSideStop();
+
+    // Direct per-wheel drive, signed -100..100
+    void setWheels(int8_t leftFront, int8_t leftBack, int8_t rightFront, int8_t rightBack);
+
+    // A direction change spans cycles: zero duty first, the new direction on
+    // the first commit after it has latched plus the dead time. Call every
+    // control cycle so one completes even when no new command comes.
+    void update();
+    bool isHoldingDirection();
+
+    // Brake all four bridges with register writes only - safe from an ISR or any task.
+    // Outputs stay braked, ignoring commands, until releaseBrakeFromISR().
+    static void IRAM_ATTR brakeFromISR();
+    static void releaseBrakeFromISR() { isrBraked = false; }
+    static bool isBrakedFromISR() { return isrBraked; }
+
+    // Last committed outputs - duty in timer ticks out of getMaxDuty()
+    MotorDirection getAppliedDirection(uint8_t wheel) { return appliedDirection[wheel]; }
+    uint32_t getAppliedDuty(uint8_t wheel) { return appliedDuty[wheel]; }
+    uint32_t getMaxDuty() { return motors[0]->getMaxDuty(); }
     
     L298NMotor* getLeftFront() { return leftFrontMotor; }
     L298NMotor* getLeftBack() { return leftBackMotor; }
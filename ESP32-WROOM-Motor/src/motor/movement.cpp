@@ -1,8 +1,9 @@
 #include "movement.h"
 #include "config/debug.h"
 
-MovementController::MovementController(L298NController* motors) {
+MovementController::MovementController(L298NController* motors, MotionProfiler* motionProfiler) {
     motorController = motors;
+    profiler = motionProfiler;
     currentCommand = CMD_STOP;
     currentSpeed = 0;
     isMoving = false;
@@ -29,44 +30,19 @@ void MovementController::executeCommand(MotorCommand cmd, uint8_t speed) {
     
     switch (cmd) {
         case CMD_FORWARD:
-            moveForward(currentSpeed);
-            isMoving = true;
-            break;
-            
         case CMD_BACKWARD:
-            moveBackward(currentSpeed);
-            isMoving = true;
-            break;
-            
         case CMD_LEFT:
-            turnLeft(currentSpeed);
-            isMoving = true;
-            break;
-            
         case CMD_RIGHT:
-            turnRight(currentSpeed);
-            isMoving = true;
-            break;
-            
         case CMD_ROTATE_LEFT:
-            rotateLeft(currentSpeed);
-            isMoving = true;
-            break;
-            
         case CMD_ROTATE_RIGHT:
-            rotateRight(currentSpeed);
-            isMoving = true;
-            break;
-            
         case CMD_STRAFE_LEFT:
-            strafeLeft(currentSpeed);
-            isMoving = true;
-            break;
-            
-        case CMD_STRAFE_RIGHT:
-            strafeRight(currentSpeed);
-            isMoving = true;
+        case CMD_STRAFE_RIGHT: {
+            int8_t wheels[WHEEL_COUNT];
+            inverseKinematics(commandToBody(cmd, currentSpeed), 100, wheels);
+            driveWheels(wheels);
+            isMoving = (currentSpeed > 0);
             break;
+        }
             
         case CMD_STOP:
             stop();
@@ -82,76 +58,128 @@ void MovementController::executeCommand(MotorCommand cmd, uint8_t speed) {
     }
 }
 
-void MovementController::stop() {
-    if (motorController == nullptr) return;
-    
-    motorController->allStop();
+void MovementController::applyWheelSetpoint(const WheelSetpoint& setpoint) {
+    if (motorController == nullptr) {
+        DEBUG_PRINTLN("ERROR: Motor controller is null!");
+        return;
+    }
+
+    int8_t wheels[WHEEL_COUNT];
+    uint8_t peak = 0;
+    for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+        wheels[i] = constrain(setpoint.wheels[i], -100, 100);
+        uint8_t magnitude = abs(wheels[i]);
+        if (magnitude > peak) peak = magnitude;
+    }
+
+    driveWheels(wheels);
+
+    // No discrete manoeuvre applies - report the fastest wheel as the speed
     currentCommand = CMD_STOP;
-    currentSpeed = 0;
-    isMoving = false;
+    currentSpeed = peak;
+    isMoving = (peak > 0);
 }
 
-void MovementController::emergencyStop() {
-    if (motorController == nullptr) return;
-    
-    motorController->allBrake();
-    currentCommand = CMD_EMERGENCY_STOP;
-    currentSpeed = 0;
-    isMoving = false;
-}
+void MovementController::setBodyVelocity(float vx, float vy, float omega, uint8_t maxDuty) {
+    if (motorController == nullptr) {
+        DEBUG_PRINTLN("ERROR: Motor controller is null!");
+        return;
+    }
 
-void MovementController::moveForward(uint8_t speed) {
-    if (motorController == nullptr) return;
-    motorController->allForward(speed);
-}
+    int8_t wheels[WHEEL_COUNT];
+    inverseKinematics({vx, vy, omega}, maxDuty, wheels);
+    driveWheels(wheels);
 
-void MovementController::moveBackward(uint8_t speed) {
-    if (motorController == nullptr) return;
-    motorController->allBackward(speed);
-}
+    uint8_t peak = 0;
+    for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+        uint8_t magnitude = abs(wheels[i]);
+        if (magnitude > peak) peak = magnitude;
+    }
 
-void MovementController::turnLeft(uint8_t speed) {
-    if (motorController == nullptr) return;
-    
-    // Turn left by slowing down left motors - using integer math
-    uint8_t reducedSpeed = (speed * TURN_SPEED_RATIO) / 100;  // Left side at 30% speed
-    motorController->leftSideForward(reducedSpeed);
-    motorController->rightSideForward(speed);
+    currentCommand = CMD_STOP;
+    currentSpeed = peak;
+    isMoving = (peak > 0);
 }
 
-void MovementController::turnRight(uint8_t speed) {
-    if (motorController == nullptr) return;
-    
-    // Turn right by slowing down right motors - using integer math
-    uint8_t reducedSpeed = (speed * TURN_SPEED_RATIO) / 100;  // Right side at 30% speed
-    motorController->leftSideForward(speed);
-    motorController->rightSideForward(reducedSpeed);
+void MovementController::inverseKinematics(const BodyVelocity& body, uint8_t maxDuty, int8_t wheels[WHEEL_COUNT]) {
+    // Rollers at 45 deg, X configuration seen from above. Rotation is already
+    // given as rim speed, so the (lx + ly) wheelbase term is folded into omega.
+    float raw[WHEEL_COUNT];
+    raw[WHEEL_LEFT_FRONT]  = body.vx - body.vy - body.omega;
+    raw[WHEEL_LEFT_BACK]   = body.vx + body.vy - body.omega;
+    raw[WHEEL_RIGHT_FRONT] = body.vx + body.vy + body.omega;
+    raw[WHEEL_RIGHT_BACK]  = body.vx - body.vy + body.omega;
+
+    // Saturate by scaling every wheel by the same factor so the direction of
+    // travel is kept - clipping wheels one by one would bend the path
+    float limit = constrain(maxDuty, 0, 100);
+    float peak = 0.0f;
+    for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+        if (fabsf(raw[i]) > peak) peak = fabsf(raw[i]);
+    }
+    float scale = (peak > limit) ? limit / peak : 1.0f;
+
+    for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+        wheels[i] = (int8_t)lroundf(raw[i] * scale);
+    }
 }
 
-void MovementController::rotateLeft(uint8_t speed) {
-    if (motorController == nullptr) return;
-    
-    // Rotate in place - left motors backward, right motors forward
-    motorController->leftSideBackward(speed);
-    motorController->rightSideForward(speed);
+BodyVelocity MovementController::commandToBody(MotorCommand cmd, uint8_t speed) {
+    float s = speed;
+
+    // Arc turns keep the outer side at full speed and the inner side at
+    // TURN_SPEED_RATIO, i.e. vx +/- omega = s and s * ratio
+    float arcForward = s * (100 + TURN_SPEED_RATIO) / 200.0f;
+    float arcRotation = s * (100 - TURN_SPEED_RATIO) / 200.0f;
+
+    switch (cmd) {
+        case CMD_FORWARD:      return {s, 0, 0};
+        case CMD_BACKWARD:     return {-s, 0, 0};
+        case CMD_LEFT:         return {arcForward, 0, arcRotation};
+        case CMD_RIGHT:        return {arcForward, 0, -arcRotation};
+        case CMD_ROTATE_LEFT:  return {0, 0, s};
+        case CMD_ROTATE_RIGHT: return {0, 0, -s};
+        case CMD_STRAFE_LEFT:  return {0, s, 0};
+        case CMD_STRAFE_RIGHT: return {0, -s, 0};
+        default:               return {0, 0, 0};
+    }
 }
 
-void MovementController::rotateRight(uint8_t speed) {
+void MovementController::driveWheels(const int8_t wheels[WHEEL_COUNT]) {
     if (motorController == nullptr) return;
-    
-    // Rotate in place - left motors forward, right motors backward
-    motorController->leftSideForward(speed);
-    motorController->rightSideBackward(speed);
+
+    if (profiler != nullptr) {
+        profiler->setTargets(wheels);
+        return;
+    }
+    motorController->setWheels(wheels[WHEEL_LEFT_FRONT], wheels[WHEEL_LEFT_BACK],
+                               wheels[WHEEL_RIGHT_FRONT], wheels[WHEEL_RIGHT_BACK]);
 }
 
-void MovementController::strafeLeft(uint8_t speed) {
+void MovementController::stop() {
     if (motorController == nullptr) return;
-    motorController->strafeLeft(speed);
+    
+    if (profiler != nullptr) {
+        profiler->rampToStop();
+    } else {
+        motorController->allStop();
+    }
+    currentCommand = CMD_STOP;
+    currentSpeed = 0;
+    isMoving = false;
 }
 
-void MovementController::strafeRight(uint8_t speed) {
+void MovementController::emergencyStop() {
     if (motorController == nullptr) return;
-    motorController->strafeRight(speed);
+    
+    // Bypass the profiler - drop its state first so a pending tick can't undo the brake
+    if (profiler != nullptr) {
+        profiler->halt();
+    }
+    motorController->allBrake();
+    currentCommand = CMD_EMERGENCY_STOP;
+    currentSpeed = 0;
+    isMoving = false;
 }
 
 MotorCommand MovementController::getCurrentCommand() {
@@ -3,36 +3,49 @@
 
 #include <Arduino.h>
 #include "l298n.h"
+#include "profiler.h"
 #include "communication/uart.h"
 #include "config/constants.h"
 
+/*
+    Mecanum inverse kinematics, all values in % of full scale:
+      vx    - forward (+) / backward (-)
+      vy    - left (+) / right (-)
+      omega - counter-clockwise (+) / clockwise (-), as wheel speed at the rim
+*/
+struct BodyVelocity {
+    float vx;
+    float vy;
+    float omega;
+};
+
 class MovementController {
 private:
     L298NController* motorController;
+    MotionProfiler* profiler;         // Optional - wheels jump to their duty without it
     MotorCommand currentCommand;
     uint8_t currentSpeed;
     bool isMoving;
 
 public:
-    MovementController(L298NController* motors);
+    MovementController(L298NController* motors, MotionProfiler* motionProfiler = nullptr);
     void begin();
     void executeCommand(MotorCommand cmd, uint8_t speed);
-    void stop();
-    void emergencyStop();
+    void applyWheelSetpoint(const WheelSetpoint& setpoint);
+    void setBodyVelocity(float vx, float vy, float omega, uint8_t maxDuty = 100);
+    void stop();                      // Ramps down when a profiler is attached
+    void emergencyStop();             // Always brakes immediately
     
     MotorCommand getCurrentCommand();
     uint8_t getCurrentSpeed();
     bool getIsMoving();
 
+    // Wheel duty for a body velocity, scaled down as a whole if any wheel exceeds maxDuty
+    static void inverseKinematics(const BodyVelocity& body, uint8_t maxDuty, int8_t wheels[WHEEL_COUNT]);
+
 private:
-    void moveForward(uint8_t speed);
-    void moveBackward(uint8_t speed);
-    void turnLeft(uint8_t speed);
-    void turnRight(uint8_t speed);
-    void rotateLeft(uint8_t speed);
-    void rotateRight(uint8_t speed);
-    void strafeLeft(uint8_t speed);
-    void strafeRight(uint8_t speed);
+    BodyVelocity commandToBody(MotorCommand cmd, uint8_t speed);
+    void driveWheels(const int8_t wheels[WHEEL_COUNT]);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "profiler.h"
+#include "config/debug.h"
+
+MotionProfiler::MotionProfiler(L298NController* motors) {
+    motorController = motors;
+    lock = nullptr;
+    initialized = false;
+    halted = false;
+    maxAccel = PROFILE_MAX_ACCEL;
+    maxJerk = PROFILE_MAX_JERK;
+
+    for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+        target[i] = 0.0f;
+        velocity[i] = 0.0f;
+        accel[i] = 0.0f;
+        applied[i] = 0;
+    }
+}
+
+void MotionProfiler::begin() {
+    if (motorController == nullptr) {
+        DEBUG_PRINTLN("ERROR: Motor controller is null!");
+        return;
+    }
+
+    lock = xSemaphoreCreateMutex();
+    if (lock == nullptr) {
+        DEBUG_PRINTLN("ERROR: Motion profiler lock allocation failed");
+        return;
+    }
+
+    initialized = true;
+    DEBUG_PRINTLN("Motion Profiler Initialized");
+}
+
+void MotionProfiler::setTargets(const int8_t wheels[WHEEL_COUNT]) {
+    if (!initialized) {
+        // Not running - fall back to direct drive
+        motorController->setWheels(wheels[WHEEL_LEFT_FRONT], wheels[WHEEL_LEFT_BACK],
+                                   wheels[WHEEL_RIGHT_FRONT], wheels[WHEEL_RIGHT_BACK]);
+        return;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+        target[i] = constrain(wheels[i], -100, 100);
+    }
+    halted = false;
+    xSemaphoreGive(lock);
+}
+
+void MotionProfiler::rampToStop() {
+    const int8_t zero[WHEEL_COUNT] = {0, 0, 0, 0};
+    setTargets(zero);
+}
+
+void MotionProfiler::halt() {
+    if (!initialized) return;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+        target[i] = 0.0f;
+        velocity[i] = 0.0f;
+        accel[i] = 0.0f;
+        applied[i] = 0;
+    }
+    halted = true;
+    xSemaphoreGive(lock);
+}
+
+void MotionProfiler::setLimits(float accelLimit, float jerkLimit) {
+    if (accelLimit <= 0.0f || jerkLimit <= 0.0f) return;
+
+    if (lock) xSemaphoreTake(lock, portMAX_DELAY);
+    maxAccel = accelLimit;
+    maxJerk = jerkLimit;
+    if (lock) xSemaphoreGive(lock);
+}
+
+bool MotionProfiler::isSettled() {
+    for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+        if (velocity[i] != target[i]) return false;
+    }
+    return true;
+}
+
+void MotionProfiler::update() {
+    if (!initialized) return;
+
+    const float dt = CONTROL_PERIOD_US / 1000000.0f;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (halted) {
+        xSemaphoreGive(lock);
+        return;
+    }
+
+    bool changed = false;
+    for (uint8_t i = 0; i < WHEEL_COUNT; i++) {
+        int8_t duty = (int8_t)lroundf(stepWheel(i, dt));
+        if (duty != applied[i]) {
+            applied[i] = duty;
+            changed = true;
+        }
+    }
+
+    // Outputs are written under the lock so halt() always has the last word
+    if (changed) {
+        motorController->setWheels(applied[WHEEL_LEFT_FRONT], applied[WHEEL_LEFT_BACK],
+                                   applied[WHEEL_RIGHT_FRONT], applied[WHEEL_RIGHT_BACK]);
+    } else {
+        motorController->update();      // Finishes a direction change waiting for its zero duty to latch
+    }
+    xSemaphoreGive(lock);
+}
+
+float MotionProfiler::stepWheel(uint8_t wheel, float dt) {
+    float error = target[wheel] - velocity[wheel];
+    if (error == 0.0f) {
+        accel[wheel] = 0.0f;
+        return velocity[wheel];
+    }
+
+    // Largest acceleration that can still be wound back to zero by the time
+    // the target is reached under the jerk limit: v = a^2 / (2j)
+    float direction = (error > 0.0f) ? 1.0f : -1.0f;
+    float stoppable = sqrtf(2.0f * maxJerk * fabsf(error));
+    float desired = direction * min(maxAccel, stoppable);
+
+    float jerkStep = maxJerk * dt;
+    accel[wheel] += constrain(desired - accel[wheel], -jerkStep, jerkStep);
+    velocity[wheel] += accel[wheel] * dt;
+
+    // Snap once the target is reached or crossed
+    float remaining = target[wheel] - velocity[wheel];
+    if (remaining * direction <= 0.0f || fabsf(remaining) < 0.05f) {
+        velocity[wheel] = target[wheel];
+        accel[wheel] = 0.0f;
+    }
+
+    return velocity[wheel];
+}
@@ -0,0 +1,51 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+#include "l298n.h"
+#include "communication/uart.h"
+#include "config/constants.h"
+
+/*
+    Motion profiler, stepped once per control cycle (CONTROL_PERIOD_US).
+    Each wheel ramps from its current duty to its target with limited
+    acceleration and jerk (S-curve), so reversals and stops don't slam the
+    gearboxes or pull the battery down.
+
+    update() is the only writer of the motor outputs while the profiler is
+    running. halt() takes the same lock, so an emergency brake can't be
+    overwritten by a step that was already in flight.
+*/
+class MotionProfiler {
+private:
+    L298NController* motorController;
+
+    SemaphoreHandle_t lock;
+    bool initialized;
+    bool halted;                  // Braked - outputs are left alone until a new target
+
+    float target[WHEEL_COUNT];    // % duty, signed
+    float velocity[WHEEL_COUNT];  // % duty currently applied
+    float accel[WHEEL_COUNT];     // %/s
+    int8_t applied[WHEEL_COUNT];
+
+    float maxAccel;
+    float maxJerk;
+
+    float stepWheel(uint8_t wheel, float dt);
+
+public:
+    MotionProfiler(L298NController* motors);
+    void begin();
+    void update();                // One profile step - call every control cycle
+
+    void setTargets(const int8_t wheels[WHEEL_COUNT]);
+    void rampToStop();
+    void halt();                  // Drop all profile state - the caller brakes the motors
+
+    void setLimits(float accel, float jerk);
+    bool isSettled();
+    int8_t getApplied(uint8_t wheel) { return applied[wheel]; }
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "segment_player.h"
+#include "config/debug.h"
+
+SegmentPlayer::SegmentPlayer(MovementController* m, SpeedController* s, UARTProtocol* u) {
+    movement = m;
+    speed = s;
+    uart = u;
+    list.seq = 0;
+    list.count = 0;
+    active = false;
+    current = 0;
+    playStart = 0;
+    segmentEnd = 0;
+}
+
+bool SegmentPlayer::validate(const SegmentList& segments) {
+    if (segments.count == 0 || segments.count > MAX_MOTION_SEGMENTS) return false;
+
+    for (uint8_t i = 0; i < segments.count; i++) {
+        const MotionSegment& segment = segments.segments[i];
+        if (segment.durationMs > SEGMENT_MAX_DURATION_MS) return false;
+
+        if (segment.kind == SEGMENT_COMMAND) {
+            // An e-stop has its own frame - it must never wait in a list
+            if (segment.command.cmd >= CMD_EMERGENCY_STOP) return false;
+        } else if (segment.kind != SEGMENT_VELOCITY) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SegmentPlayer::load(const SegmentList& segments, int64_t now) {
+    if (!validate(segments)) {
+        DEBUG_PRINTLN("Segment list rejected");
+        reject(segments.seq);
+        return false;
+    }
+
+    if (active) {
+        finish(SEGMENT_ABORTED, now);
+    }
+
+    list = segments;
+    active = true;
+    playStart = now;
+    segmentEnd = now;
+    current = 0;
+    startSegment(0);
+
+    DEBUG_PRINT("Maneuver #");
+    DEBUG_PRINT(list.seq);
+    DEBUG_PRINT(": ");
+    DEBUG_PRINT(list.count);
+    DEBUG_PRINTLN(" segments");
+
+    // Zero-length segments are skipped right away
+    update(now);
+    return true;
+}
+
+void SegmentPlayer::startSegment(uint8_t index) {
+    const MotionSegment& segment = list.segments[index];
+    current = index;
+    segmentEnd += (int64_t)segment.durationMs * 1000;
+
+    // Same speed limits as the streamed frames
+    if (segment.kind == SEGMENT_COMMAND) {
+        movement->executeCommand(segment.command.cmd, speed->applySpeedLimit(segment.command.speed));
+    } else {
+        movement->setBodyVelocity(segment.velocity.vx, segment.velocity.vy, segment.velocity.omega,
+                                  speed->getMaxSpeed());
+    }
+}
+
+void SegmentPlayer::update(int64_t now) {
+    if (!active) return;
+
+    while (now >= segmentEnd) {
+        if (current + 1 >= list.count) {
+            movement->stop();
+            finish(SEGMENT_DONE, now);
+            return;
+        }
+        startSegment(current + 1);
+    }
+}
+
+void SegmentPlayer::abort(int64_t now) {
+    if (!active) return;
+    DEBUG_PRINTLN("Maneuver aborted");
+    finish(SEGMENT_ABORTED, now);
+}
+
+void SegmentPlayer::reject(uint8_t seq) {
+    SegmentStatus status = {seq, SEGMENT_REJECTED, 0, 0};
+    uart->sendSegmentStatus(status);
+}
+
+void SegmentPlayer::finish(SegmentState state, int64_t now) {
+    active = false;
+
+    SegmentStatus status;
+    status.seq = list.seq;
+    status.state = state;
+    status.index = current;
+    status.elapsedMs = (uint16_t)min((now - playStart) / 1000, (int64_t)UINT16_MAX);
+    uart->sendSegmentStatus(status);
+}
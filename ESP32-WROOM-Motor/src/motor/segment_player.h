@@ -0,0 +1,47 @@
+#ifndef SEGMENT_PLAYER_H
+#define SEGMENT_PLAYER_H
+
+#include <Arduino.h>
+#include "movement.h"
+#include "speed.h"
+#include "communication/uart.h"
+#include "config/constants.h"
+
+/*
+    Plays back a maneuver uploaded by the S3 as a list of timed segments
+    ("strafe left for 400 ms, then rotate for 250 ms"). Stepped from the
+    control cycle, so segment boundaries land within one CONTROL_PERIOD_US
+    and don't depend on the S3 resending anything. Boundaries are taken from
+    the start of playback, so rounding doesn't accumulate over the list.
+
+    Every maneuver ends with exactly one SegmentStatus frame to the S3.
+*/
+class SegmentPlayer {
+private:
+    MovementController* movement;
+    SpeedController* speed;
+    UARTProtocol* uart;
+
+    SegmentList list;
+    bool active;
+    uint8_t current;
+    int64_t playStart;            // esp_timer time playback started
+    int64_t segmentEnd;           // esp_timer time the current segment ends
+
+    bool validate(const SegmentList& segments);
+    void startSegment(uint8_t index);
+    void finish(SegmentState state, int64_t now);
+
+public:
+    SegmentPlayer(MovementController* m, SpeedController* s, UARTProtocol* u);
+
+    // Replaces (and reports as aborted) anything still playing
+    bool load(const SegmentList& segments, int64_t now);
+    void update(int64_t now);     // Call every control cycle
+    void abort(int64_t now);      // Leaves the outputs to the caller
+    void reject(uint8_t seq);
+
+    bool isActive() { return active; }
+};
+
+#endif
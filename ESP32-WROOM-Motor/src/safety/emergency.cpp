@@ -1,5 +1,7 @@
 #include "emergency.h"
 #include "../config/debug.h"
+#include "esp_timer.h"
+#include "hal/cpu_hal.h"
 
 EmergencyStop* EmergencyStop::instance = nullptr;
 
@@ -11,6 +13,10 @@ EmergencyStop::EmergencyStop(uint8_t pin, MovementController* movement) : deboun
     lastDebounceTime = 0;
     interruptTriggered = false;
     lastSource = NONE;
+    isrTime = 0;
+    isrBrakeCycles = 0;
+    isrEvents = 0;
+    stats = {0, 0, 0, 0, 0};
     instance = this;
 }
 
@@ -25,21 +31,49 @@ void EmergencyStop::begin() {
 }
 
 void IRAM_ATTR EmergencyStop::handleInterrupt() {
-    if (instance != nullptr) {
-        instance->interruptTriggered = true;
-    }
+    if (instance == nullptr) return;
+
+    // Brake first, think later - debounce and toggle run in the control task
+    uint32_t start = cpu_hal_get_cycle_count();
+    L298NController::brakeFromISR();
+    instance->isrBrakeCycles = cpu_hal_get_cycle_count() - start;
+
+    instance->isrTime = esp_timer_get_time();
+    instance->isrEvents++;
+    instance->interruptTriggered = true;
 }
 
 void EmergencyStop::update() {
     // Check if interrupt was triggered
     if (interruptTriggered) {
         interruptTriggered = false;
+
+        uint32_t handled = (uint32_t)(esp_timer_get_time() - isrTime);
+        stats.events = isrEvents;
+        stats.lastBrakeNs = (uint32_t)((uint64_t)isrBrakeCycles * 1000 / ESP.getCpuFreqMHz());
+        if (stats.lastBrakeNs > stats.maxBrakeNs) stats.maxBrakeNs = stats.lastBrakeNs;
+        stats.lastHandledUs = handled;
+        if (handled > stats.maxHandledUs) stats.maxHandledUs = handled;
         
         // Debounce check
         if ((millis() - lastDebounceTime) > debounceDelay) {
             lastDebounceTime = millis();
             toggle(BUTTON);
         }
+
+        // The ISR brakes on every press. If the press left the e-stop
+        // inactive (release or bounce), drop the motion state so nothing
+        // resumes at the old duty, then hand the outputs back.
+        if (!emergencyActive) {
+            movementController->emergencyStop();
+            L298NController::releaseBrakeFromISR();
+        }
+
+        DEBUG_PRINT("E-stop ISR brake: ");
+        DEBUG_PRINT(stats.lastBrakeNs);
+        DEBUG_PRINT(" ns | handled after ");
+        DEBUG_PRINT(handled);
+        DEBUG_PRINTLN(" us");
     }
 }
 
@@ -83,6 +117,7 @@ void EmergencyStop::toggle(EmergencySource source) {
         // Deactivate emergency
         emergencyActive = false;
         lastSource = NONE;
+        L298NController::releaseBrakeFromISR();
         DEBUG_PRINTLN("✓ Emergency Stop DEACTIVATED");
     } else {
         // Activate emergency
@@ -93,6 +128,7 @@ void EmergencyStop::toggle(EmergencySource source) {
 void EmergencyStop::reset() {
     emergencyActive = false;
     lastSource = NONE;
+    L298NController::releaseBrakeFromISR();
     DEBUG_PRINTLN("Emergency Stop Reset");
 }
 
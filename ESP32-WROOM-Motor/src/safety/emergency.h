@@ -11,6 +11,14 @@ enum EmergencySource {
     UART
 };
 
+struct EmergencyStats {
+    uint32_t events;            // Button interrupts
+    uint32_t lastBrakeNs;       // ISR entry -> bridges braked
+    uint32_t maxBrakeNs;
+    uint32_t lastHandledUs;     // ISR entry -> e-stop logic ran in the control task
+    uint32_t maxHandledUs;
+};
+
 class EmergencyStop {
 private:
     uint8_t buttonPin;
@@ -23,6 +31,12 @@ private:
     
     volatile bool interruptTriggered;
     EmergencySource lastSource;
+
+    // Written by the ISR
+    volatile int64_t isrTime;
+    volatile uint32_t isrBrakeCycles;
+    volatile uint32_t isrEvents;
+    EmergencyStats stats;
     
     static EmergencyStop* instance;
     static void IRAM_ATTR handleInterrupt();
@@ -42,6 +56,7 @@ public:
     bool isTriggeredByUART();
     
     bool checkButton();
+    EmergencyStats getStats() { return stats; }
 };
 
 #endif
\ No newline at end of file
@@ -78,21 +78,30 @@ void setup() {
 
 void loop() {
     emergencyStop.update();
+    motorController.update();      // Completes held direction changes
     
     // Receive UART commands
-    MotorCommand cmd;
-    uint8_t speed;
+    PacketId packet = uart.receivePacket();
     
-    if (uart.receiveMotorCommand(cmd, speed)) {
+    if (packet == PACKET_MOTOR_COMMAND) {
         lastCommandTime = millis();
         commandCount++;
+        MotorCommand cmd = uart.getReceivedCommand();
+        uint8_t speed = uart.getReceivedSpeed();
         
         if (cmd == CMD_EMERGENCY_STOP) {
-            emergencyStop.activate();
+            emergencyStop.activate(UART);
         } else if (!emergencyStop.isEmergencyActive()) {
             uint8_t adjustedSpeed = speedController.applySpeedLimit(speed);
             movementController.executeCommand(cmd, adjustedSpeed);
         }
+    } else if (packet == PACKET_WHEEL_SETPOINT) {
+        lastCommandTime = millis();
+        commandCount++;
+        
+        if (!emergencyStop.isEmergencyActive()) {
+            movementController.applyWheelSetpoint(uart.getReceivedSetpoint());
+        }
     }
     
     // Print diagnostics every 5 seconds
@@ -50,6 +50,7 @@ uint8_t currentSpeed = 50;  // Default 50%
 
 void loop() {
     emergencyStop.update();
+    motorController.update();      // Completes held direction changes
     
     if (Serial.available()) {
         char cmd = Serial.read();
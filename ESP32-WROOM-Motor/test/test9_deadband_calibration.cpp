@@ -0,0 +1,177 @@
+#include <Arduino.h>
+#include "motor/l298n.h"
+#include "config/pins.h"
+#include "config/constants.h"
+
+// Uncalibrated motors - duty is driven raw so the deadband can be measured
+L298NMotor motors[] = {
+    L298NMotor(LEFT_FRONT_IN1, LEFT_FRONT_IN2, LEFT_FRONT_ENA, 0),
+    L298NMotor(LEFT_BACK_IN1, LEFT_BACK_IN2, LEFT_BACK_ENB, 1),
+    L298NMotor(RIGHT_FRONT_IN1, RIGHT_FRONT_IN2, RIGHT_FRONT_ENA, 2),
+    L298NMotor(RIGHT_BACK_IN1, RIGHT_BACK_IN2, RIGHT_BACK_ENB, 3)
+};
+
+const char* motorNames[] = {"LEFT_FRONT", "LEFT_BACK", "RIGHT_FRONT", "RIGHT_BACK"};
+
+uint8_t selected = 0;
+uint8_t dutyPercent = 0;
+bool reverse = false;
+
+// Wheel speed from taps - 't' each time a mark on the wheel passes a fixed point
+#define MAX_TAPS 8
+unsigned long taps[MAX_TAPS];
+uint8_t tapCount = 0;
+
+float topSpeed[4] = {0, 0, 0, 0};               // rev/s at 100 %, from 'f'
+int16_t table[4][MOTOR_CAL_POINTS];             // per mille, -1 = not measured yet
+
+void printMenu() {
+    Serial.println("\n========================================");
+    Serial.println("      Motor Deadband Calibration");
+    Serial.println("========================================");
+    Serial.printf("PWM: %d Hz, %d bit\n", MOTOR_PWM_FREQ, MOTOR_PWM_RESOLUTION);
+    Serial.println("Commands:");
+    Serial.println("  1-4 - Select motor (LF, LB, RF, RB)");
+    Serial.println("  +/- - Duty up/down by 1%");
+    Serial.println("  r   - Toggle direction");
+    Serial.println("  t   - Tap as the wheel mark passes (speed from the taps)");
+    Serial.println("  f   - Take the tapped speed as top speed (at 100%)");
+    Serial.println("  m   - Mark this duty as the nearest 10% speed point");
+    Serial.println("        (no taps yet = breakaway, entry 0)");
+    Serial.println("  p   - Print the table for config/calibration.h");
+    Serial.println("  x   - STOP");
+    Serial.println("========================================");
+    Serial.println("Per motor, under load:");
+    Serial.println(" 1. Raise the duty until the wheel keeps turning, press 'm'.");
+    Serial.println(" 2. At 100%, tap 't' for a few turns, press 'f'.");
+    Serial.println(" 3. For each 10% point, set the duty so the tapped speed is");
+    Serial.println("    close to it, then press 'm'. 'p' prints the result.\n");
+}
+
+float tappedSpeed() {
+    if (tapCount < 2) return 0;
+    uint8_t first = (tapCount > MAX_TAPS) ? tapCount - MAX_TAPS : 0;
+    unsigned long span = taps[(tapCount - 1) % MAX_TAPS] - taps[first % MAX_TAPS];
+    return span ? (tapCount - 1 - first) * 1000.0f / span : 0;
+}
+
+void tap() {
+    taps[tapCount % MAX_TAPS] = millis();
+    tapCount++;
+    if (tapCount < 2) return;
+
+    float speed = tappedSpeed();
+    Serial.printf("%.2f rev/s", speed);
+    if (topSpeed[selected] > 0) Serial.printf(" = %.0f%% of top", speed * 100 / topSpeed[selected]);
+    Serial.println();
+}
+
+void mark() {
+    uint8_t point = 0;
+    if (tapCount >= 2) {
+        if (topSpeed[selected] <= 0) {
+            Serial.println("Measure the top speed first ('f' at 100%)");
+            return;
+        }
+        point = constrain((int)(tappedSpeed() * 10 / topSpeed[selected] + 0.5f), 1, MOTOR_CAL_POINTS - 1);
+    }
+    table[selected][point] = dutyPercent * 10;
+    Serial.printf(">>> %s %d%% speed: %d per mille\n", motorNames[selected], point * 10, dutyPercent * 10);
+}
+
+void printTable() {
+    Serial.printf("%s: {{", motorNames[selected]);
+    for (uint8_t i = 0; i < MOTOR_CAL_POINTS; i++) {
+        if (table[selected][i] < 0) Serial.print("?");
+        else Serial.print(table[selected][i]);
+        if (i < MOTOR_CAL_POINTS - 1) Serial.print(", ");
+    }
+    Serial.println("}}");
+}
+
+void applyDuty() {
+    if (dutyPercent == 0) {
+        motors[selected].stop();
+    } else if (reverse) {
+        motors[selected].backward(dutyPercent);
+    } else {
+        motors[selected].forward(dutyPercent);
+    }
+
+    tapCount = 0;                               // Speed changes, old taps don't count
+    Serial.printf("%s %s: %d%% (%u / %u)\n", motorNames[selected], reverse ? "REV" : "FWD",
+                  dutyPercent, motors[selected].getCurrentDuty(), motors[selected].getMaxDuty());
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(2000);
+
+    for (uint8_t i = 0; i < 4; i++) {
+        motors[i].begin();
+        for (uint8_t j = 0; j < MOTOR_CAL_POINTS; j++) table[i][j] = -1;
+    }
+
+    printMenu();
+}
+
+void loop() {
+    if (!Serial.available()) return;
+
+    char cmd = Serial.read();
+    switch (cmd) {
+        case '1': case '2': case '3': case '4':
+            motors[selected].stop();
+            selected = cmd - '1';
+            dutyPercent = 0;
+            tapCount = 0;
+            Serial.printf("Selected %s\n", motorNames[selected]);
+            break;
+
+        case '+':
+            if (dutyPercent < 100) dutyPercent++;
+            applyDuty();
+            break;
+
+        case '-':
+            if (dutyPercent > 0) dutyPercent--;
+            applyDuty();
+            break;
+
+        case 'r':
+            reverse = !reverse;
+            applyDuty();
+            break;
+
+        case 't':
+            tap();
+            break;
+
+        case 'f':
+            if (dutyPercent != 100 || tapCount < 2) {
+                Serial.println("Tap at 100% first");
+                break;
+            }
+            topSpeed[selected] = tappedSpeed();
+            table[selected][MOTOR_CAL_POINTS - 1] = 1000;
+            Serial.printf(">>> %s top speed: %.2f rev/s\n", motorNames[selected], topSpeed[selected]);
+            break;
+
+        case 'm':
+            mark();
+            break;
+
+        case 'p':
+            printTable();
+            break;
+
+        case 'x':
+            dutyPercent = 0;
+            applyDuty();
+            break;
+
+        case 'h':
+            printMenu();
+            break;
+    }
+}
@@ -0,0 +1,84 @@
+// Encode/decode throughput of the shared wire protocol on the host.
+// Useful for comparing layouts and decoder changes, not as absolute board timings.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "synapse_protocol.h"
+
+static uint8_t frame[PROTOCOL_MAX_PAYLOAD];
+static volatile uint32_t sink;
+
+template <typename Fn>
+static void run(const char* name, uint32_t iterations, uint8_t bytes, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        fn(i);
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double perSecond = iterations / elapsed;
+    printf("%-28s %7.1f Mmsg/s  %8.1f MB/s  %6.2f ns/msg\n", name, perSecond / 1e6,
+           perSecond * bytes / 1e6, elapsed * 1e9 / iterations);
+}
+
+int main(int argc, char** argv) {
+    uint32_t iterations = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 20000000;
+    printf("SynapseProtocol v%u, %u iterations\n\n", PROTOCOL_VERSION, iterations);
+
+    run("encode WheelSetpoint", iterations, sizeof(WheelSetpoint), [](uint32_t i) {
+        WheelSetpoint* setpoint = beginMessage<WheelSetpoint>(frame);
+        setpoint->seq = (uint8_t)i;
+        for (uint8_t w = 0; w < WHEEL_COUNT; w++) setpoint->wheels[w] = (int8_t)(i + w);
+        sink += messageLength(*setpoint);
+    });
+
+    run("encode MotorStatus (copy)", iterations, sizeof(MotorStatus), [](uint32_t i) {
+        MotorStatus status = {};
+        status.seq = (uint8_t)i;
+        status.timeouts = (uint16_t)i;
+        sink += encodeMessage(frame, status);
+    });
+
+    run("encode SegmentList x8", iterations, sizeof(SegmentList), [](uint32_t i) {
+        SegmentList* list = beginMessage<SegmentList>(frame);
+        list->seq = (uint8_t)i;
+        list->count = MAX_MOTION_SEGMENTS;
+        for (uint8_t s = 0; s < MAX_MOTION_SEGMENTS; s++) {
+            list->segments[s] = velocitySegment((int8_t)s, 0, (int8_t)i, 500);
+        }
+        sink += messageLength(*list);
+    });
+
+    WheelSetpoint setpoint = {7, {10, -10, 20, -20}};
+    encodeMessage(frame, setpoint);
+    run("decode WheelSetpoint", iterations, sizeof(WheelSetpoint), [](uint32_t) {
+        if (decodeMessage(TO_MOTOR, PACKET_WHEEL_SETPOINT, frame, sizeof(WheelSetpoint)) == DECODE_OK) {
+            sink += viewMessage<WheelSetpoint>(frame)->wheels[WHEEL_RIGHT_BACK];
+        }
+    });
+
+    SegmentList list;
+    list.seq = 1;
+    list.count = MAX_MOTION_SEGMENTS;
+    for (uint8_t s = 0; s < MAX_MOTION_SEGMENTS; s++) {
+        list.segments[s] = (s & 1) ? velocitySegment(50, 0, 0, 1000) : commandSegment(CMD_FORWARD, 40, 1000);
+    }
+    uint8_t listLength = encodeMessage(frame, list);
+    run("decode SegmentList x8", iterations, listLength, [listLength](uint32_t) {
+        if (decodeMessage(TO_MOTOR, PACKET_SEGMENT_LIST, frame, listLength) == DECODE_OK) {
+            sink += viewMessage<SegmentList>(frame)->segments[7].durationMs;
+        }
+    });
+
+    MotorStatus status = {};
+    status.frameErrors = 3;
+    encodeMessage(frame, status);
+    run("decode MotorStatus", iterations, sizeof(MotorStatus), [](uint32_t) {
+        if (decodeMessage(TO_MAIN, PACKET_MOTOR_STATUS, frame, sizeof(MotorStatus)) == DECODE_OK) {
+            sink += viewMessage<MotorStatus>(frame)->frameErrors;
+        }
+    });
+
+    return 0;
+}
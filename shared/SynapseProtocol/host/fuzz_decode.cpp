@@ -0,0 +1,158 @@
+// Fuzz target for the frame decoder. Input byte 0 picks the direction and the
+// packet ID, the rest is the payload. Anything decodeMessage() accepts is then
+// read through its view, so a length check that is too loose shows up under ASan.
+//
+// With libFuzzer:  cmake -DCMAKE_CXX_COMPILER=clang++ -DSYNAPSE_LIBFUZZER=ON ...
+// Without it, main() below feeds random and mutated frames: fuzz_decode [iterations] [seed]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "synapse_protocol.h"
+
+static volatile uint32_t sink;
+
+// Touches every byte a board would read after a successful decode
+static void consume(LinkDirection direction, uint8_t packet, const uint8_t* buffer, uint8_t length) {
+    switch (packet) {
+        case PACKET_MOTOR_COMMAND: {
+            const MotorCommandFrame* command = viewMessage<MotorCommandFrame>(buffer);
+            sink += command->cmd + command->speed;
+            if (length >= sizeof(MotorCommandFrame)) sink += command->seq;
+            break;
+        }
+        case PACKET_WHEEL_SETPOINT:
+            if (direction == TO_MOTOR) {
+                for (uint8_t i = 0; i < WHEEL_COUNT; i++) sink += viewMessage<WheelSetpoint>(buffer)->wheels[i];
+            } else {
+                sink += viewMessage<FrameAck>(buffer)->seq;
+            }
+            break;
+        case PACKET_BODY_VELOCITY:
+            if (direction == TO_MOTOR) sink += viewMessage<BodyVelocitySetpoint>(buffer)->omega;
+            else sink += viewMessage<FrameAck>(buffer)->seq;
+            break;
+        case PACKET_SEGMENT_LIST:
+            if (direction == TO_MOTOR) {
+                const SegmentList* list = viewMessage<SegmentList>(buffer);
+                for (uint8_t i = 0; i < list->count; i++) {
+                    sink += list->segments[i].kind + list->segments[i].durationMs;
+                }
+            } else {
+                sink += viewMessage<FrameAck>(buffer)->seq;
+            }
+            break;
+        case PACKET_SEGMENT_STATUS:
+            sink += viewMessage<SegmentStatus>(buffer)->elapsedMs;
+            break;
+        case PACKET_HEARTBEAT:
+            sink += viewMessage<Heartbeat>(buffer)->seq;
+            break;
+        case PACKET_STATUS_POLL:
+            sink += viewMessage<StatusPoll>(buffer)->seq;
+            break;
+        case PACKET_BAUD_PROPOSE:
+            sink += viewMessage<BaudProposal>(buffer)->baud;
+            break;
+        case PACKET_LINK_TEST:
+            sink += viewMessage<LinkTestFrame>(buffer)->pattern[LINK_TEST_PATTERN_LEN - 1];
+            break;
+        case PACKET_MOTOR_STATUS:
+            sink += viewMessage<MotorStatus>(buffer)->appliedSeq;
+            break;
+        case PACKET_EMERGENCY_STOP:
+            sink += viewMessage<EmergencyFrame>(buffer)->decisionUs;
+            break;
+        case PACKET_TIME_SYNC:
+            sink += viewMessage<TimeSyncFrame>(buffer)->motorTxUs;
+            break;
+        default:
+            // decodeMessage() accepted an ID it doesn't know
+            abort();
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size < 1) return 0;
+
+    LinkDirection direction = (data[0] & 0x80) ? TO_MAIN : TO_MOTOR;
+    uint8_t packet = data[0] & 0x7F;
+    uint8_t length = (uint8_t)((size - 1 > PROTOCOL_MAX_PAYLOAD) ? PROTOCOL_MAX_PAYLOAD : size - 1);
+
+    // Exact-size heap copy so ASan catches any read past the received bytes
+    uint8_t* payload = (uint8_t*)malloc(length ? length : 1);
+    memcpy(payload, data + 1, length);
+
+    if (decodeMessage(direction, packet, payload, length) == DECODE_OK) {
+        consume(direction, packet, payload, length);
+    }
+    free(payload);
+    return 0;
+}
+
+#ifdef SYNAPSE_FUZZ_STANDALONE
+
+static uint32_t rngState;
+
+static uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+// Well-formed frames of every type, so mutations start close to the valid edge
+static size_t seedFrame(uint8_t* out) {
+    uint8_t packet = nextRandom() % PACKET_COUNT;
+    bool toMain = nextRandom() & 1;
+    out[0] = packet | (toMain ? 0x80 : 0);
+
+    size_t length;
+    if (packet == PACKET_SEGMENT_LIST && !toMain) {
+        SegmentList list;
+        list.seq = nextRandom();
+        list.count = nextRandom() % (MAX_MOTION_SEGMENTS + 1);
+        for (uint8_t i = 0; i < list.count; i++) {
+            list.segments[i] = (nextRandom() & 1) ? commandSegment((MotorCommand)(nextRandom() % 10), 50, 100)
+                                                  : velocitySegment(10, 20, 30, 100);
+        }
+        length = encodeMessage(out + 1, list);
+    } else {
+        length = nextRandom() % (sizeof(MotorStatus) + 2);
+        for (size_t i = 0; i < length; i++) out[1 + i] = nextRandom();
+    }
+
+    // A few bit flips, truncations and extensions
+    uint8_t mutations = nextRandom() % 4;
+    for (uint8_t m = 0; m < mutations; m++) {
+        switch (nextRandom() % 3) {
+            case 0: if (length) out[1 + nextRandom() % length] ^= 1 << (nextRandom() % 8); break;
+            case 1: if (length) length = nextRandom() % length; break;
+            case 2: if (length < PROTOCOL_MAX_PAYLOAD) out[1 + length++] = nextRandom(); break;
+        }
+    }
+    return 1 + length;
+}
+
+int main(int argc, char** argv) {
+    uint32_t iterations = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 1000000;
+    rngState = (argc > 2) ? strtoul(argv[2], nullptr, 10) : 0x5EED1234;
+    if (rngState == 0) rngState = 1;
+
+    uint8_t input[1 + PROTOCOL_MAX_PAYLOAD];
+    for (uint32_t i = 0; i < iterations; i++) {
+        size_t size;
+        if (i & 1) {
+            size = seedFrame(input);
+        } else {
+            size = nextRandom() % sizeof(input);
+            for (size_t b = 0; b < size; b++) input[b] = nextRandom();
+        }
+        LLVMFuzzerTestOneInput(input, size);
+    }
+
+    printf("fuzz_decode: %u inputs, no faults\n", iterations);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,116 @@
+#include "synapse_protocol.h"
+
+static bool validCommand(uint8_t cmd) {
+    return cmd <= CMD_EMERGENCY_STOP;
+}
+
+static DecodeResult decodeSegmentList(const uint8_t* buffer, uint8_t length) {
+    if (length < offsetof(SegmentList, segments)) return DECODE_SHORT;
+
+    // Header first, then exactly the segments that were sent
+    const SegmentList* list = viewMessage<SegmentList>(buffer);
+    if (list->count > MAX_MOTION_SEGMENTS) return DECODE_BAD_FIELD;
+    if (length < messageLength(*list)) return DECODE_SHORT;
+
+    for (uint8_t i = 0; i < list->count; i++) {
+        const MotionSegment& segment = list->segments[i];
+        if (segment.kind == SEGMENT_COMMAND) {
+            if (!validCommand(segment.command.cmd)) return DECODE_BAD_FIELD;
+        } else if (segment.kind != SEGMENT_VELOCITY) {
+            return DECODE_BAD_FIELD;
+        }
+    }
+    return DECODE_OK;
+}
+
+static DecodeResult decodeToMotor(uint8_t packet, const uint8_t* buffer, uint8_t length) {
+    switch (packet) {
+        case PACKET_MOTOR_COMMAND:
+            if (length < MOTOR_COMMAND_LEGACY_LEN) return DECODE_SHORT;
+            return validCommand(buffer[0]) ? DECODE_OK : DECODE_BAD_FIELD;
+
+        case PACKET_WHEEL_SETPOINT:
+            return length < sizeof(WheelSetpoint) ? DECODE_SHORT : DECODE_OK;
+
+        case PACKET_BODY_VELOCITY:
+            return length < sizeof(BodyVelocitySetpoint) ? DECODE_SHORT : DECODE_OK;
+
+        case PACKET_SEGMENT_LIST:
+            return decodeSegmentList(buffer, length);
+
+        case PACKET_HEARTBEAT:
+            return length < sizeof(Heartbeat) ? DECODE_SHORT : DECODE_OK;
+
+        case PACKET_STATUS_POLL:
+            return length < sizeof(StatusPoll) ? DECODE_SHORT : DECODE_OK;
+
+        case PACKET_BAUD_PROPOSE:
+            return length < sizeof(BaudProposal) ? DECODE_SHORT : DECODE_OK;
+
+        case PACKET_LINK_TEST:
+            return length < sizeof(LinkTestFrame) ? DECODE_SHORT : DECODE_OK;
+
+        case PACKET_EMERGENCY_STOP:
+            return length < sizeof(EmergencyFrame) ? DECODE_SHORT : DECODE_OK;
+
+        case PACKET_TIME_SYNC:
+            return length < sizeof(TimeSyncFrame) ? DECODE_SHORT : DECODE_OK;
+
+        default:
+            return DECODE_UNKNOWN_ID;
+    }
+}
+
+static DecodeResult decodeToMain(uint8_t packet, const uint8_t* buffer, uint8_t length) {
+    switch (packet) {
+        case PACKET_MOTOR_COMMAND:
+            // Echo of the command frame, legacy firmware leaves out the sequence number
+            if (length < MOTOR_COMMAND_LEGACY_LEN) return DECODE_SHORT;
+            return validCommand(buffer[0]) ? DECODE_OK : DECODE_BAD_FIELD;
+
+        case PACKET_WHEEL_SETPOINT:
+        case PACKET_BODY_VELOCITY:
+        case PACKET_SEGMENT_LIST:
+        case PACKET_HEARTBEAT:
+            return length < sizeof(FrameAck) ? DECODE_SHORT : DECODE_OK;
+
+        case PACKET_SEGMENT_STATUS:
+            if (length < sizeof(SegmentStatus)) return DECODE_SHORT;
+            return viewMessage<SegmentStatus>(buffer)->state <= SEGMENT_REJECTED ? DECODE_OK : DECODE_BAD_FIELD;
+
+        case PACKET_BAUD_PROPOSE:
+            return length < sizeof(BaudProposal) ? DECODE_SHORT : DECODE_OK;
+
+        case PACKET_LINK_TEST:
+            return length < sizeof(LinkTestFrame) ? DECODE_SHORT : DECODE_OK;
+
+        case PACKET_MOTOR_STATUS:
+            return length < sizeof(MotorStatus) ? DECODE_SHORT : DECODE_OK;
+
+        case PACKET_EMERGENCY_STOP:
+            return length < sizeof(EmergencyAck) ? DECODE_SHORT : DECODE_OK;
+
+        case PACKET_TIME_SYNC:
+            return length < sizeof(TimeSyncFrame) ? DECODE_SHORT : DECODE_OK;
+
+        default:
+            return DECODE_UNKNOWN_ID;
+    }
+}
+
+DecodeResult decodeMessage(LinkDirection direction, uint8_t packet, const uint8_t* buffer, uint8_t length) {
+    if (buffer == nullptr) return DECODE_SHORT;
+    if (packet >= PACKET_COUNT) return DECODE_UNKNOWN_ID;   // Strip the node with busPacket() first
+    return (direction == TO_MOTOR) ? decodeToMotor(packet, buffer, length)
+                                   : decodeToMain(packet, buffer, length);
+}
+
+const char* decodeResultName(DecodeResult result) {
+    switch (result) {
+        case DECODE_OK:         return "ok";
+        case DECODE_UNKNOWN_ID: return "unknown id";
+        case DECODE_SHORT:      return "short";
+        case DECODE_BAD_FIELD:  return "bad field";
+        default:                return "?";
+    }
+}
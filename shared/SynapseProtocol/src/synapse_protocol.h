@@ -0,0 +1,352 @@
+#ifndef SYNAPSE_PROTOCOL_H
+#define SYNAPSE_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <new>
+
+/*
+    Wire protocol between the S3 and the motor board, shared by both
+    firmwares and the host tools. Every message is a packed struct whose
+    layout is pinned by static_asserts below, so a change that would make
+    the two boards disagree fails the build instead of the link.
+
+    Messages are built and read directly in the SerialTransfer frame buffer
+    (packet.txBuff / packet.rxBuff): all types have an alignment of 1, so a
+    view into the buffer is as good as a copy. decodeMessage() must pass
+    before a received buffer is viewed.
+*/
+
+// Bumped whenever a layout below changes. Exchanged in the baud proposal -
+// a mismatched board keeps the link at the base rate and says so.
+constexpr uint8_t PROTOCOL_VERSION = 5;
+
+// SerialTransfer's MAX_PACKET_SIZE - every message has to fit one frame
+constexpr uint8_t PROTOCOL_MAX_PAYLOAD = 254;
+
+#define SYNAPSE_PACKED __attribute__((packed))
+
+enum MotorCommand : uint8_t {
+    CMD_STOP = 0,
+    CMD_FORWARD,
+    CMD_BACKWARD,
+    CMD_LEFT,
+    CMD_RIGHT,
+    CMD_ROTATE_LEFT,
+    CMD_ROTATE_RIGHT,
+    CMD_STRAFE_LEFT,
+    CMD_STRAFE_RIGHT,
+    CMD_EMERGENCY_STOP
+};
+
+// SerialTransfer packet IDs - ID 0 is the original {cmd, speed} frame, now followed by
+// a sequence number; every ack echoes the sequence number of the frame it confirms.
+// On the wire the low nibble is the PacketId and the high nibble the bus node.
+enum PacketId : uint8_t {
+    PACKET_MOTOR_COMMAND = 0,
+    PACKET_WHEEL_SETPOINT,
+    PACKET_BODY_VELOCITY,
+    PACKET_SEGMENT_LIST,        // S3 -> WROOM: timed maneuver, played back locally
+    PACKET_SEGMENT_STATUS,      // WROOM -> S3: maneuver finished, aborted or rejected
+    PACKET_HEARTBEAT,           // S3 -> WROOM: keeps the last command alive, echoed back
+    PACKET_BAUD_PROPOSE,        // S3 -> WROOM: switch to a faster rate, answered at the old one
+    PACKET_LINK_TEST,           // S3 -> WROOM: test pattern, echoed back verbatim
+    PACKET_MOTOR_STATUS,        // WROOM -> S3: periodic motor board state, not acked
+    PACKET_EMERGENCY_STOP,      // S3 -> WROOM: e-stop lane, sent in redundant copies; acked with EmergencyAck
+    PACKET_TIME_SYNC,           // S3 -> WROOM: clock probe, returned with the WROOM's timestamps
+    PACKET_STATUS_POLL,         // S3 -> node: answered with a MotorStatus carrying the poll's seq
+    PACKET_COUNT,
+    PACKET_NONE = 0xFF
+};
+
+static_assert(PACKET_COUNT <= 16, "Packet IDs share the frame ID byte with the node address");
+
+// Motor bus addressing. The S3's UART TX fans out to every node; node replies
+// share one return line, so a node only transmits when addressed and the S3
+// waits for each reply before addressing the next node. Node 0 is the
+// original drive board and keeps the plain packet IDs. Broadcast frames are
+// acted on by every node and never answered.
+constexpr uint8_t NODE_PRIMARY = 0;
+constexpr uint8_t NODE_BROADCAST = 0x0F;
+constexpr uint8_t MAX_BUS_NODE = 0x0E;
+
+constexpr uint8_t busFrameId(uint8_t node, uint8_t packet) {
+    return (uint8_t)((node << 4) | (packet & 0x0F));
+}
+
+constexpr uint8_t busNode(uint8_t frameId) {
+    return frameId >> 4;
+}
+
+constexpr uint8_t busPacket(uint8_t frameId) {
+    return frameId & 0x0F;
+}
+
+// The same ID means a different layout depending on who sends it
+enum LinkDirection : uint8_t {
+    TO_MOTOR = 0,               // S3 -> WROOM
+    TO_MAIN                     // WROOM -> S3 (acks, status)
+};
+
+enum WheelIndex : uint8_t {
+    WHEEL_LEFT_FRONT = 0,
+    WHEEL_LEFT_BACK,
+    WHEEL_RIGHT_FRONT,
+    WHEEL_RIGHT_BACK,
+    WHEEL_COUNT
+};
+
+// Legacy command frame - senders that predate sequence numbers stop after speed
+struct SYNAPSE_PACKED MotorCommandFrame {
+    MotorCommand cmd;
+    uint8_t speed;
+    uint8_t seq;
+};
+
+constexpr uint8_t MOTOR_COMMAND_LEGACY_LEN = 2;
+
+// Direct per-wheel drive, -100..100 % (positive = forward)
+struct SYNAPSE_PACKED WheelSetpoint {
+    uint8_t seq;
+    int8_t wheels[WHEEL_COUNT];
+};
+
+// Body-frame velocity, -100..100 % - vx forward, vy left, omega counter-clockwise
+struct SYNAPSE_PACKED BodyVelocitySetpoint {
+    uint8_t seq;
+    int8_t vx;
+    int8_t vy;
+    int8_t omega;
+};
+
+// Sent when nothing else went out for a while - the outputs are left as they are
+struct SYNAPSE_PACKED Heartbeat {
+    uint8_t seq;
+};
+
+struct SYNAPSE_PACKED StatusPoll {
+    uint8_t seq;
+};
+
+// Reply to every frame that doesn't have its own - sent with the ID it confirms
+struct SYNAPSE_PACKED FrameAck {
+    uint8_t seq;
+};
+
+// Every copy of one e-stop carries the same seq and decision time
+struct SYNAPSE_PACKED EmergencyFrame {
+    uint8_t seq;
+    uint8_t copy;
+    uint16_t reserved;
+    uint32_t decisionUs;        // S3 micros() when it decided to stop, echoed back
+};
+
+struct SYNAPSE_PACKED EmergencyAck {
+    uint8_t seq;
+    uint8_t copy;               // The copy this ack answers
+    uint16_t brakeUs;           // WROOM: frame decoded -> bridges braked
+    uint32_t decisionUs;
+    uint32_t brakedUs;          // WROOM clock when the bridges braked - the S3 maps it onto its own
+};
+
+#define STATUS_ESTOP_ACTIVE   0x01     // Latched - estopSource says by what
+#define STATUS_BRAKED         0x02     // Bridges held in brake by the e-stop interrupt
+#define STATUS_MOVING         0x04
+#define STATUS_TIMEOUT_STOP   0x08     // Last stop came from the command timeout
+#define STATUS_MANEUVER       0x10     // Uploaded segments are playing
+
+struct SYNAPSE_PACKED MotorStatus {
+    uint8_t seq;
+    uint8_t flags;                  // STATUS_*
+    uint8_t estopSource;            // 0 none, 1 button, 2 UART
+    uint8_t appliedSpeed;           // Last command speed after the WROOM's speed limits, %
+    int8_t duty[WHEEL_COUNT];       // Output duty, % of full scale, negative = backward
+    uint8_t direction[WHEEL_COUNT]; // 0 coast, 1 forward, 2 backward, 3 brake
+    uint16_t timeouts;              // Command timeout stops since boot
+    uint16_t overruns;              // Control cycles that started a full period late
+    uint16_t jitterMaxUs;
+    uint16_t execMaxUs;
+    uint16_t latencyAvgUs;          // Frame received -> outputs changed
+    uint16_t frameErrors;           // Corrupt frames seen by the WROOM
+    uint32_t timeUs;                // WROOM clock when this report was built
+    uint32_t appliedUs;             // WROOM clock when a frame last changed the outputs
+    uint8_t appliedSeq;             // Sequence number of that frame
+};
+
+// Rates tried after start-up, fastest first. Both boards begin at UART_BAUD_RATE
+// and drop back to it when a negotiated rate goes quiet or starts corrupting frames.
+static constexpr uint32_t LINK_BAUD_RATES[] = {2000000, 1500000, 1000000, 921600};
+constexpr uint8_t LINK_BAUD_RATE_COUNT = sizeof(LINK_BAUD_RATES) / sizeof(LINK_BAUD_RATES[0]);
+
+struct SYNAPSE_PACKED BaudProposal {
+    uint8_t seq;
+    uint8_t accepted;           // Set in the WROOM's reply
+    uint8_t version;            // Sender's PROTOCOL_VERSION
+    uint8_t reserved;
+    uint32_t baud;
+};
+
+constexpr uint8_t LINK_TEST_PATTERN_LEN = 32;
+
+struct SYNAPSE_PACKED LinkTestFrame {
+    uint8_t seq;
+    uint8_t pattern[LINK_TEST_PATTERN_LEN];
+};
+
+// NTP-style probe. All times are the low 32 bits of each board's microsecond
+// clock (micros() / esp_timer); the S3 fills mainSentUs, the WROOM the rest.
+struct SYNAPSE_PACKED TimeSyncFrame {
+    uint8_t seq;
+    uint8_t reserved[3];
+    uint32_t mainSentUs;        // t1 - S3 sent the probe
+    uint32_t motorRxUs;         // t2 - WROOM decoded it
+    uint32_t motorTxUs;         // t3 - WROOM sent the reply
+};
+
+constexpr uint8_t MAX_MOTION_SEGMENTS = 8;
+
+enum SegmentKind : uint8_t {
+    SEGMENT_COMMAND = 0,        // Legacy command + speed
+    SEGMENT_VELOCITY            // Body velocity, same units as BodyVelocitySetpoint
+};
+
+struct SYNAPSE_PACKED MotionSegment {
+    SegmentKind kind;
+    union SYNAPSE_PACKED {
+        struct SYNAPSE_PACKED {
+            MotorCommand cmd;
+            uint8_t speed;
+        } command;
+        struct SYNAPSE_PACKED {
+            int8_t vx;
+            int8_t vy;
+            int8_t omega;
+        } velocity;
+    };
+    uint16_t durationMs;        // Up to SEGMENT_MAX_DURATION_MS on the motor board
+};
+
+// Only the first count segments are sent; count 0 aborts the running maneuver
+struct SYNAPSE_PACKED SegmentList {
+    uint8_t seq;
+    uint8_t count;
+    MotionSegment segments[MAX_MOTION_SEGMENTS];
+};
+
+enum SegmentState : uint8_t {
+    SEGMENT_DONE = 0,           // Last segment ran its full time, wheels ramping down
+    SEGMENT_ABORTED,            // E-stop, abort frame or a newer motion frame
+    SEGMENT_REJECTED            // Invalid list or e-stop active - nothing was played
+};
+
+struct SYNAPSE_PACKED SegmentStatus {
+    uint8_t seq;                // Sequence number of the SegmentList
+    SegmentState state;
+    uint8_t index;              // Segment that was playing when it ended
+    uint16_t elapsedMs;         // Since playback started
+};
+
+// Layouts on the wire. Changing any of these means bumping PROTOCOL_VERSION.
+static_assert(sizeof(MotorCommandFrame) == 3, "MotorCommandFrame layout");
+static_assert(sizeof(WheelSetpoint) == 5, "WheelSetpoint layout");
+static_assert(sizeof(BodyVelocitySetpoint) == 4, "BodyVelocitySetpoint layout");
+static_assert(sizeof(Heartbeat) == 1 && sizeof(FrameAck) == 1 && sizeof(StatusPoll) == 1, "Single-byte frame layout");
+static_assert(sizeof(EmergencyFrame) == 8 && offsetof(EmergencyFrame, decisionUs) == 4, "EmergencyFrame layout");
+static_assert(sizeof(EmergencyAck) == 12 && offsetof(EmergencyAck, brakedUs) == 8, "EmergencyAck layout");
+static_assert(sizeof(MotorStatus) == 33 && offsetof(MotorStatus, timeUs) == 24, "MotorStatus layout");
+static_assert(sizeof(BaudProposal) == 8 && offsetof(BaudProposal, baud) == 4, "BaudProposal layout");
+static_assert(sizeof(LinkTestFrame) == 33, "LinkTestFrame layout");
+static_assert(sizeof(TimeSyncFrame) == 16 && offsetof(TimeSyncFrame, mainSentUs) == 4, "TimeSyncFrame layout");
+static_assert(sizeof(MotionSegment) == 6 && offsetof(MotionSegment, durationMs) == 4, "MotionSegment layout");
+static_assert(offsetof(SegmentList, segments) == 2, "SegmentList header layout");
+static_assert(sizeof(SegmentList) == 2 + MAX_MOTION_SEGMENTS * 6, "SegmentList layout");
+static_assert(sizeof(SegmentStatus) == 5 && offsetof(SegmentStatus, elapsedMs) == 3, "SegmentStatus layout");
+static_assert(sizeof(SegmentList) <= PROTOCOL_MAX_PAYLOAD, "SegmentList exceeds one frame");
+static_assert(alignof(MotorStatus) == 1 && alignof(SegmentList) == 1, "Messages must be viewable in place");
+
+// Packet ID for every message type that has exactly one
+template <typename T> struct MessageTraits;
+
+#define SYNAPSE_MESSAGE(type, packet)                                   \
+    template <> struct MessageTraits<type> {                            \
+        static constexpr PacketId id = packet;                          \
+    }
+
+SYNAPSE_MESSAGE(MotorCommandFrame, PACKET_MOTOR_COMMAND);
+SYNAPSE_MESSAGE(WheelSetpoint, PACKET_WHEEL_SETPOINT);
+SYNAPSE_MESSAGE(BodyVelocitySetpoint, PACKET_BODY_VELOCITY);
+SYNAPSE_MESSAGE(SegmentList, PACKET_SEGMENT_LIST);
+SYNAPSE_MESSAGE(SegmentStatus, PACKET_SEGMENT_STATUS);
+SYNAPSE_MESSAGE(Heartbeat, PACKET_HEARTBEAT);
+SYNAPSE_MESSAGE(BaudProposal, PACKET_BAUD_PROPOSE);
+SYNAPSE_MESSAGE(LinkTestFrame, PACKET_LINK_TEST);
+SYNAPSE_MESSAGE(MotorStatus, PACKET_MOTOR_STATUS);
+SYNAPSE_MESSAGE(EmergencyFrame, PACKET_EMERGENCY_STOP);
+SYNAPSE_MESSAGE(EmergencyAck, PACKET_EMERGENCY_STOP);
+SYNAPSE_MESSAGE(TimeSyncFrame, PACKET_TIME_SYNC);
+SYNAPSE_MESSAGE(StatusPoll, PACKET_STATUS_POLL);
+
+#undef SYNAPSE_MESSAGE
+
+// Bytes on the wire - only a segment list is shorter than its struct
+template <typename T>
+inline uint8_t messageLength(const T&) {
+    return sizeof(T);
+}
+
+inline uint8_t messageLength(const SegmentList& list) {
+    return offsetof(SegmentList, segments) + list.count * sizeof(MotionSegment);
+}
+
+// Starts a message in place in the frame buffer; fill it, then send messageLength() bytes
+template <typename T>
+inline T* beginMessage(uint8_t* buffer) {
+    return new (buffer) T;
+}
+
+// Copies an already built message into the frame buffer, returns its length
+template <typename T>
+inline uint8_t encodeMessage(uint8_t* buffer, const T& message) {
+    uint8_t length = messageLength(message);
+    memcpy(buffer, &message, length);
+    return length;
+}
+
+enum DecodeResult : uint8_t {
+    DECODE_OK = 0,
+    DECODE_UNKNOWN_ID,          // Not a packet ID this direction carries
+    DECODE_SHORT,               // Fewer bytes than the layout needs
+    DECODE_BAD_FIELD            // Enum or count out of range
+};
+
+// Checks length and field ranges of a received payload. Nothing is copied.
+DecodeResult decodeMessage(LinkDirection direction, uint8_t packet, const uint8_t* buffer, uint8_t length);
+const char* decodeResultName(DecodeResult result);
+
+// Read-only view of a payload that passed decodeMessage()
+template <typename T>
+inline const T* viewMessage(const uint8_t* buffer) {
+    return reinterpret_cast<const T*>(buffer);
+}
+
+inline MotionSegment commandSegment(MotorCommand cmd, uint8_t speed, uint16_t durationMs) {
+    MotionSegment segment;
+    segment.kind = SEGMENT_COMMAND;
+    segment.command.cmd = cmd;
+    segment.command.speed = speed;
+    segment.durationMs = durationMs;
+    return segment;
+}
+
+inline MotionSegment velocitySegment(int8_t vx, int8_t vy, int8_t omega, uint16_t durationMs) {
+    MotionSegment segment;
+    segment.kind = SEGMENT_VELOCITY;
+    segment.velocity.vx = vx;
+    segment.velocity.vy = vy;
+    segment.velocity.omega = omega;
+    segment.durationMs = durationMs;
+    return segment;
+}
+
+#endif